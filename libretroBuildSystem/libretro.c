@@ -36,6 +36,7 @@ static retro_input_state_t        input_state_cb = NULL;
 static double      cpuSpeed;
 static bool        syncRtc;
 static bool        allowInvalidBehavior;
+static uint8_t     armCore;
 static const char* osVersion;
 static uint8_t     deviceModel;
 static bool        firstRetroRunCall;
@@ -150,6 +151,17 @@ static void check_variables(bool booting){
       var.key = "palm_emu_feature_durable";
       if(environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
          allowInvalidBehavior = !strcmp(var.value, "enabled");
+      
+#if defined(EMU_SUPPORT_PALM_OS5)
+      var.key = "palm_emu_arm_core";
+      if(environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+         armCore = !strcmp(var.value, "uARM") ? EMU_ARM_CORE_UARM : EMU_ARM_CORE_ARMV5TE;
+
+      //the frontend may have its own SIGSEGV handler so this is up to the user
+      var.key = "palm_emu_demand_paging";
+      if(environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+         palmDemandPaging = !strcmp(var.value, "enabled");
+#endif
    }
 
    var.key = "palm_emu_use_joystick_as_mouse";
@@ -246,6 +258,8 @@ void retro_set_environment(retro_environment_t cb){
       { "palm_emu_disable_graffiti", "Disable Graffiti Area; disabled|enabled" },
 #if defined(EMU_SUPPORT_PALM_OS5)
       { "palm_emu_os_version", "OS Version; Palm m515/Palm OS 4.1|Tungsten T3/Palm OS 5.2.1|Tungsten T3/Palm OS 6.0|Palm m500/Palm OS 4.0" },
+      { "palm_emu_arm_core", "ARM CPU Core(OS 5 only); Dynarec|uARM" },
+      { "palm_emu_demand_paging", "Allocate Address Cache On Demand(OS 5 only, needs restart); disabled|enabled" },
 #else
       { "palm_emu_os_version", "OS Version; Palm m515/Palm OS 4.1|Palm m500/Palm OS 4.0" },
 #endif
@@ -502,7 +516,7 @@ bool retro_load_game(const struct retro_game_info *info){
       bootloaderSize = 0;
    }
    
-   error = emulatorInit(deviceModel, romData, romSize, bootloaderData, bootloaderSize, syncRtc, allowInvalidBehavior);
+   error = emulatorInit(deviceModel, romData, romSize, bootloaderData, bootloaderSize, syncRtc, allowInvalidBehavior, armCore);
    free(romData);
    if(bootloaderData)
       free(bootloaderData);
@@ -510,6 +524,8 @@ bool retro_load_game(const struct retro_game_info *info){
    if(error != EMU_ERROR_NONE)
       return false;
    
+   log_cb(RETRO_LOG_INFO, "Host memory committed after init: %u KB\n", (uint32_t)(emulatorGetCommittedMemory() / 1024));
+   
    //save RAM
    strlcpy(saveRamPath, contentPath, PATH_MAX_LENGTH);
    strlcat(saveRamPath, "-", PATH_MAX_LENGTH);
@@ -572,6 +588,7 @@ bool retro_load_game(const struct retro_game_info *info){
          return false;
       }
       
+      launcherSetBootCacheDirectory(systemDir);
       launcherBootInstantly(hasSram);
 
       if(runningImgFile){
@@ -89,46 +89,43 @@ support_palm_os5{
     DEFINES += EMU_SUPPORT_PALM_OS5 # the Qt build will not be supporting anything too slow to run OS 5
     DEFINES += SUPPORT_LINUX # forces the dynarec to use accurate mode and disable Nspire OS hacks
 
-    EMU_NO_SAFETY{
-        # Windows is only supported in 32 bit mode right now(this is a limitation of the dynarec)
-        # iOS needs IS_IOS_BUILD set, but the Qt port does not support iOS currently
-
-        cpu_x86_32{
-            SOURCES += \
-                ../../src/armv5te/translate_x86.c \
-                ../../src/armv5te/asmcode_x86.S
-        }
-        else{
-            # x86 has this implemented in asmcode_x86.S
-            SOURCES += \
-                ../../src/armv5te/asmcode.c
-        }
-
-        cpu_x86_64{
-            SOURCES += \
-                ../../src/armv5te/translate_x86_64.c \
-                ../../src/armv5te/asmcode_x86_64.S
-        }
-
-        cpu_armv7{
-            SOURCES += \
-                ../../src/armv5te/translate_arm.cpp \
-                ../../src/armv5te/asmcode_arm.S
-        }
-
-        cpu_armv8{
-            SOURCES += \
-                ../../src/armv5te/translate_aarch64.cpp \
-                ../../src/armv5te/asmcode_aarch64.S
-        }
+    # uARM is always built, it can be selected at runtime with emulatorInit
+    SOURCES += \
+        ../../src/armv5te/uArm/CPU_2.c \
+        ../../src/armv5te/uArm/icache.c \
+        ../../src/armv5te/uArm/uArmGlue.cpp
+
+    # Windows is only supported in 32 bit mode right now(this is a limitation of the dynarec)
+    # iOS needs IS_IOS_BUILD set, but the Qt port does not support iOS currently
+
+    cpu_x86_32{
+        SOURCES += \
+            ../../src/armv5te/translate_x86.c \
+            ../../src/armv5te/asmcode_x86.S
     }
     else{
-        # use platform independant C with no dynarec
+        # x86 has this implemented in asmcode_x86.S
+        SOURCES += \
+            ../../src/armv5te/asmcode.c
+    }
+
+    cpu_x86_64{
+        SOURCES += \
+            ../../src/armv5te/translate_x86_64.c \
+            ../../src/armv5te/asmcode_x86_64.S
+    }
+    else:cpu_armv7{
         SOURCES += \
-            ../../src/armv5te/asmcode.c \
-            ../../src/armv5te/uArm/CPU_2.c \
-            ../../src/armv5te/uArm/icache.c \
-            ../../src/armv5te/uArm/uArmGlue.cpp
+            ../../src/armv5te/translate_arm.cpp \
+            ../../src/armv5te/asmcode_arm.S
+    }
+    else:cpu_armv8{
+        SOURCES += \
+            ../../src/armv5te/translate_aarch64.cpp \
+            ../../src/armv5te/asmcode_aarch64.S
+    }
+    else:!cpu_x86_32{
+        # use platform independant C with no dynarec
         DEFINES += NO_TRANSLATION
     }
 
@@ -232,8 +229,10 @@ SOURCES += \
     ../../src/m68k/m68kops.c \
     ../../src/pdiUsbD12.c \
     ../../src/sdCard.c \
+    ../../src/sdCardVirtual.c \
     ../../src/sed1376.c \
     ../../src/silkscreen.c \
+    audiobuffer.cpp \
     debugviewer.cpp \
     emuwrapper.cpp \
     main.cpp \
@@ -265,10 +264,12 @@ HEADERS += \
     ../../src/sdCardAccessors.c.h \
     ../../src/sdCardCommandNames.c.h \
     ../../src/sdCardCrcTables.c.h \
+    ../../src/sdCardVirtual.h \
     ../../src/sed1376.h \
     ../../src/sed1376Accessors.c.h \
     ../../src/sed1376RegisterNames.c.h \
     ../../src/silkscreen.h \
+    audiobuffer.h \
     debugviewer.h \
     emuwrapper.h \
     mainwindow.h \
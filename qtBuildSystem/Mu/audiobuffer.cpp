@@ -0,0 +1,107 @@
+#include "audiobuffer.h"
+
+#include <QIODevice>
+#include <QObject>
+#include <QtGlobal>
+
+#include <atomic>
+#include <stdint.h>
+#include <string.h>
+
+#include "../../src/emulator.h"
+
+
+#define MAX_RATE_ADJUST 0.005//+-0.5%, too small to hear the pitch change
+#define RATE_P 0.005//a completely empty or double full buffer gets the whole adjustment right away
+#define RATE_I 0.001//per second of error
+#define MAX_RATE_INTEGRAL (MAX_RATE_ADJUST / RATE_I)
+
+
+AudioBuffer::AudioBuffer(uint32_t targetFrames, QObject* parent)
+   : QIODevice(parent){
+   //room for the target plus plenty of slack for a late GUI thread
+   capacity = 1;
+   while(capacity < targetFrames * 4)
+      capacity <<= 1;
+
+   ring = new int16_t[capacity * 2];
+   targetFill = targetFrames;
+   writePosition = 0;
+   readPosition = 0;
+   readFraction = 0.0;
+   rateIntegral = 0.0;
+   lastFrame[0] = 0;
+   lastFrame[1] = 0;
+
+   open(QIODevice::ReadOnly);
+}
+
+AudioBuffer::~AudioBuffer(){
+   close();
+   delete[] ring;
+}
+
+void AudioBuffer::push(const int16_t* samples, uint32_t frames){
+   uint32_t write = writePosition.load(std::memory_order_relaxed);
+   uint32_t read = readPosition.load(std::memory_order_acquire);
+   uint32_t offset = write & (capacity - 1);
+   uint32_t untilWrap = capacity - offset;
+
+   //full, the reader will speed up to make room
+   if(capacity - (write - read) < frames)
+      return;
+
+   if(frames > untilWrap){
+      memcpy(ring + offset * 2, samples, untilWrap * 2 * sizeof(int16_t));
+      memcpy(ring, samples + untilWrap * 2, (frames - untilWrap) * 2 * sizeof(int16_t));
+   }
+   else{
+      memcpy(ring + offset * 2, samples, frames * 2 * sizeof(int16_t));
+   }
+
+   writePosition.store(write + frames, std::memory_order_release);
+}
+
+qint64 AudioBuffer::readData(char* data, qint64 maxSize){
+   int16_t* output = (int16_t*)data;
+   uint32_t frames = maxSize / (2 * sizeof(int16_t));
+   uint32_t read = readPosition.load(std::memory_order_relaxed);
+   uint32_t available = writePosition.load(std::memory_order_acquire) - read;
+   double error = ((double)available - targetFill) / targetFill;
+   double position = readFraction;
+   double rate;
+   uint32_t consumed;
+
+   //PI controller, a positive error means too much is buffered so read faster
+   rateIntegral = qBound(-MAX_RATE_INTEGRAL, rateIntegral + error * frames / AUDIO_SAMPLE_RATE, MAX_RATE_INTEGRAL);
+   rate = 1.0 + qBound(-MAX_RATE_ADJUST, RATE_P * error + RATE_I * rateIntegral, MAX_RATE_ADJUST);
+
+   for(uint32_t index = 0; index < frames; index++){
+      uint32_t whole = position;
+
+      //on an underrun the last frame is held so the speaker doesnt pop
+      if(whole + 1 < available){
+         const int16_t* first = ring + ((read + whole) & (capacity - 1)) * 2;
+         const int16_t* second = ring + ((read + whole + 1) & (capacity - 1)) * 2;
+         double fraction = position - whole;
+
+         lastFrame[0] = first[0] + (second[0] - first[0]) * fraction;
+         lastFrame[1] = first[1] + (second[1] - first[1]) * fraction;
+         position += rate;
+      }
+
+      output[index * 2] = lastFrame[0];
+      output[index * 2 + 1] = lastFrame[1];
+   }
+
+   consumed = qMin((uint32_t)position, available);
+   readFraction = position - consumed;
+   readPosition.store(read + consumed, std::memory_order_release);
+
+   return frames * 2 * sizeof(int16_t);
+}
+
+qint64 AudioBuffer::writeData(const char* data, qint64 maxSize){
+   //the emu thread uses push() so it never has to take the QIODevice locks
+   return -1;
+}
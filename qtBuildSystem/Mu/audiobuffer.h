@@ -0,0 +1,34 @@
+#pragma once
+
+#include <QIODevice>
+#include <QObject>
+
+#include <atomic>
+#include <stdint.h>
+
+//single producer single consumer ring of stereo 16 bit frames, the emu thread pushes a frame of audio at a time and the audio device pulls,
+//the pull side resamples by up to +-0.5% to keep the fill level centered so it neither runs dry nor builds up latency
+class AudioBuffer : public QIODevice{
+   Q_OBJECT
+
+private:
+   int16_t*              ring;
+   uint32_t              capacity;//in frames, power of 2
+   uint32_t              targetFill;//in frames
+   std::atomic<uint32_t> writePosition;//in frames, free running, only written by the producer
+   std::atomic<uint32_t> readPosition;//in frames, free running, only written by the consumer
+   double                readFraction;
+   double                rateIntegral;
+   int16_t               lastFrame[2];
+
+public:
+   explicit AudioBuffer(uint32_t targetFrames, QObject* parent = nullptr);
+   ~AudioBuffer();
+
+   void push(const int16_t* samples, uint32_t frames);//producer only, drops the samples if the ring is full
+   bool isSequential() const{return true;}
+
+protected:
+   qint64 readData(char* data, qint64 maxSize);
+   qint64 writeData(const char* data, qint64 maxSize);
+};
@@ -7,6 +7,9 @@
 #include <QDateTime>
 #include <QDate>
 #include <QTime>
+#include <QImage>
+#include <QMutex>
+#include <QWaitCondition>
 
 #include <new>
 #include <chrono>
@@ -30,6 +33,8 @@ extern "C"{
 
 #define MAX_LOG_ENTRYS 2000
 #define MAX_LOG_ENTRY_LENGTH 200
+#define VIRTUAL_SD_CARD_SIZE 0x10000000//256mb, the largest a raw image can be is 512mb
+#define MAX_FRAMEBUFFER_SIZE (320 * 480)//Tungsten T3
 
 
 static bool alreadyExists = false;//there can only be one of this class since it wrappers C code
@@ -86,8 +91,29 @@ static void frontendGetCurrentTime(uint8_t* writeBack){
    writeBack[2] = timeInfo->tm_sec;
 }
 
+static uint32_t frontendReadVirtualSdCardFile(void* file, uint32_t offset, uint8_t* data, uint32_t size){
+   //reads come a block at a time and mostly in order, so keep the last file open
+   static QFile openFile;
+   const QString& path = *(const QString*)file;
+   qint64 bytesRead;
+
+   if(openFile.fileName() != path || !openFile.isOpen()){
+      openFile.close();
+      openFile.setFileName(path);
+      if(!openFile.open(QFile::ReadOnly))
+         return 0;
+   }
+
+   if(!openFile.seek(offset))
+      return 0;
+
+   bytesRead = openFile.read((char*)data, size);
+   return bytesRead > 0 ? bytesRead : 0;
+}
+
 
-EmuWrapper::EmuWrapper(){
+EmuWrapper::EmuWrapper() :
+   emuAudio(AUDIO_SAMPLES_PER_FRAME * 2){
    if(alreadyExists == true)
       throw std::bad_alloc();
    alreadyExists = true;
@@ -97,6 +123,12 @@ EmuWrapper::EmuWrapper(){
    emuRunning = false;
    emuPaused = false;
    emuNewFrameReady = false;
+   emuVirtualSdCardVolume = NULL;
+   emuFramebuffers[0] = new uint16_t[MAX_FRAMEBUFFER_SIZE]();
+   emuFramebuffers[1] = new uint16_t[MAX_FRAMEBUFFER_SIZE]();
+   emuFramebufferReaders[0] = 0;
+   emuFramebufferReaders[1] = 0;
+   emuFrontFramebuffer = 0;
 
    frontendDebugString = new char[MAX_LOG_ENTRY_LENGTH];
    frontendDebugStringSize = MAX_LOG_ENTRY_LENGTH;
@@ -106,6 +138,8 @@ EmuWrapper::~EmuWrapper(){
    if(emuInited)
       exit();
 
+   delete[] emuFramebuffers[0];
+   delete[] emuFramebuffers[1];
    delete[] frontendDebugString;
    frontendDebugStringSize = 0;
    debugStrings.clear();
@@ -115,22 +149,108 @@ EmuWrapper::~EmuWrapper(){
    alreadyExists = false;
 }
 
+static void releaseFramebuffer(void* readers){
+   ((std::atomic<uint32_t>*)readers)->fetch_sub(1);
+}
+
 void EmuWrapper::emuThreadRun(){
+   std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now();
+   const std::chrono::nanoseconds frameDuration(1000000000 / EMU_FPS);
+
    while(!emuThreadJoin){
       if(emuRunning){
          emuPaused = false;
-         if(!emuNewFrameReady){
-            palmInput = emuInput;
-            emulatorRunFrame();
-            emuNewFrameReady = true;
-         }
+         palmInput = emuInput;
+         emulatorRunFrame();
+         emuAudio.push(palmAudio, AUDIO_SAMPLES_PER_FRAME);
+         publishFrame();
+
+         //sleep until an absolute deadline so the time spent emulating doesnt add up to drift, if more than a frame behind dont try to catch up
+         deadline += frameDuration;
+         if(std::chrono::steady_clock::now() - deadline > frameDuration)
+            deadline = std::chrono::steady_clock::now();
+         std::this_thread::sleep_until(deadline);
       }
       else{
          emuPaused = true;
+         std::this_thread::sleep_for(std::chrono::milliseconds(5));
+         deadline = std::chrono::steady_clock::now();
       }
+   }
+}
+
+void EmuWrapper::publishFrame(){
+   uint8_t back;
 
-      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+   //only the emu thread changes the front buffer so once the back buffer has no readers it cant gain any until it is published
+   emuFrameLock.lock();
+   back = !emuFrontFramebuffer;
+   if(emuFramebufferReaders[back] > 0){
+      //a consumer is still holding an older frame, drop this one instead of tearing it
+      emuFrameLock.unlock();
+      return;
+   }
+   emuFrameLock.unlock();
+
+   memcpy(emuFramebuffers[back], palmFramebuffer, palmFramebufferWidth * palmFramebufferHeight * sizeof(uint16_t));
+
+   emuFrameLock.lock();
+   emuFrontFramebuffer = back;
+   emuNewFrameReady = true;
+   emuFrameReady.wakeAll();
+   emuFrameLock.unlock();
+}
+
+void EmuWrapper::addVirtualSdCardDirectory(const QString& path, sd_card_virtual_node_t* directory){
+   QFileInfoList entrys = QDir(path).entryInfoList(QDir::Dirs | QDir::Files | QDir::NoDotAndDotDot, QDir::Name | QDir::DirsFirst);
+   std::vector<sd_card_virtual_node_t>& children = *emuVirtualSdCardDirectorys.emplace(emuVirtualSdCardDirectorys.end(), entrys.size());
+
+   for(int index = 0; index < entrys.size(); index++){
+      sd_card_virtual_node_t& child = children[index];
+
+      emuVirtualSdCardNames.push_back(entrys[index].fileName().toUtf8());
+      child.name = emuVirtualSdCardNames.back().constData();
+      child.isDirectory = entrys[index].isDir();
+      child.size = child.isDirectory ? 0 : qMin(entrys[index].size(), (qint64)UINT32_MAX);
+      child.children = NULL;
+      child.childCount = 0;
+      child.file = NULL;
+
+      if(child.isDirectory){
+         addVirtualSdCardDirectory(entrys[index].filePath(), &child);
+      }
+      else{
+         emuVirtualSdCardPaths.push_back(entrys[index].filePath());
+         child.file = &emuVirtualSdCardPaths.back();
+      }
    }
+
+   directory->children = children.data();
+   directory->childCount = children.size();
+}
+
+bool EmuWrapper::insertVirtualSdCard(const QString& path){
+   emuVirtualSdCardRoot.name = "";
+   emuVirtualSdCardRoot.isDirectory = true;
+   emuVirtualSdCardRoot.size = 0;
+   emuVirtualSdCardRoot.file = NULL;
+   addVirtualSdCardDirectory(path, &emuVirtualSdCardRoot);
+
+   emuVirtualSdCardVolume = sdCardVirtualCreateVolume(&emuVirtualSdCardRoot, VIRTUAL_SD_CARD_SIZE, frontendReadVirtualSdCardFile);
+   if(emuVirtualSdCardVolume && emulatorInsertVirtualSdCard(emuVirtualSdCardVolume, NULL) == EMU_ERROR_NONE)
+      return true;
+
+   freeVirtualSdCard();
+   return false;
+}
+
+void EmuWrapper::freeVirtualSdCard(){
+   //only call with the card ejected
+   sdCardVirtualDestroyVolume(emuVirtualSdCardVolume);
+   emuVirtualSdCardVolume = NULL;
+   emuVirtualSdCardDirectorys.clear();
+   emuVirtualSdCardNames.clear();
+   emuVirtualSdCardPaths.clear();
 }
 
 void EmuWrapper::writeOutSaves(){
@@ -165,7 +285,7 @@ void EmuWrapper::writeOutSaves(){
    }
 }
 
-uint32_t EmuWrapper::init(const QString& assetPath, const QString& osVersion, bool syncRtc, bool allowInvalidBehavior, bool fastBoot){
+uint32_t EmuWrapper::init(const QString& assetPath, const QString& osVersion, bool syncRtc, bool allowInvalidBehavior, bool fastBoot, bool useUarm){
    if(!emuRunning && !emuInited){
       //start emu
       uint32_t error;
@@ -203,7 +323,10 @@ uint32_t EmuWrapper::init(const QString& assetPath, const QString& osVersion, bo
       if(deviceModel == EMU_DEVICE_TUNGSTEN_T3 || !bootloaderFile.open(QFile::ReadOnly | QFile::ExistingOnly))
          hasBootloader = false;
 
-      error = emulatorInit(deviceModel, (uint8_t*)romFile.readAll().data(), romFile.size(), hasBootloader ? (uint8_t*)bootloaderFile.readAll().data() : NULL, hasBootloader ? bootloaderFile.size() : 0, syncRtc, allowInvalidBehavior);
+      //Qt never installs its own SIGSEGV or SIGBUS handlers, so OS 5 can commit its address cache on first use
+      palmDemandPaging = true;
+
+      error = emulatorInit(deviceModel, (uint8_t*)romFile.readAll().data(), romFile.size(), hasBootloader ? (uint8_t*)bootloaderFile.readAll().data() : NULL, hasBootloader ? bootloaderFile.size() : 0, syncRtc, allowInvalidBehavior, useUarm ? EMU_ARM_CORE_UARM : EMU_ARM_CORE_ARMV5TE);
       if(error == EMU_ERROR_NONE){
          QTime now = QTime::currentTime();
 
@@ -215,20 +338,28 @@ uint32_t EmuWrapper::init(const QString& assetPath, const QString& osVersion, bo
             ramFile.close();
          }
 
+         //a raw image wins over a directory, guest writes to a directory card are dropped on exit
          if(sdCardFile.open(QFile::ReadOnly | QFile::ExistingOnly)){
             emulatorInsertSdCard((uint8_t*)sdCardFile.readAll().data(), sdCardFile.size(), NULL);
             sdCardFile.close();
+            emuSdCardFilePath = assetPath + "/sd-" + emuOsName + ".img";
+         }
+         else if(QDir(assetPath + "/sd-" + emuOsName).exists() && insertVirtualSdCard(assetPath + "/sd-" + emuOsName)){
+            emuSdCardFilePath = "";
+         }
+         else{
+            emuSdCardFilePath = assetPath + "/sd-" + emuOsName + ".img";
          }
 
          emuInput = palmInput;
          emuRamFilePath = assetPath + "/userdata-" + emuOsName + ".ram";
-         emuSdCardFilePath = assetPath + "/sd-" + emuOsName + ".img";
          emuSaveStatePath = assetPath + "/states-" + emuOsName + ".states";
 
          //make the place to store the saves
          QDir(emuSaveStatePath).mkdir(".");
 
          //skip the boot screen
+         launcherSetBootCacheDirectory(assetPath.toStdString().c_str());
          if(fastBoot)
             launcherBootInstantly(ramFile.exists());
 
@@ -238,6 +369,8 @@ uint32_t EmuWrapper::init(const QString& assetPath, const QString& osVersion, bo
          emuRunning = true;
          emuPaused = false;
          emuNewFrameReady = false;
+         memset(emuFramebuffers[0], 0x00, MAX_FRAMEBUFFER_SIZE * sizeof(uint16_t));
+         memset(emuFramebuffers[1], 0x00, MAX_FRAMEBUFFER_SIZE * sizeof(uint16_t));
          emuThread = std::thread(&EmuWrapper::emuThreadRun, this);
       }
       else{
@@ -256,9 +389,16 @@ void EmuWrapper::exit(){
    emuRunning = false;
    if(emuThread.joinable())
       emuThread.join();
+
+   //let anyone waiting on a frame see there wont be one
+   emuFrameLock.lock();
+   emuFrameReady.wakeAll();
+   emuFrameLock.unlock();
+
    if(emuInited){
       writeOutSaves();
       emulatorDeinit();
+      freeVirtualSdCard();
    }
 }
 
@@ -267,6 +407,11 @@ void EmuWrapper::pause(){
       emuRunning = false;
       while(!emuPaused)
          std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+      //no frames are coming until resumed
+      emuFrameLock.lock();
+      emuFrameReady.wakeAll();
+      emuFrameLock.unlock();
    }
 }
 
@@ -332,6 +477,7 @@ uint32_t EmuWrapper::bootFromFile(const QString& mainPath){
 
    //fully clear the emu
    emulatorEjectSdCard();
+   freeVirtualSdCard();
    emulatorHardReset();
 
    if(hasSaveRam)
@@ -467,6 +613,33 @@ uint32_t EmuWrapper::loadState(const QString& name){
    return error;
 }
 
+bool EmuWrapper::waitForNewFrame(unsigned long timeout){
+   bool ready;
+
+   emuFrameLock.lock();
+   while(!emuNewFrameReady && emuRunning && emuFrameReady.wait(&emuFrameLock, timeout));
+   ready = emuNewFrameReady;
+   emuFrameLock.unlock();
+
+   return ready;
+}
+
+const QImage EmuWrapper::getFramebufferImage(){
+   uint8_t front;
+
+   //a null image never calls the cleanup function
+   if(palmFramebufferWidth == 0 || palmFramebufferHeight == 0)
+      return QImage();
+
+   emuFrameLock.lock();
+   front = emuFrontFramebuffer;
+   emuFramebufferReaders[front]++;
+   emuFrameLock.unlock();
+
+   //the reader count is dropped when the last copy of the image is destroyed
+   return QImage((const uchar*)emuFramebuffers[front], palmFramebufferWidth, palmFramebufferHeight, palmFramebufferWidth * sizeof(uint16_t), QImage::Format_RGB16, releaseFramebuffer, &emuFramebufferReaders[front]);
+}
+
 void EmuWrapper::setPenValue(float x, float y, bool touched){
    emuInput.touchscreenX = x;
    emuInput.touchscreenY = y;
@@ -546,7 +719,8 @@ QString EmuWrapper::debugGetCpuRegisterString(){
       regString += QString::asprintf("LR:0x%08X\n", pxa260GetRegister(14));
       regString += QString::asprintf("PC:0x%08X\n", pxa260GetPc());
       regString += QString::asprintf("CPSR:0x%08X\n", pxa260GetCpsr());
-      regString += QString::asprintf("SPSR:0x%08X", pxa260GetSpsr());
+      regString += QString::asprintf("SPSR:0x%08X\n", pxa260GetSpsr());
+      regString += QString::asprintf("Committed:%u KB", (uint32_t)(getCommittedMemory() / 1024));
    }
    else{
       for(uint8_t dRegs = 0; dRegs < 8; dRegs++)
@@ -4,12 +4,18 @@
 #include <QVector>
 #include <QString>
 #include <QByteArray>
+#include <QMutex>
+#include <QWaitCondition>
 
 #include <thread>
 #include <atomic>
+#include <list>
+#include <vector>
 #include <stdint.h>
+#include <limits.h>
 
 #include "../../src/emulator.h"
+#include "audiobuffer.h"
 
 class EmuWrapper{
 private:
@@ -27,9 +33,28 @@ private:
    QString           emuSdCardFilePath;
    QString           emuSaveStatePath;
    input_t           emuInput;
+   AudioBuffer       emuAudio;//filled by the emu thread, drained by the audio device
+
+   //completed frames are published to the front buffer, the emu thread only fills the back buffer once nobody holds an image of it
+   QMutex                emuFrameLock;//guards emuFrontFramebuffer, emuFramebufferReaders increments and emuNewFrameReady
+   QWaitCondition        emuFrameReady;
+   uint16_t*             emuFramebuffers[2];
+   std::atomic<uint32_t> emuFramebufferReaders[2];
+   uint8_t               emuFrontFramebuffer;
+
+   //the tree a virtual SD card is built from, node pointers must stay valid so these are only appended to
+   std::list<std::vector<sd_card_virtual_node_t>> emuVirtualSdCardDirectorys;
+   std::list<QByteArray>                          emuVirtualSdCardNames;
+   std::list<QString>                             emuVirtualSdCardPaths;
+   sd_card_virtual_node_t                         emuVirtualSdCardRoot;
+   sd_card_virtual_volume_t*                      emuVirtualSdCardVolume;
 
    void emuThreadRun();
+   void publishFrame();
    void writeOutSaves();
+   void addVirtualSdCardDirectory(const QString& path, sd_card_virtual_node_t* directory);
+   bool insertVirtualSdCard(const QString& path);
+   void freeVirtualSdCard();
 
 public:
    enum{
@@ -50,7 +75,7 @@ public:
    EmuWrapper();
    ~EmuWrapper();
 
-   uint32_t init(const QString& assetPath, const QString& osVersion, bool syncRtc = false, bool allowInvalidBehavior = false, bool fastBoot = false);
+   uint32_t init(const QString& assetPath, const QString& osVersion, bool syncRtc = false, bool allowInvalidBehavior = false, bool fastBoot = false, bool useUarm = false);
    void exit();
    void pause();
    void resume();
@@ -71,12 +96,14 @@ public:
    uint16_t screenWidth() const{return palmFramebufferWidth;}
    uint16_t screenHeight() const{return palmFramebufferHeight;}
    bool newFrameReady() const{return emuNewFrameReady;}
+   QIODevice* getAudioDevice(){return &emuAudio;}//for a pull mode QAudioOutput, safe to read from any one thread
+   bool waitForNewFrame(unsigned long timeout = ULONG_MAX);//for consumers without an event loop, returns newFrameReady()
    void frameHandled(){emuNewFrameReady = false;}
 
-   //calling these while newFrameReady() == false is undefined behavior, the other thread may be writing to them
-   const QImage getFramebufferImage(){return QImage((uchar*)palmFramebuffer, palmFramebufferWidth, palmFramebufferHeight, palmFramebufferWidth * sizeof(uint16_t), QImage::Format_RGB16);}
-   const int16_t* getAudioSamples() const{return palmAudio;}
+   //always the last complete frame, no copy is made so dont hold the image longer than needed, the screen stops updating while it is held
+   const QImage getFramebufferImage();
    bool getPowerButtonLed() const{return palmMisc.greenLed;}
+   uint64_t getCommittedMemory() const{return emulatorGetCommittedMemory();}//host bytes backing the emulated device
 
    QVector<QString>& debugLogEntrys();
    QVector<uint64_t>& debugDuplicateLogEntryCount();
@@ -48,7 +48,7 @@ MainWindow::MainWindow(QWidget* parent) :
    emuDebugger = new DebugViewer(this);
    refreshDisplay = new QTimer(this);
    audioDevice = new QAudioOutput(format, this);
-   audioOut = audioDevice->start();
+   audioDevice->start(emu.getAudioDevice());
 
    //set variables to there default if its the first boot
    if(settings->value("firstBootCompleted", "").toString() == ""){
@@ -225,13 +225,10 @@ void MainWindow::updateDisplay(){
       //video
       ui->display->repaint();
 
-      //audio
-      audioOut->write((const char*)emu.getAudioSamples(), AUDIO_SAMPLES_PER_FRAME * 2/*channels*/ * sizeof(int16_t));
-
       //power LED
       ui->powerButtonLed->setStyleSheet(emu.getPowerButtonLed() ? "background: lime" : "");
 
-      //allow next frame to start
+      //wait for the next frame
       emu.frameHandled();
    }
 }
@@ -329,7 +326,7 @@ void MainWindow::on_center_released(){
 void MainWindow::on_ctrlBtn_clicked(){
    if(!emu.isInited()){
       QString sysDir = settings->value("resourceDirectory", "").toString();
-      uint32_t error = emu.init(sysDir, settings->value("palmOsVersionString", "Palm m515/Palm OS 4.1").toString(), settings->value("featureSyncedRtc", false).toBool(), settings->value("featureDurable", false).toBool(), settings->value("fastBoot", false).toBool());
+      uint32_t error = emu.init(sysDir, settings->value("palmOsVersionString", "Palm m515/Palm OS 4.1").toString(), settings->value("featureSyncedRtc", false).toBool(), settings->value("featureDurable", false).toBool(), settings->value("fastBoot", false).toBool(), settings->value("featureUarm", false).toBool());
 
       if(error == EMU_ERROR_NONE){
          emu.setCpuSpeed(settings->value("cpuSpeed", 1.00).toDouble());
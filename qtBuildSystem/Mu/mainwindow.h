@@ -88,7 +88,6 @@ private:
    DebugViewer*     emuDebugger;
    QTimer*          refreshDisplay;
    QAudioOutput*    audioDevice;
-   QIODevice*       audioOut;
    Ui::MainWindow*  ui;
    int              keyForButton[EmuWrapper::BUTTON_TOTAL_COUNT];
 };
@@ -30,6 +30,7 @@ SettingsManager::SettingsManager(QWidget* parent) :
 
    ui->featureSyncedRtc->setChecked(settings->value("featureSyncedRtc", false).toBool());
    ui->featureDurable->setChecked(settings->value("featureDurable", false).toBool());
+   ui->featureUarm->setChecked(settings->value("featureUarm", false).toBool());
 
    setKeySelectorState(-1);
    updateButtonKeys();
@@ -150,6 +151,10 @@ void SettingsManager::on_featureDurable_toggled(bool checked){
    settings->setValue("featureDurable", checked);
 }
 
+void SettingsManager::on_featureUarm_toggled(bool checked){
+   settings->setValue("featureUarm", checked);
+}
+
 void SettingsManager::on_fastBoot_toggled(bool checked){
    settings->setValue("fastBoot", checked);
 }
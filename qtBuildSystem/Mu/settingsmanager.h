@@ -46,6 +46,7 @@ private slots:
 
    void on_featureSyncedRtc_toggled(bool checked);
    void on_featureDurable_toggled(bool checked);
+   void on_featureUarm_toggled(bool checked);
 
    void on_fastBoot_toggled(bool checked);
    void on_cpuSpeed_valueChanged(double arg1);
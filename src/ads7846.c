@@ -279,3 +279,49 @@ bool ads7846ExchangeBit(bool bitIn){
 
    return ads7846GetAdcBit();
 }
+
+uint16_t ads7846ExchangeWord(uint8_t bits, uint16_t value){
+   //same as calling ads7846ExchangeBit for each of the bottom bits of value MSB first,
+   //bits that only shift the control byte in or the conversion out are done as one run, only control starts and conversions go 1 bit at a time
+   uint16_t output = 0x0000;
+
+   //chip data out is high when off
+   if(ads7846ChipSelect)
+      return fillBottomWith1s(0, bits);
+
+   while(bits > 0){
+      uint8_t run = 0;
+
+      if(ads7846BitsToNextControl >= 9){
+         //control byte bits
+         run = bits < ads7846BitsToNextControl - 8 ? bits : ads7846BitsToNextControl - 8;
+         ads7846ControlByte <<= run;
+         ads7846ControlByte |= (value >> (bits - run)) & ((1 << run) - 1);
+      }
+      else if(ads7846BitsToNextControl >= 2 && ads7846BitsToNextControl != 7){
+         //conversion bits, the conversion itself happens when ads7846BitsToNextControl goes from 7 to 6
+         run = ads7846BitsToNextControl == 8 ? 1 : bits < ads7846BitsToNextControl - 1 ? bits : ads7846BitsToNextControl - 1;
+      }
+      else if(ads7846BitsToNextControl == 0){
+         //waiting for a start bit, 0s do nothing
+         while(run < bits && !(value & (1 << (bits - run - 1))))
+            run++;
+      }
+
+      if(run > 0){
+         output <<= run;
+         output |= ads7846OutputValue >> (16 - run);
+         ads7846OutputValue <<= run;
+         if(ads7846BitsToNextControl > 0)
+            ads7846BitsToNextControl -= run;
+         bits -= run;
+      }
+      else{
+         output <<= 1;
+         output |= ads7846ExchangeBit(!!(value & (1 << (bits - 1))));
+         bits--;
+      }
+   }
+
+   return output;
+}
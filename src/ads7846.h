@@ -13,5 +13,6 @@ void ads7846LoadState(uint8_t* data);
 
 void ads7846SetChipSelect(bool value);
 bool ads7846ExchangeBit(bool bitIn);
+uint16_t ads7846ExchangeWord(uint8_t bits, uint16_t value);//exchanges the bottom bits of value MSB first, returns the received bits
 
 #endif
@@ -5,6 +5,7 @@
 extern "C" {
 #include "../pxa260/pxa260.h"
 #include "../pxa260/pxa260_PwrClk.h"
+#include "../pxa260/pxa260_CPU.h"
 }
 
 
@@ -93,12 +94,14 @@ void do_cp15_mcr(uint32_t insn)
         }
         case 0x020000: /* MCR p15, 0, <Rd>, c2, c0, 0: Translation Table Base Register */
             arm.translation_table_base = value & ~0x3FFF;
-            addr_cache_flush();
+            addr_cache_flush_tlb();
             break;
-        case 0x030000: /* MCR p15, 0, <Rd>, c3, c0, 0: Domain Access Control Register */
+        case 0x030000: { /* MCR p15, 0, <Rd>, c3, c0, 0: Domain Access Control Register */
+            uint32_t old_domain_access_control = arm.domain_access_control;
             arm.domain_access_control = value;
-            addr_cache_flush();
+            addr_cache_flush_domains(old_domain_access_control);
             break;
+        }
         case 0x050000: /* MCR p15, 0, <Rd>, c5, c0, 0: Data Fault Status Register */
             arm.data_fault_status = value;
             break;
@@ -109,34 +112,30 @@ void do_cp15_mcr(uint32_t insn)
             arm.fault_address = value;
             break;
         case 0x070080: /* MCR p15, 0, <Rd>, c7, c0, 4: Wait for interrupt */
-            emuprintf("Wait for interrupt, does not work with uARM core!\n");
-            cycle_count_delta = 0;
-            if (arm.interrupts == 0) {
-                arm.reg[15] -= 4;
-                cpu_events |= EVENT_WAITING;
-            }
+            pxa260CpuWaitForInterrupt();
             break;
         case 0x080005: /* MCR p15, 0, <Rd>, c8, c5, 0: Invalidate instruction TLB */
+        case 0x080006: /* MCR p15, 0, <Rd>, c8, c6, 0: Invalidate data TLB */
         case 0x080007: /* MCR p15, 0, <Rd>, c8, c7, 0: Invalidate TLB */
+            addr_cache_flush_tlb();
+            break;
         case 0x080025: /* MCR p15, 0, <Rd>, c8, c5, 1: Invalidate instruction TLB entry */
-        case 0x080027: /* MCR p15, 0, <Rd>, c8, c7, 1: Invalidate TLB (used by polydumper) */
+        case 0x080026: /* MCR p15, 0, <Rd>, c8, c6, 1: Invalidate data TLB entry */
+        case 0x080027: /* MCR p15, 0, <Rd>, c8, c7, 1: Invalidate TLB entry (used by polydumper) */
+            addr_cache_flush_entry(value);
+            break;
         case 0x070005: /* MCR p15, 0, <Rd>, c7, c5, 0: Invalidate ICache */
         case 0x070025: /* MCR p15, 0, <Rd>, c7, c5, 1: Invalidate ICache line */
         case 0x070007: /* MCR p15, 0, <Rd>, c7, c7, 0: Invalidate ICache and DCache */
-            addr_cache_flush();
+            mmu_flush_icache();
             break;
 
-        case 0x080006: /* MCR p15, 0, <Rd>, c8, c6, 0: Invalidate data TLB */
-        case 0x080026: /* MCR p15, 0, <Rd>, c8, c6, 1: Invalidate data TLB entry */
         case 0x070026: /* MCR p15, 0, <Rd>, c7, c6, 1: Invalidate single DCache entry */
         case 0x07002A: /* MCR p15, 0, <Rd>, c7, c10, 1: Clean DCache line */
         case 0x07002E: /* MCR p15, 0, <Rd>, c7, c14, 1: Clean and invalidate single DCache entry */
         case 0x07008A: /* MCR p15, 0, <Rd>, c7, c10, 4: Drain write buffer */
         case 0x0F0000: /* MCR p15, 0, <Rd>, c15, c0, 0: Debug Override Register */
-            #ifdef SUPPORT_LINUX
-                // Normally ignored, but somehow needed for linux to boot correctly
-                addr_cache_flush();
-            #endif
+            // No data cache or write buffer is emulated, new page table entries are seen on the next walk
             break;
         case 0x0F0001: /* MCR p15, 0, <Rd>, c15, c1, 0: Unknown */
             //TODO: Unknown(implmentation defined cp15 register)
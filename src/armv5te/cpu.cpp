@@ -75,7 +75,10 @@ void cpu_arm_loop()
         }
 #ifndef NO_TRANSLATION
         else if(do_translate && !(*flags_ptr & DONT_TRANSLATE) && (*flags_ptr & RF_CODE_EXECUTED))
+        {
             translate(arm.reg[15], &p->raw);
+            mmu_mark_translated(arm.reg[15]);
+        }
 
         // If the instruction is translated, use the translation
         if((~cpu_events & EVENT_DEBUG_STEP) && *flags_ptr & RF_CODE_TRANSLATED)
@@ -88,7 +91,11 @@ void cpu_arm_loop()
             continue;
         }
 
-	*flags_ptr |= RF_CODE_EXECUTED;
+	if(!(*flags_ptr & RF_CODE_EXECUTED))
+	{
+	    mem_flags_commit(p);
+	    *flags_ptr |= RF_CODE_EXECUTED;
+	}
 #endif
 
         /*
@@ -337,7 +344,7 @@ void set_cpsr_full(uint32_t cpsr)
 
     // Access permissions are different
     if((old_mode == MODE_USR) ^ (new_mode == MODE_USR))
-        addr_cache_flush();
+        addr_cache_flush_permissions();
 
     same_mode:
     if(cpsr & 0x01000000)
@@ -8,13 +8,6 @@
 #include "mem.h"
 #include "translate.h"
 
-uint8_t   (*read_byte_map[64])(uint32_t addr);
-uint16_t  (*read_half_map[64])(uint32_t addr);
-uint32_t  (*read_word_map[64])(uint32_t addr);
-void (*write_byte_map[64])(uint32_t addr, uint8_t value);
-void (*write_half_map[64])(uint32_t addr, uint16_t value);
-void (*write_word_map[64])(uint32_t addr, uint32_t value);
-
 /* For invalid/unknown physical addresses */
 uint8_t bad_read_byte(uint32_t addr)               { warn("Bad read_byte: %08X", addr); return 0; }
 uint16_t bad_read_half(uint32_t addr)              { warn("Bad read_half: %08X", addr); return 0; }
@@ -26,19 +19,177 @@ void bad_write_word(uint32_t addr, uint32_t value) { warn("Bad write_word: %08X
 uint8_t *mem_and_flags = NULL;
 struct mem_area_desc mem_areas[2];
 
-void *phys_mem_ptr(uint32_t addr, uint32_t size) {
+#define MEM_FLAGS_PAGE_SIZE 0x10000 // A multiple of any host page size
+
+static bool mem_flags_sparse;
+static uint32_t mem_flags_committed_pages;
+static uint8_t mem_flags_committed[MEM_MAXSIZE / MEM_FLAGS_PAGE_SIZE];
+
+bool mem_and_flags_init(void) {
+    if (mem_and_flags)
+        return true;
+
+    mem_and_flags = os_reserve_sparse(MEM_MAXSIZE * 2);
+    if (mem_and_flags) {
+        if (os_commit(mem_and_flags, MEM_MAXSIZE) && os_commit_readonly(mem_and_flags + MEM_MAXSIZE, MEM_MAXSIZE)) {
+            memset(mem_flags_committed, 0, sizeof(mem_flags_committed));
+            mem_flags_committed_pages = 0;
+            mem_flags_sparse = true;
+            return true;
+        }
+        os_free_sparse(mem_and_flags, MEM_MAXSIZE * 2);
+    }
+
+    mem_and_flags = os_reserve(MEM_MAXSIZE * 2);
+    mem_flags_sparse = false;
+    return mem_and_flags != NULL;
+}
+
+void mem_and_flags_deinit(void) {
+    if (!mem_and_flags)
+        return;
+
+    if (mem_flags_sparse)
+        os_free_sparse(mem_and_flags, MEM_MAXSIZE * 2);
+    else
+        os_free(mem_and_flags, MEM_MAXSIZE * 2);
+    mem_and_flags = NULL;
+    mem_flags_sparse = false;
+    mem_flags_committed_pages = 0;
+}
+
+void mem_flags_commit(void *memptr) {
+    if (!mem_flags_sparse)
+        return;
+
+    uint32_t index = ((uint8_t *)memptr - mem_and_flags) / MEM_FLAGS_PAGE_SIZE;
+    if (mem_flags_committed[index])
+        return;
+    if (!os_commit(mem_and_flags + MEM_MAXSIZE + index * MEM_FLAGS_PAGE_SIZE, MEM_FLAGS_PAGE_SIZE))
+        error("Failed to commit RAM flags");
+    mem_flags_committed[index] = 1;
+    mem_flags_committed_pages++;
+}
+
+size_t mem_committed_bytes(void) {
+    if (!mem_and_flags)
+        return 0;
+    if (!mem_flags_sparse)
+        return MEM_MAXSIZE * 2;
+    return MEM_MAXSIZE + (size_t)mem_flags_committed_pages * MEM_FLAGS_PAGE_SIZE;
+}
+
+#define MEM_SECTION_COUNT (1 << (32 - MEM_SECTION_BITS))
+#define MEM_PAGES_PER_SECTION (1 << (MEM_SECTION_BITS - MEM_PAGE_BITS))
+
+struct mem_page {
+    uintptr_t host_bias; // Host pointer minus physical address, only valid for memory pages
+    const mem_mmio_handlers *mmio;
+};
+
+struct mem_section {
+    struct mem_page *pages; // NULL when the whole section is mapped by page
+    struct mem_page page;
+};
+
+static const mem_mmio_handlers mem_bad_handlers = {
+    bad_read_byte, bad_read_half, bad_read_word,
+    bad_write_byte, bad_write_half, bad_write_word
+};
+
+// Host memory goes through these when an access can't use addr_cache, like writes to ROM
+static const mem_mmio_handlers mem_memory_handlers = {
+    memory_read_byte, memory_read_half, memory_read_word,
+    memory_write_byte, memory_write_half, memory_write_word
+};
+
+static struct mem_section mem_sections[MEM_SECTION_COUNT];
+
+static inline const struct mem_page *mem_get_page(uint32_t addr) {
+    const struct mem_section *section = &mem_sections[addr >> MEM_SECTION_BITS];
+    if (section->pages)
+        return &section->pages[(addr >> MEM_PAGE_BITS) & (MEM_PAGES_PER_SECTION - 1)];
+    return &section->page;
+}
+
+static bool mem_map_range(uint32_t base, uint32_t size, uintptr_t host_bias, const mem_mmio_handlers *mmio) {
+    uint64_t addr = base;
+    uint64_t end = (uint64_t)base + size;
+    struct mem_page page = {host_bias, mmio};
+
+    if ((base | size) & (MEM_PAGE_SIZE - 1))
+        return false;
+
+    while (addr < end) {
+        struct mem_section *section = &mem_sections[addr >> MEM_SECTION_BITS];
+
+        if (!(addr & ((1 << MEM_SECTION_BITS) - 1)) && end - addr >= (1 << MEM_SECTION_BITS)) {
+            // Whole section, drop any page table
+            free(section->pages);
+            section->pages = NULL;
+            section->page = page;
+            addr += 1 << MEM_SECTION_BITS;
+        } else {
+            if (!section->pages) {
+                unsigned int i;
+                section->pages = malloc(sizeof(struct mem_page) * MEM_PAGES_PER_SECTION);
+                if (!section->pages)
+                    return false;
+                for (i = 0; i < MEM_PAGES_PER_SECTION; i++)
+                    section->pages[i] = section->page;
+            }
+            section->pages[(addr >> MEM_PAGE_BITS) & (MEM_PAGES_PER_SECTION - 1)] = page;
+            addr += MEM_PAGE_SIZE;
+        }
+    }
+
+    return true;
+}
+
+bool mem_map_memory(uint32_t base, uint32_t size, uint8_t *ptr) {
+    return mem_map_range(base, size, (uintptr_t)ptr - base, &mem_memory_handlers);
+}
+
+bool mem_map_mmio(uint32_t base, uint32_t size, const mem_mmio_handlers *handlers) {
+    return mem_map_range(base, size, 0, handlers);
+}
+
+void mem_map_reset(void) {
     unsigned int i;
-    for (i = 0; i < sizeof(mem_areas)/sizeof(*mem_areas); i++) {
-        uint32_t offset = addr - mem_areas[i].base;
-        if (offset < mem_areas[i].size && size <= mem_areas[i].size - offset)
-            return mem_areas[i].ptr + offset;
+    for (i = 0; i < MEM_SECTION_COUNT; i++) {
+        free(mem_sections[i].pages);
+        mem_sections[i].pages = NULL;
+        mem_sections[i].page.host_bias = 0;
+        mem_sections[i].page.mmio = &mem_bad_handlers;
     }
-    return NULL;
+}
+
+const mem_mmio_handlers *mem_get_handlers(uint32_t addr) {
+    return mem_get_page(addr)->mmio;
+}
+
+void *phys_mem_ptr(uint32_t addr, uint32_t size) {
+    const struct mem_page *page = mem_get_page(addr);
+    if (page->mmio != &mem_memory_handlers)
+        return NULL;
+
+    // The whole range has to be in the same block of host memory
+    if (size > 1) {
+        uint32_t last = addr + size - 1;
+        const struct mem_page *last_page;
+        if (last < addr)
+            return NULL;
+        last_page = mem_get_page(last);
+        if (last_page->mmio != &mem_memory_handlers || last_page->host_bias != page->host_bias)
+            return NULL;
+    }
+
+    return (uint8_t *)(page->host_bias + addr);
 }
 
 uint32_t phys_mem_addr(void *ptr) {
-    int i;
-    for (i = 0; i < 3; i++) {
+    unsigned int i;
+    for (i = 0; i < sizeof(mem_areas)/sizeof(*mem_areas); i++) {
         uint32_t offset = (uint8_t *)ptr - mem_areas[i].ptr;
         if (offset < mem_areas[i].size)
             return mem_areas[i].base + offset;
@@ -124,20 +275,20 @@ void memory_write_word(uint32_t addr, uint32_t value) {
 }
 
 uint32_t FASTCALL mmio_read_byte(uint32_t addr) {
-    return read_byte_map[addr >> 26](addr);
+    return mem_get_page(addr)->mmio->read_byte(addr);
 }
 uint32_t FASTCALL mmio_read_half(uint32_t addr) {
-    return read_half_map[addr >> 26](addr);
+    return mem_get_page(addr)->mmio->read_half(addr);
 }
 uint32_t FASTCALL mmio_read_word(uint32_t addr) {
-    return read_word_map[addr >> 26](addr);
+    return mem_get_page(addr)->mmio->read_word(addr);
 }
 void FASTCALL mmio_write_byte(uint32_t addr, uint32_t value) {
-    write_byte_map[addr >> 26](addr, value);
+    mem_get_page(addr)->mmio->write_byte(addr, value);
 }
 void FASTCALL mmio_write_half(uint32_t addr, uint32_t value) {
-    write_half_map[addr >> 26](addr, value);
+    mem_get_page(addr)->mmio->write_half(addr, value);
 }
 void FASTCALL mmio_write_word(uint32_t addr, uint32_t value) {
-    write_word_map[addr >> 26](addr, value);
+    mem_get_page(addr)->mmio->write_word(addr, value);
 }
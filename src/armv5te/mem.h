@@ -3,7 +3,9 @@
 #ifndef H_MEM
 #define H_MEM
 
+#include <stddef.h>
 #include <stdint.h>
+#include <stdbool.h>
 
 #include "cpu.h"
 
@@ -13,15 +15,38 @@ extern "C" {
 
 #define MEM_MAXSIZE (80*1024*1024) // also defined as RAM_FLAGS in asmcode.S
 
-extern uint8_t   (*read_byte_map[64])(uint32_t addr);
-extern uint16_t  (*read_half_map[64])(uint32_t addr);
-extern uint32_t  (*read_word_map[64])(uint32_t addr);
-extern void (*write_byte_map[64])(uint32_t addr, uint8_t value);
-extern void (*write_half_map[64])(uint32_t addr, uint16_t value);
-extern void (*write_word_map[64])(uint32_t addr, uint32_t value);
+/* Physical memory is described by a two level page table, 1MB sections
+ * that are either mapped whole or split into 4KB pages. Every page is
+ * either a block of host memory or a set of MMIO handlers, so an access
+ * that misses addr_cache is one lookup and one indirect call. */
+#define MEM_SECTION_BITS 20
+#define MEM_PAGE_BITS 12
+#define MEM_PAGE_SIZE (1 << MEM_PAGE_BITS)
+
+typedef struct mem_mmio_handlers {
+    uint8_t  (*read_byte)(uint32_t addr);
+    uint16_t (*read_half)(uint32_t addr);
+    uint32_t (*read_word)(uint32_t addr);
+    void (*write_byte)(uint32_t addr, uint8_t value);
+    void (*write_half)(uint32_t addr, uint16_t value);
+    void (*write_word)(uint32_t addr, uint32_t value);
+} mem_mmio_handlers;
+
+// Base and size must be multiples of MEM_PAGE_SIZE, later mappings replace earlier ones
+bool mem_map_memory(uint32_t base, uint32_t size, uint8_t *ptr);
+bool mem_map_mmio(uint32_t base, uint32_t size, const mem_mmio_handlers *handlers);
+void mem_map_reset(void);
+const mem_mmio_handlers *mem_get_handlers(uint32_t addr);
 
 // Must be allocated below 2GB (see comments for mmu.c)
 extern uint8_t *mem_and_flags;
+/* The memory half is committed up front. The flags half reads as zero until
+ * mem_flags_commit() makes a page writable, which has to happen before any
+ * flag in it is set, so only pages with code that ran get backing memory. */
+bool mem_and_flags_init(void);
+void mem_and_flags_deinit(void);
+void mem_flags_commit(void *memptr);
+size_t mem_committed_bytes(void);
 struct mem_area_desc {
     uint32_t base, size;
     uint8_t *ptr;
@@ -7,15 +7,17 @@
 #include "mem.h"
 #include "os/os.h"
 
-#if !defined(EMU_NO_SAFETY)
 #include "uArm/CPU_2.h"
 #include "uArm/icache.h"
 #include "../pxa260/pxa260.h"
-#endif
 
 /* Copy of translation table in memory (hack to approximate effect of having a TLB) */
 static uint32_t mmu_translation_table[0x1000];
 
+/* Sections that code was translated from, translations contain virtual
+ * addresses so they only need to be dropped if one of these is remapped */
+static uint32_t mmu_translated_sections[0x1000 / 32];
+
 void mmu_dump_tables(void) {
     if ((arm.control & 1) == 0) {
         gui_debug_printf("MMU disabled\n");
@@ -87,6 +89,12 @@ uint32_t mmu_translate(uint32_t addr, bool writing, fault_proc *fault, uint8_t *
 
     uint32_t *table = mmu_translation_table;
     uint32_t entry = table[addr >> 20];
+    if (!(entry & 3)) {
+        /* Invalid entries are never held in the TLB, a real walk would see the current value */
+        uint32_t *tt = (uint32_t*)phys_mem_ptr(arm.translation_table_base, 0x4000);
+        if (tt)
+            entry = table[addr >> 20] = tt[addr >> 20];
+    }
     uint32_t domain = entry >> 5 & 0x0F;
     uint32_t status = domain << 4;
     uint32_t ap;
@@ -213,27 +221,24 @@ static void addr_cache_invalidate(int i) {
  * at a time, we can keep only a few pages committed and thereby reduce
  * the memory used by a lot. */
 #define AC_COMMIT_MAX 128
-#define AC_PAGE_SIZE 4096
 
-bool addr_cache_pagefault(void *addr) {
-    static uint8_t ac_commit_map[AC_NUM_ENTRIES * sizeof(ac_entry) / AC_PAGE_SIZE];
-    static ac_entry *ac_commit_list[AC_COMMIT_MAX];
-    static uint32_t ac_commit_index;
+static ac_entry *ac_commit_list[AC_COMMIT_MAX];
+static uint32_t ac_commit_index;
+static uint32_t ac_committed_pages;
 
+bool addr_cache_pagefault(void *addr) {
     ac_entry *page = (ac_entry *)((uintptr_t)addr & -AC_PAGE_SIZE);
-    uint32_t offset = page - addr_cache;
-    if (offset >= AC_NUM_ENTRIES)
+    uintptr_t offset = page - addr_cache;
+    if ((uintptr_t)addr < (uintptr_t)addr_cache || offset >= AC_NUM_ENTRIES)
         return false;
     ac_entry *oldpage = ac_commit_list[ac_commit_index];
     if (oldpage) {
-        //printf("Freeing %p, ", oldpage);
         os_sparse_decommit(oldpage, AC_PAGE_SIZE);
-        ac_commit_map[offset / (AC_PAGE_SIZE / sizeof(ac_entry))] = 0;
+        ac_committed_pages--;
     }
-    //printf("Committing %p\n", page);
+    ac_commit_list[ac_commit_index] = NULL;
     if (!os_sparse_commit(page, AC_PAGE_SIZE))
         return false;
-    ac_commit_map[offset / (AC_PAGE_SIZE / sizeof(ac_entry))] = 1;
 
     uint32_t i;
     for (i = 0; i < (AC_PAGE_SIZE / sizeof(ac_entry)); i++)
@@ -241,9 +246,20 @@ bool addr_cache_pagefault(void *addr) {
 
     ac_commit_list[ac_commit_index] = page;
     ac_commit_index = (ac_commit_index + 1) % AC_COMMIT_MAX;
+    ac_committed_pages++;
     return true;
 }
 
+void addr_cache_pagefault_reset(void) {
+    memset(ac_commit_list, 0, sizeof(ac_commit_list));
+    ac_commit_index = 0;
+    ac_committed_pages = 0;
+}
+
+uint32_t addr_cache_committed_pages(void) {
+    return ac_committed_pages;
+}
+
 #endif
 
 void *addr_cache_miss(uint32_t virt, bool writing, fault_proc *fault) {
@@ -267,23 +283,122 @@ void *addr_cache_miss(uint32_t virt, bool writing, fault_proc *fault) {
     return ptr;
 }
 
-void addr_cache_flush(void) {
-#if !defined(EMU_NO_SAFETY)
-   icacheInval(&pxa260CpuState.ic);//icache needs to be flushed when MMU state changes
-#endif
+static void addr_cache_invalidate_all(void) {
+    for (unsigned int i = 0; i < AC_VALID_MAX; i++) {
+        uint32_t offset = ac_valid_list[i];
+        //	if (ac_commit_map[offset / (AC_PAGE_SIZE / sizeof(ac_entry))])
+        addr_cache_invalidate(offset);
+    }
+}
+
+static void addr_cache_flush_translations(void) {
+    flush_translations();
+    memset(mmu_translated_sections, 0, sizeof(mmu_translated_sections));
+}
+
+static uint32_t *mmu_get_translation_table(void) {
+    uint32_t *table = phys_mem_ptr(arm.translation_table_base, 0x4000);
+    if (!table)
+        error("Bad translation table base register: %x", arm.translation_table_base);
+    return table;
+}
+
+/* Reload one entry of the TLB copy, returns true if translated code in it may now be mapped elsewhere */
+static bool mmu_reload_section(uint32_t section, const uint32_t *table) {
+    uint32_t old_entry = mmu_translation_table[section];
+    uint32_t new_entry = table[section];
+
+    mmu_translation_table[section] = new_entry;
+    if (!(mmu_translated_sections[section >> 5] & 1u << (section & 31)))
+        return false;
+
+    /* Page tables are read from memory on every walk, so they may have changed without the entry changing */
+    if ((new_entry & 3) != 2)
+        return true;
+    return (old_entry ^ new_entry) & 0xFFF00003;
+}
+
+void mmu_mark_translated(uint32_t addr) {
+    mmu_translated_sections[addr >> 25] |= 1u << (addr >> 20 & 31);
+}
+
+void addr_cache_flush_entry(uint32_t addr) {
+    uint32_t section = addr >> 20;
+    bool remapped = false;
+
+    if(pxa260UsingUarm)
+        icacheInval(&pxa260CpuState.ic);
+
+    if (arm.control & 1)
+        remapped = mmu_reload_section(section, mmu_get_translation_table());
+
+    // Only the section containing the entry can have changed
+    for (unsigned int i = 0; i < AC_VALID_MAX; i++) {
+        uint32_t offset = ac_valid_list[i];
+        if (offset >> 11 == section)
+            addr_cache_invalidate(offset);
+    }
+
+    if (remapped)
+        addr_cache_flush_translations();
+}
+
+void addr_cache_flush_tlb(void) {
+    bool remapped = false;
+
+    if(pxa260UsingUarm)
+        icacheInval(&pxa260CpuState.ic);
 
     if (arm.control & 1) {
-        void *table = phys_mem_ptr(arm.translation_table_base, 0x4000);
-        if (!table)
-            error("Bad translation table base register: %x", arm.translation_table_base);
-        memcpy(mmu_translation_table, table, 0x4000);
+        uint32_t *table = mmu_get_translation_table();
+        for (uint32_t section = 0; section < 0x1000; section++)
+            remapped |= mmu_reload_section(section, table);
     }
 
+    addr_cache_invalidate_all();
+
+    if (remapped)
+        addr_cache_flush_translations();
+}
+
+void addr_cache_flush_domains(uint32_t old_domain_access_control) {
+    uint32_t changed = old_domain_access_control ^ arm.domain_access_control;
+
+    if (!changed || !(arm.control & 1))
+        return;
+
+    if(pxa260UsingUarm)
+        icacheInval(&pxa260CpuState.ic);
+
+    // Domains only change permissions, drop the entries in sections using a changed domain
     for (unsigned int i = 0; i < AC_VALID_MAX; i++) {
         uint32_t offset = ac_valid_list[i];
-        //	if (ac_commit_map[offset / (AC_PAGE_SIZE / sizeof(ac_entry))])
-        addr_cache_invalidate(offset);
+        uint32_t domain = mmu_translation_table[offset >> 11] >> 5 & 0x0F;
+        if (changed >> (domain << 1) & 3)
+            addr_cache_invalidate(offset);
     }
+}
 
-    flush_translations();
+void addr_cache_flush_permissions(void) {
+    if(pxa260UsingUarm)
+        icacheInval(&pxa260CpuState.ic);
+
+    addr_cache_invalidate_all();
+}
+
+void mmu_flush_icache(void) {
+    // Writes to translated code are already caught by write_action, only uARM caches instructions
+    if(pxa260UsingUarm)
+        icacheInval(&pxa260CpuState.ic);
+}
+
+void addr_cache_flush(void) {
+    if(pxa260UsingUarm)
+        icacheInval(&pxa260CpuState.ic);//icache needs to be flushed when MMU state changes
+
+    if (arm.control & 1)
+        memcpy(mmu_translation_table, mmu_get_translation_table(), 0x4000);
+
+    addr_cache_invalidate_all();
+    addr_cache_flush_translations();
 }
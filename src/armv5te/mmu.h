@@ -66,9 +66,21 @@ extern ac_entry *addr_cache __asm__("addr_cache");
             entry = (ac_entry)(AC_INVALID | AC_NOT_PTR);
 #endif
 
+// addr_cache_pagefault commits one host page at a time, hosts with larger pages commit everything up front
+#define AC_PAGE_SIZE 4096
 bool addr_cache_pagefault(void *addr);
+void addr_cache_pagefault_reset(void);
+uint32_t addr_cache_committed_pages(void);
+size_t addr_cache_committed_bytes(void);
 void *addr_cache_miss(uint32_t addr, bool writing, fault_proc *fault) __asm__("addr_cache_miss");
 void addr_cache_flush(void);
+/* Targeted versions of addr_cache_flush, translations are only dropped if translated code was remapped */
+void addr_cache_flush_entry(uint32_t addr);
+void addr_cache_flush_tlb(void);
+void addr_cache_flush_domains(uint32_t old_domain_access_control);
+void addr_cache_flush_permissions(void);
+void mmu_flush_icache(void);
+void mmu_mark_translated(uint32_t addr);
 void mmu_dump_tables(void);
 
 #ifdef __cplusplus
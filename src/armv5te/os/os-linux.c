@@ -4,7 +4,9 @@
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <signal.h>
 #include <stdio.h>
+#include <string.h>
 #include <unistd.h>
 #ifdef __APPLE__
     #include <mach/clock.h>
@@ -15,6 +17,10 @@
     #define MAP_32BIT 0
 #endif
 
+#ifndef MAP_NORESERVE
+    #define MAP_NORESERVE 0
+#endif
+
 #include "os.h"
 #include "../debug.h"
 #include "../mmu.h"
@@ -66,6 +72,99 @@ void os_free(void *ptr, size_t size)
         munmap(ptr, size);
 }
 
+void *os_reserve_sparse(size_t size)
+{
+#ifdef __i386__
+    // Has to have bit 31 zero
+    void *ptr = mmap((void*)0x70000000, size, PROT_NONE, MAP_PRIVATE|MAP_ANON|MAP_NORESERVE|MAP_32BIT, -1, 0);
+#else
+    void *ptr = mmap((void*)0, size, PROT_NONE, MAP_PRIVATE|MAP_ANON|MAP_NORESERVE, -1, 0);
+#endif
+
+    if(ptr == MAP_FAILED)
+        return NULL;
+
+    return ptr;
+}
+
+void os_free_sparse(void *ptr, size_t size)
+{
+    if(ptr)
+        munmap(ptr, size);
+}
+
+void *os_commit(void *addr, size_t size)
+{
+    return mprotect(addr, size, PROT_READ|PROT_WRITE) == 0 ? addr : NULL;
+}
+
+void *os_commit_readonly(void *addr, size_t size)
+{
+    // Reads of untouched pages all share the zero page
+    return mprotect(addr, size, PROT_READ) == 0 ? addr : NULL;
+}
+
+void *os_sparse_commit(void *page, size_t size)
+{
+    return os_commit(page, size);
+}
+
+void os_sparse_decommit(void *page, size_t size)
+{
+    // Mapping over the page drops its contents
+    mmap(page, size, PROT_NONE, MAP_PRIVATE|MAP_ANON|MAP_NORESERVE|MAP_FIXED, -1, 0);
+}
+
+static struct sigaction old_sigsegv, old_sigbus;
+
+static void pagefault_handler(int sig, siginfo_t *info, void *context)
+{
+    if(addr_cache && addr_cache_pagefault(info->si_addr))
+        return; // Retry the access
+
+    // Not ours, pass it on or let the access fault again without this handler
+    struct sigaction *old = sig == SIGBUS ? &old_sigbus : &old_sigsegv;
+    if(old->sa_flags & SA_SIGINFO)
+        old->sa_sigaction(sig, info, context);
+    else if(old->sa_handler != SIG_DFL && old->sa_handler != SIG_IGN)
+        old->sa_handler(sig);
+    else
+        sigaction(sig, old, NULL);
+}
+
+static void install_pagefault_handler(void)
+{
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_sigaction = pagefault_handler;
+    sa.sa_flags = SA_SIGINFO | SA_NODEFER;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGSEGV, &sa, &old_sigsegv);
+    // Some systems report PROT_NONE accesses as SIGBUS
+    sigaction(SIGBUS, &sa, &old_sigbus);
+}
+
+static void remove_pagefault_handler(int sig, struct sigaction *old)
+{
+    struct sigaction current;
+
+    // Anything installed after us chains to us or replaced us, restoring the old handler would drop it
+    sigaction(sig, NULL, &current);
+    if((current.sa_flags & SA_SIGINFO) && current.sa_sigaction == pagefault_handler)
+        sigaction(sig, old, NULL);
+}
+
+void os_faulthandler_arm(os_exception_frame_t *frame)
+{
+    // The signal handler is active for as long as addr_cache is demand paged
+    (void) frame;
+}
+
+void os_faulthandler_unarm(os_exception_frame_t *frame)
+{
+    (void) frame;
+}
+
 void *os_alloc_executable(size_t size)
 {
 #if defined(__i386__) || defined(__x86_64__)
@@ -90,31 +189,47 @@ __attribute__((unused)) static void make_writable(void *addr)
         emuprintf("mprotect failed.\n");
 }
 
-void addr_cache_init()
+static bool addr_cache_sparse;
+
+void addr_cache_init(bool demand_paging)
 {
     // Only run this if not already initialized
     if(addr_cache)
         return;
 
-    addr_cache = mmap((void*)0, AC_NUM_ENTRIES * sizeof(ac_entry), PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANON, -1, 0);
-    if(addr_cache == MAP_FAILED)
+    // addr_cache_pagefault commits whole host pages
+    if(demand_paging && sysconf(_SC_PAGE_SIZE) == AC_PAGE_SIZE)
     {
-        addr_cache = NULL;
-        fprintf(stderr, "Failed to mmap addr_cache.\n");
-        exit(1);
+        // Pages are committed and invalidated by addr_cache_pagefault when first touched
+        addr_cache = os_reserve_sparse(AC_NUM_ENTRIES * sizeof(ac_entry));
+        if(addr_cache)
+        {
+            addr_cache_sparse = true;
+            install_pagefault_handler();
+        }
     }
 
-    setbuf(stdout, NULL);
-
-    #if !defined(AC_FLAGS)
-        unsigned int i;
-        for(unsigned int i = 0; i < AC_NUM_ENTRIES; ++i)
+    if(!addr_cache)
+    {
+        addr_cache = mmap((void*)0, AC_NUM_ENTRIES * sizeof(ac_entry), PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANON, -1, 0);
+        if(addr_cache == MAP_FAILED)
         {
-            AC_SET_ENTRY_INVALID(addr_cache[i], (i >> 1) << 10)
+            addr_cache = NULL;
+            fprintf(stderr, "Failed to mmap addr_cache.\n");
+            exit(1);
         }
-    #else
-        memset(addr_cache, 0xFF, AC_NUM_ENTRIES * sizeof(ac_entry));
-    #endif
+
+        #if !defined(AC_FLAGS)
+            for(unsigned int i = 0; i < AC_NUM_ENTRIES; ++i)
+            {
+                AC_SET_ENTRY_INVALID(addr_cache[i], (i >> 1) << 10)
+            }
+        #else
+            memset(addr_cache, 0xFF, AC_NUM_ENTRIES * sizeof(ac_entry));
+        #endif
+    }
+
+    setbuf(stdout, NULL);
 
     #if defined(__i386__) && !defined(NO_TRANSLATION)
         // Relocate the assembly code that wants addr_cache at a fixed address
@@ -129,8 +244,35 @@ void addr_cache_init()
 
 void addr_cache_deinit()
 {
-    if(addr_cache)
-        munmap(addr_cache, AC_NUM_ENTRIES * sizeof(ac_entry));
+    if(!addr_cache)
+        return;
+
+    #if defined(__i386__) && !defined(NO_TRANSLATION)
+        // Undo the relocations
+        extern uint32_t *ac_reloc_start[] __asm__("ac_reloc_start"), *ac_reloc_end[] __asm__("ac_reloc_end");
+        for(uint32_t **reloc = ac_reloc_start; reloc != ac_reloc_end; reloc++)
+            **reloc -= (uintptr_t)addr_cache;
+    #endif
 
+    if(addr_cache_sparse)
+    {
+        remove_pagefault_handler(SIGSEGV, &old_sigsegv);
+        remove_pagefault_handler(SIGBUS, &old_sigbus);
+        addr_cache_pagefault_reset();
+        addr_cache_sparse = false;
+    }
+
+    munmap(addr_cache, AC_NUM_ENTRIES * sizeof(ac_entry));
     addr_cache = NULL;
 }
+
+size_t addr_cache_committed_bytes()
+{
+    if(!addr_cache)
+        return 0;
+
+    if(addr_cache_sparse)
+        return (size_t)addr_cache_committed_pages() * AC_PAGE_SIZE;
+
+    return AC_NUM_ENTRIES * sizeof(ac_entry);
+}
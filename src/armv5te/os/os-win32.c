@@ -23,12 +23,29 @@ void os_free(void *ptr, size_t size)
     VirtualFree(ptr, 0, MEM_RELEASE);
 }
 
-#if OS_HAS_PAGEFAULT_HANDLER
+void *os_reserve_sparse(size_t size)
+{
+    // The SEH frame is only armed while the CPU runs, so memory touched elsewhere has to be committed
+    (void) size;
+    return NULL;
+}
+
+void os_free_sparse(void *ptr, size_t size)
+{
+    os_free(ptr, size);
+}
+
 void *os_commit(void *addr, size_t size)
 {
     return VirtualAlloc(addr, size, MEM_COMMIT, PAGE_READWRITE);
 }
 
+void *os_commit_readonly(void *addr, size_t size)
+{
+    return VirtualAlloc(addr, size, MEM_COMMIT, PAGE_READONLY);
+}
+
+#if OS_HAS_PAGEFAULT_HANDLER
 void *os_sparse_commit(void *page, size_t size)
 {
     return VirtualAlloc(page, size, MEM_COMMIT, PAGE_READWRITE);
@@ -57,7 +74,10 @@ static int addr_cache_exception(PEXCEPTION_RECORD er, void *x, void *y, void *z)
 }
 #endif
 
-void addr_cache_init() {
+void addr_cache_init(bool demand_paging) {
+    // Every entry is written below, so there is nothing to gain from it here
+    (void) demand_paging;
+
     // Don't run more than once
     if(addr_cache)
         return;
@@ -129,6 +149,17 @@ void addr_cache_deinit() {
         **reloc -= (DWORD)addr_cache;
 #endif
 
+#if OS_HAS_PAGEFAULT_HANDLER
+    addr_cache_pagefault_reset();
+#endif
+
     VirtualFree(addr_cache, 0, MEM_RELEASE);
     addr_cache = NULL;
 }
+
+size_t addr_cache_committed_bytes() {
+    if(!addr_cache)
+        return 0;
+
+    return AC_NUM_ENTRIES * sizeof(ac_entry);
+}
@@ -3,6 +3,7 @@
 
 #include <stdlib.h>
 #include <stdint.h>
+#include <stdbool.h>
 #include <stdio.h>
 
 #ifdef __cplusplus
@@ -13,31 +14,43 @@ extern "C" {
 int iOS_is_debugger_attached();
 #endif
 
-#if !defined(__x86_64__) && !defined(NO_TRANSLATION) && (defined(_WIN32) || defined(WIN32))
+#if defined(_WIN32) || defined(WIN32)
+#if !defined(__x86_64__) && !defined(NO_TRANSLATION)
 #define OS_HAS_PAGEFAULT_HANDLER 1
 #else
 #define OS_HAS_PAGEFAULT_HANDLER 0
 #endif
+#else
+// Faults can be handled with a process wide SIGSEGV handler, it is only installed when asked for
+#define OS_HAS_PAGEFAULT_HANDLER 1
+#endif
 
 void *os_reserve(size_t size);
+// Reserves address space without committing it, returns NULL if the host can't do that
+void *os_reserve_sparse(size_t size);
+void os_free_sparse(void *ptr, size_t size);
+// Explicitly commits part of a sparse reservation, the host still only backs pages once they are touched
+void *os_commit(void *addr, size_t size);
+void *os_commit_readonly(void *addr, size_t size);
 void *os_alloc_executable(size_t size);
 void os_free(void *ptr, size_t size);
 
 #if OS_HAS_PAGEFAULT_HANDLER
 // The Win32 mechanism to handle pagefaults uses SEH, which requires a linked
 // list of handlers on the stack. The frame has to stay alive on the stack and
-// armed during all addr_cache accesses.
+// armed during all addr_cache accesses. Elsewhere arming does nothing.
 
 typedef struct { void *prev, *function; } os_exception_frame_t;
 void os_faulthandler_arm(os_exception_frame_t *frame);
 void os_faulthandler_unarm(os_exception_frame_t *frame);
 
-void *os_commit(void *addr, size_t size);
 void *os_sparse_commit(void *page, size_t size);
 void os_sparse_decommit(void *page, size_t size);
 #endif
 
-void addr_cache_init();
+// With demand_paging addr_cache pages are committed by addr_cache_pagefault, on POSIX hosts
+// that takes over SIGSEGV and SIGBUS so only hosts that never install their own handler may ask for it
+void addr_cache_init(bool demand_paging);
 void addr_cache_deinit();
 
 #ifdef __cplusplus
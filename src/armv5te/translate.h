@@ -25,6 +25,10 @@ void translate(uint32_t start_pc, uint32_t *insnp);
 void flush_translations();
 void invalidate_translation(int index);
 void translate_fix_pc();
+/* ROM translations that can be saved and installed again by a later run, only the x86_64 translator keeps them */
+uint32_t translate_cache_size();
+bool translate_cache_save(uint8_t *data, uint32_t size);
+bool translate_cache_load(const uint8_t *data, uint32_t size);
 
 #ifdef __cplusplus
 }
@@ -219,6 +219,21 @@ void translate_deinit()
 	translate_current = translate_buffer = nullptr;
 }
 
+uint32_t translate_cache_size()
+{
+	return 0;
+}
+
+bool translate_cache_save(uint8_t *data, uint32_t size)
+{
+	return false;
+}
+
+bool translate_cache_load(const uint8_t *data, uint32_t size)
+{
+	return false;
+}
+
 void translate(uint32_t pc_start, uint32_t *insn_ptr_start)
 {
 	if(next_translation_index >= MAX_TRANSLATIONS)
@@ -762,6 +777,7 @@ void translate(uint32_t pc_start, uint32_t *insn_ptr_start)
 			cond_branch = nullptr;
 		}
 
+		mem_flags_commit(insn_ptr);
 		RAM_FLAGS(insn_ptr) |= (RF_CODE_TRANSLATED | next_translation_index << RFS_TRANSLATION_INDEX);
 
 		++jump_table_current;
@@ -772,6 +788,7 @@ void translate(uint32_t pc_start, uint32_t *insn_ptr_start)
 	unimpl:
 	// Throw away partial translation
 	translate_current = *jump_table_current;
+	mem_flags_commit(insn_ptr);
 	RAM_FLAGS(insn_ptr) |= RF_CODE_NO_TRANSLATE;
 
 	exit_translation:
@@ -477,6 +477,21 @@ void translate_deinit()
     translate_end = translate_current = translate_buffer = nullptr;
 }
 
+uint32_t translate_cache_size()
+{
+    return 0;
+}
+
+bool translate_cache_save(uint8_t *data, uint32_t size)
+{
+    return false;
+}
+
+bool translate_cache_load(const uint8_t *data, uint32_t size)
+{
+    return false;
+}
+
 /*
 static __attribute__((unused)) void dump_translation(int index)
 {
@@ -1039,6 +1054,7 @@ void translate(uint32_t pc_start, uint32_t *insn_ptr_start)
             unimpl:
             // There may be a partial translation in memory, scrap it.
             translate_current = translate_buffer_inst_start;
+            mem_flags_commit(insn_ptr);
             RAM_FLAGS(insn_ptr) |= RF_CODE_NO_TRANSLATE;
 
             break;
@@ -1057,7 +1073,10 @@ void translate(uint32_t pc_start, uint32_t *insn_ptr_start)
         }
 
         if(can_jump_here)
+        {
+            mem_flags_commit(insn_ptr);
             RAM_FLAGS(insn_ptr) |= (RF_CODE_TRANSLATED | next_translation_index << RFS_TRANSLATION_INDEX);
+        }
         // else just don't set it. When the CPU jumps to it, it'll be treated as new basic block
 
         ++jump_table_current;
@@ -253,6 +253,21 @@ void translate_deinit()
     insn_buffer = NULL;
 }
 
+uint32_t translate_cache_size()
+{
+    return 0;
+}
+
+bool translate_cache_save(uint8_t *data, uint32_t size)
+{
+    return false;
+}
+
+bool translate_cache_load(const uint8_t *data, uint32_t size)
+{
+    return false;
+}
+
 void translate(uint32_t start_pc, uint32_t *start_insnp) {
     out = insn_bufptr;
     outj = jtbl_bufptr;
@@ -924,6 +939,7 @@ data_proc_done:
             cond_jmp_offset[-1] = out - cond_jmp_offset;
         }
 
+        mem_flags_commit(insnp);
         RAM_FLAGS(insnp) |= (RF_CODE_TRANSLATED | next_index << RFS_TRANSLATION_INDEX);
         pc += 4;
         insnp++;
@@ -938,6 +954,7 @@ data_proc_done:
     }
 unimpl:
     out = insn_start;
+    mem_flags_commit(insnp);
     RAM_FLAGS(insnp) |= RF_CODE_NO_TRANSLATE;
 branch_conditional:
     emit_mov_x86reg_immediate(EAX, pc);
@@ -1,7 +1,9 @@
 #include <assert.h>
+#include <string.h>
 
 #include "emu.h"
 #include "mem.h"
+#include "mmu.h"
 #include "cpu.h"
 #include "asmcode.h"
 #include "translate.h"
@@ -15,17 +17,114 @@ extern uintptr_t arm_shift_proc[2][4] __asm__("arm_shift_proc");
 void **in_translation_rsp __asm__("in_translation_rsp");
 void *in_translation_pc_ptr __asm__("in_translation_pc_ptr");
 
+// Uncomment the following line to store every flag result immediately, to compare against lazy flags
+// #define EAGER_FLAGS
+
 #define MAX_TRANSLATIONS 262144
 struct translation translation_table[MAX_TRANSLATIONS];
 
-static int next_index = 0;
+#define JTBL_ENTRIES 500000
+
+/* ROM code is never written, so its translations get their own part of the
+ * buffers and survive the flushes caused by modified RAM code. Only remapping
+ * translated code (flush_translations) drops them. */
+#define ROM_TRANSLATIONS (MAX_TRANSLATIONS / 4)
+#define ROM_INSN_BUFFER_SIZE (INSN_BUFFER_SIZE / 4)
+#define ROM_JTBL_ENTRIES (JTBL_ENTRIES / 4)
+
+// Space a single block may need, an arena with less left is flushed before translating
+#define MAX_BLOCK_INSN_SIZE 0x10000
+#define MAX_BLOCK_JTBL_ENTRIES 0x400
+
+struct translation_arena {
+    int first_index, next_index, end_index;
+    uint8_t *insn_start, *insn_ptr, *insn_end;
+    uint8_t **jtbl_start, **jtbl_ptr, **jtbl_end;
+};
+
 uint8_t *insn_buffer = NULL;
-uint8_t *insn_bufptr = NULL;
-static uint8_t *jtbl_buffer[500000];
-static uint8_t **jtbl_bufptr = jtbl_buffer;
+static uint8_t *jtbl_buffer[JTBL_ENTRIES];
+static struct translation_arena rom_arena, ram_arena;
 static uint8_t *out;
 static uint8_t **outj;
 
+/* ROM translations also outlive the session: each ROM block is recorded with
+ * relocations for everything absolute it contains (the rel32 helper calls and
+ * addr_cache) so it can be saved, and copied back in when the same block is
+ * translated on a later boot. The virtual PCs it was translated at are baked
+ * in, so blocks are looked up by PC as well as by ROM offset.
+ * Bump the version whenever the code emitted for any instruction changes. */
+#ifndef EAGER_FLAGS
+#define TRANSLATION_CACHE_VERSION 1
+#else
+#define TRANSLATION_CACHE_VERSION 0x80000001
+#endif
+#define TRANSLATION_CACHE_MAGIC 0x4354754D // "MuTC"
+#define TRANSLATION_CACHE_MAX_SIZE 0x1000000
+#define MAX_BLOCK_RELOCS 0x1000
+
+enum { RELOC_HELPER, RELOC_ADDR_CACHE };
+struct cache_reloc {
+    uint32_t offset;
+    uint16_t type, helper;
+};
+
+struct cache_block {
+    uint32_t start_pc, rom_offset;
+    uint32_t insn_hash; // Of the ARM code, a block is only reused if that is unchanged
+    uint16_t insn_count, reloc_count;
+    uint32_t code_size;
+    // Followed by insn_count jump table offsets, the relocations and the code, padded to 4 bytes
+};
+
+struct cache_header {
+    uint32_t magic, version;
+    uint64_t rom_hash;
+    uint32_t rom_size, arm_size;
+    uint32_t block_count, data_size;
+    uint32_t data_hash;
+};
+
+#define HELPER_COUNT 21
+static uintptr_t helpers[HELPER_COUNT];
+static uint8_t *block_start;
+static struct cache_reloc block_relocs[MAX_BLOCK_RELOCS];
+static int block_reloc_count; // -1 if the block can't be recorded
+static bool block_recording;
+
+static uint8_t *cache_data;
+static uint32_t cache_data_size, cache_data_capacity, cache_block_count;
+static uint32_t *cache_index; // Open addressing on ROM offset and PC, block offset + 1, 0 is empty
+static uint32_t cache_index_size;
+static uint64_t cache_rom_hash;
+static bool cache_rom_hashed;
+
+static void record_reloc(int type, uintptr_t target) {
+    int helper = 0;
+
+    if (!block_recording || block_reloc_count < 0)
+        return;
+
+    if (type == RELOC_HELPER) {
+        while (helper < HELPER_COUNT && helpers[helper] != target)
+            helper++;
+        if (helper == HELPER_COUNT) {
+            block_reloc_count = -1;
+            return;
+        }
+    }
+
+    if (block_reloc_count == MAX_BLOCK_RELOCS) {
+        block_reloc_count = -1;
+        return;
+    }
+
+    block_relocs[block_reloc_count].offset = out - block_start;
+    block_relocs[block_reloc_count].type = type;
+    block_relocs[block_reloc_count].helper = helper;
+    block_reloc_count++;
+}
+
 #define REG_ARG1 EDI
 #define REG_ARG2 ESI
 
@@ -42,12 +141,14 @@ enum { JO = 0x70, JNO, JB,  JAE, JZ, JNZ, JBE, JA,
 static inline void emit_byte(uint8_t b)    { *out++ = b; }
 static inline void emit_word(uint16_t w)   { *(uint16_t *)out = w; out += 2; }
 static inline void emit_dword(uint32_t dw) { *(uint32_t *)out = dw; out += 4; }
+static inline void emit_qword(uint64_t qw) { *(uint64_t *)out = qw; out += 8; }
 
 /*This is a hack:
  * -regs not saved
  * -stack not aligned */
 static inline void emit_call_nosave(uintptr_t target) {
     emit_byte(0xE8);
+    record_reloc(RELOC_HELPER, target);
     int64_t diff = target - ((uintptr_t) out + 4);
     if(diff > INT32_MAX || diff < INT32_MIN)
         assert(false); //Distance doesn't fit into immediate
@@ -78,6 +179,7 @@ static inline void emit_call(uintptr_t target) {
 
 static inline void emit_jump(uintptr_t target) {
     emit_byte(0xE9);
+    record_reloc(RELOC_HELPER, target);
     int64_t diff = target - ((uintptr_t) out + 4);
     if(diff > INT32_MAX || diff < INT32_MIN)
         assert(false);
@@ -267,12 +369,299 @@ static inline void emit_setcc_flag(int setcc, void *flagptr) {
     emit_modrm_base_offset(0, EBX, (uint8_t *)flagptr - (uint8_t *)&arm);
 }
 
+/* Memory access with the address in REG_ARG1 (and the value in REG_ARG2 for writes).
+ * Pointer entries in addr_cache are handled inline, only misses (MMIO, faults)
+ * and writes that need write_action call out. Clobbers EAX and R8 like the *_asm functions. */
+enum { ACCESS_BYTE, ACCESS_HALF, ACCESS_WORD };
+static void emit_memory_access(int size, bool is_write, bool inline_lookup) {
+    static const uintptr_t slow_path[2][3] = {
+        { (uintptr_t)read_byte_asm, (uintptr_t)read_half_asm, (uintptr_t)read_word_asm },
+        { (uintptr_t)write_byte_asm, (uintptr_t)write_half_asm, (uintptr_t)write_word_asm }
+    };
+    uint8_t *miss_offset, *done_offset, *action_done_offset = NULL;
+
+    if (!inline_lookup) {
+        emit_call_nosave(slow_path[is_write][size]);
+        return;
+    }
+
+    if (size == ACCESS_HALF)
+        emit_alu_x86reg_immediate(AND, REG_ARG1, -2);
+
+    // entry = addr_cache[(addr >> 10) << 1 | is_write]
+    emit_mov_x86reg_x86reg(EAX, REG_ARG1);
+    emit_shift_x86reg(SHR, EAX, 10);
+    emit_alu_x86reg_x86reg(ADD, EAX, EAX);
+    emit_word(0xB849); // mov r8, imm64
+    record_reloc(RELOC_ADDR_CACHE, 0);
+    emit_qword((uintptr_t)addr_cache);
+    emit_word(0x8B49); // mov rax, [r8 + rax * 8 + is_write * 8]
+    if (is_write) {
+        emit_word(0xC044);
+        emit_byte(8);
+    } else {
+        emit_word(0xC004);
+    }
+
+    // Not a pointer entry
+    emit_word(0x03A8); // test al, 3
+    emit_byte(JNZ);
+    emit_byte(0);
+    miss_offset = out;
+
+    if (!is_write) {
+        if (size == ACCESS_BYTE)
+            emit_word(0xB60F); // movzx eax, byte [rax + rdi]
+        else if (size == ACCESS_HALF)
+            emit_word(0xB70F); // movzx eax, word [rax + rdi]
+        else
+            emit_byte(0x8B); // mov eax, [rax + rdi]
+        emit_word(0x3804);
+    } else {
+        if (size == ACCESS_BYTE)
+            emit_word(0x8840); // mov [rax + rdi], sil
+        else if (size == ACCESS_HALF)
+            emit_word(0x8966); // mov [rax + rdi], si
+        else
+            emit_byte(0x89); // mov [rax + rdi], esi
+        emit_word(0x3834);
+
+        // The flags are per word, check those of the containing word
+        emit_dword(0x38048D4C); // lea r8, [rax + rdi]
+        emit_dword(0xFCE08349); // and r8, -4
+        emit_word(0xF641); // test byte [r8 + MEM_MAXSIZE], DO_WRITE_ACTION
+        emit_byte(0x80);
+        emit_dword(MEM_MAXSIZE);
+        emit_byte(DO_WRITE_ACTION);
+        emit_byte(JZ);
+        emit_byte(0);
+        action_done_offset = out;
+
+        emit_dword(0x383C8D48); // lea rdi, [rax + rdi]
+        emit_call((uintptr_t)write_action);
+    }
+    emit_byte(0xEB); // JMP rel8
+    emit_byte(0);
+    done_offset = out;
+
+    miss_offset[-1] = out - miss_offset;
+    emit_call_nosave(slow_path[is_write][size]);
+
+    done_offset[-1] = out - done_offset;
+    if (action_done_offset)
+        action_done_offset[-1] = out - action_done_offset;
+}
+
+/* Lazy flags: the N/Z/C/V results of an unconditional flag setting instruction
+ * stay in the x86 EFLAGS until the next instruction, which only stores the ones
+ * something later in the block may still read (see flags_liveness). */
+enum { FLAG_N = 1, FLAG_Z = 2, FLAG_C = 4, FLAG_V = 8 };
+static int pending_flags;
+static int pending_carry; // SETB or SETAE, depending on whether the x86 carry is a borrow
+
+static void emit_flush_flags(int flags) {
+    if (flags & FLAG_N)
+        emit_setcc_flag(SETS, &arm.cpsr_n);
+    if (flags & FLAG_Z)
+        emit_setcc_flag(SETZ, &arm.cpsr_z);
+    if (flags & FLAG_C)
+        emit_setcc_flag(pending_carry, &arm.cpsr_c);
+    if (flags & FLAG_V)
+        emit_setcc_flag(SETO, &arm.cpsr_v);
+}
+
+/* Flags insn needs in arm.cpsr_* and flags it always overwrites without reading
+ * them first. Anything that can leave the block (memory accesses, branches, calls)
+ * needs all of them, so does anything not recognized here. */
+static void flags_usage(uint32_t insn, int *used, int *killed) {
+    static const uint8_t cond_flags[7] = { FLAG_Z, FLAG_C, FLAG_N, FLAG_V, FLAG_Z | FLAG_C, FLAG_N | FLAG_V, FLAG_N | FLAG_Z | FLAG_V };
+    int cond = insn >> 28;
+    int op = insn >> 21 & 15;
+    int setcc = insn >> 20 & 1;
+
+    *used = FLAG_N | FLAG_Z | FLAG_C | FLAG_V;
+    *killed = 0;
+
+#ifndef EAGER_FLAGS
+    if (cond == 0xF)
+        return;
+
+    if ((insn & 0xE000090) == 0x0000090) {
+        if ((insn & 0xFC000F0) == 0x0000090) {
+            /* MUL, MLA */
+            *used = 0;
+            if (setcc)
+                *killed = FLAG_N | FLAG_Z;
+        } else if ((insn & 0xF9000F0) == 0x0800090) {
+            /* UMULL, UMLAL, SMULL, SMLAL without S */
+            *used = 0;
+        }
+    } else if ((insn & 0xD900000) == 0x1000000) {
+        /* CLZ is the only one of these not calling out or leaving the block */
+        if ((insn & 0xFFF0FF0) == 0x16F0F10)
+            *used = 0;
+    } else if ((insn & 0xC000000) == 0) {
+        /* Data processing */
+        int logical = (0xF303 >> op) & 1;
+
+        if ((insn >> 12 & 15) == 15 || (insn >> 16 & 15) == 15)
+            return;
+
+        *used = 0;
+        if (!(insn & 0x2000000)) {
+            int shift_type = insn >> 5 & 3;
+            if (insn & 0x10) {
+                /* The shift helper leaves the carry alone for a shift by 0 */
+                if (setcc && logical)
+                    *used |= FLAG_C;
+            } else if ((insn >> 7 & 31) == 0 && shift_type == 3) {
+                /* RRX */
+                *used |= FLAG_C;
+            }
+        }
+        /* ADC, SBC, RSC */
+        if (op >= 5 && op <= 7)
+            *used |= FLAG_C;
+
+        if (setcc) {
+            *killed = FLAG_N | FLAG_Z;
+            if (logical) {
+                /* Carry comes from the shifter (if at all) */
+                if (insn & 0x2000000) {
+                    if (insn >> 7 & 30)
+                        *killed |= FLAG_C;
+                } else if (!(insn & 0x10) && (insn & 15) != 15) {
+                    int shift_type = insn >> 5 & 3;
+                    if ((insn >> 7 & 31) != 0 || shift_type != 0)
+                        *killed |= FLAG_C;
+                }
+            } else {
+                *killed |= FLAG_C | FLAG_V;
+            }
+        }
+    }
+
+    if (cond != 0xE) {
+        /* Might not execute, so it can't be relied on to overwrite anything */
+        if (cond != 0xF)
+            *used |= cond_flags[cond >> 1];
+        *killed = 0;
+    }
+#else
+    (void) insn; (void) cond; (void) op; (void) setcc; (void) cond_flags;
+#endif
+}
+
+/* Backward liveness pass over the next count instructions (less if the block
+ * has to stop earlier), fills flags_live[i] with the flags instruction i may
+ * read from arm.cpsr_*. The end of the block reads them all.
+ * Returns the amount of instructions covered. */
+#define MAX_BLOCK_INSNS (0x400 / 4)
+static uint8_t flags_live[MAX_BLOCK_INSNS + 1];
+
+static int flags_liveness(uint32_t start_pc, uint32_t *start_insnp, int count) {
+    uint8_t used[MAX_BLOCK_INSNS], killed[MAX_BLOCK_INSNS];
+    uint32_t pc = start_pc;
+    int index;
+
+    for (index = 0; index < count; index++, pc += 4) {
+        int insn_used, insn_killed;
+        if ((pc ^ start_pc) & ~0x3FF)
+            break;
+        if (RAM_FLAGS(start_insnp + index) & DONT_TRANSLATE)
+            break;
+        flags_usage(start_insnp[index], &insn_used, &insn_killed);
+        used[index] = insn_used;
+        killed[index] = insn_killed;
+    }
+    count = index;
+
+    flags_live[count] = FLAG_N | FLAG_Z | FLAG_C | FLAG_V;
+    for (index = count - 1; index >= 0; index--)
+        flags_live[index] = used[index] | (flags_live[index + 1] & ~killed[index]);
+
+    return count;
+}
+
+/* x86 jump to skip an instruction with condition cond, using the EFLAGS of
+ * the previous instruction directly. Returns -1 if they don't hold the flags needed. */
+static int native_skip_jcc(int cond, int native_flags) {
+#ifndef EAGER_FLAGS
+    static const uint8_t needed[7] = { FLAG_Z, FLAG_C, FLAG_N, FLAG_V, FLAG_Z | FLAG_C, FLAG_N | FLAG_V, FLAG_N | FLAG_Z | FLAG_V };
+    int jcc;
+
+    if (cond >= 0xE || (native_flags & needed[cond >> 1]) != needed[cond >> 1])
+        return -1;
+
+    switch (cond >> 1) {
+        case 0: jcc = JZ; break;
+        case 1: jcc = (pending_carry == SETB) ? JB : JAE; break;
+        case 2: jcc = JS; break;
+        case 3: jcc = JO; break;
+        case 4: /* HI: C & !Z */
+            if (pending_carry != SETAE)
+                return -1;
+            jcc = JA;
+            break;
+        case 5: jcc = JGE; break;
+        default: jcc = JG; break;
+    }
+    /* jcc executes the even condition, flip it for the odd one and once more to skip */
+    return jcc ^ (cond & 1) ^ 1;
+#else
+    (void) cond; (void) native_flags;
+    return -1;
+#endif
+}
+
 bool translate_init()
 {
     if(!insn_buffer)
     {
         insn_buffer = os_alloc_executable(INSN_BUFFER_SIZE);
-        insn_bufptr = insn_buffer;
+
+        rom_arena.first_index = rom_arena.next_index = 0;
+        rom_arena.end_index = ROM_TRANSLATIONS;
+        rom_arena.insn_start = rom_arena.insn_ptr = insn_buffer;
+        rom_arena.insn_end = insn_buffer + ROM_INSN_BUFFER_SIZE;
+        rom_arena.jtbl_start = rom_arena.jtbl_ptr = jtbl_buffer;
+        rom_arena.jtbl_end = jtbl_buffer + ROM_JTBL_ENTRIES;
+
+        ram_arena.first_index = ram_arena.next_index = ROM_TRANSLATIONS;
+        ram_arena.end_index = MAX_TRANSLATIONS;
+        ram_arena.insn_start = ram_arena.insn_ptr = rom_arena.insn_end;
+        ram_arena.insn_end = insn_buffer + INSN_BUFFER_SIZE;
+        ram_arena.jtbl_start = ram_arena.jtbl_ptr = rom_arena.jtbl_end;
+        ram_arena.jtbl_end = jtbl_buffer + JTBL_ENTRIES;
+    }
+
+    // Everything a block can call or jump to, relocations refer to these by index
+    helpers[0] = (uintptr_t)translation_next;
+    helpers[1] = (uintptr_t)translation_next_bx;
+    helpers[2] = (uintptr_t)read_byte_asm;
+    helpers[3] = (uintptr_t)read_half_asm;
+    helpers[4] = (uintptr_t)read_word_asm;
+    helpers[5] = (uintptr_t)write_byte_asm;
+    helpers[6] = (uintptr_t)write_half_asm;
+    helpers[7] = (uintptr_t)write_word_asm;
+    helpers[8] = (uintptr_t)write_action;
+    helpers[9] = (uintptr_t)get_cpsr;
+    helpers[10] = (uintptr_t)get_spsr;
+    helpers[11] = (uintptr_t)set_cpsr;
+    helpers[12] = (uintptr_t)set_spsr;
+    for (int i = 0; i < 8; i++)
+        helpers[13 + i] = arm_shift_proc[i >> 2][i & 3];
+
+    /* Helpers are reached with rel32 calls, when loaded as a shared library the
+       emulator may be mapped too far away from the buffer for that to work */
+    if(insn_buffer)
+    {
+        int64_t diff = (uintptr_t)translate_init - (uintptr_t)insn_buffer;
+        if(diff > INT32_MAX - INSN_BUFFER_SIZE || diff < INT32_MIN + INSN_BUFFER_SIZE)
+        {
+            translate_deinit();
+            return false;
+        }
     }
 
     return !!insn_buffer;
@@ -285,27 +674,335 @@ void translate_deinit()
 
     os_free(insn_buffer, INSN_BUFFER_SIZE);
     insn_buffer = NULL;
+
+    free(cache_data);
+    free(cache_index);
+    cache_data = NULL;
+    cache_index = NULL;
+    cache_data_size = cache_data_capacity = cache_block_count = cache_index_size = 0;
+    cache_rom_hashed = false;
+}
+
+static uint32_t cache_hash_insns(const uint32_t *insnp, int count) {
+    // 32 bit FNV-1a
+    uint32_t hash = 0x811C9DC5;
+    for (int i = 0; i < count; i++) {
+        hash ^= insnp[i];
+        hash *= 0x01000193;
+    }
+    return hash;
+}
+
+static uint64_t cache_get_rom_hash() {
+    if (!cache_rom_hashed) {
+        // 64 bit FNV-1a
+        uint64_t hash = UINT64_C(0xCBF29CE484222325);
+        for (uint32_t i = 0; i < mem_areas[0].size; i++) {
+            hash ^= mem_areas[0].ptr[i];
+            hash *= UINT64_C(0x00000100000001B3);
+        }
+        cache_rom_hash = hash;
+        cache_rom_hashed = true;
+    }
+    return cache_rom_hash;
+}
+
+static uint32_t cache_block_bytes(const struct cache_block *block) {
+    uint32_t size = sizeof(*block) + block->insn_count * sizeof(uint32_t) + block->reloc_count * sizeof(struct cache_reloc) + block->code_size;
+    return (size + 3) & ~3;
+}
+
+static uint32_t *cache_find_slot(uint32_t start_pc, uint32_t rom_offset) {
+    uint32_t slot = (rom_offset >> 2) * 0x9E3779B1u ^ start_pc;
+
+    // The index is never full, so this always ends at an empty slot or a match
+    while (1) {
+        slot &= cache_index_size - 1;
+        if (!cache_index[slot])
+            return &cache_index[slot];
+        struct cache_block *block = (struct cache_block *)(cache_data + cache_index[slot] - 1);
+        if (block->start_pc == start_pc && block->rom_offset == rom_offset)
+            return &cache_index[slot];
+        slot++;
+    }
+}
+
+static bool cache_index_add(uint32_t offset) {
+    struct cache_block *block = (struct cache_block *)(cache_data + offset);
+
+    if ((cache_block_count + 1) * 2 > cache_index_size) {
+        uint32_t *old_index = cache_index;
+        uint32_t old_size = cache_index_size;
+        uint32_t new_size = old_size ? old_size * 2 : 0x1000;
+        uint32_t *new_index = calloc(new_size, sizeof(uint32_t));
+        if (!new_index)
+            return false;
+        cache_index = new_index;
+        cache_index_size = new_size;
+        for (uint32_t i = 0; i < old_size; i++) {
+            if (old_index[i]) {
+                struct cache_block *old = (struct cache_block *)(cache_data + old_index[i] - 1);
+                *cache_find_slot(old->start_pc, old->rom_offset) = old_index[i];
+            }
+        }
+        free(old_index);
+    }
+
+    uint32_t *slot = cache_find_slot(block->start_pc, block->rom_offset);
+    if (*slot)
+        return false; // Already known
+    *slot = offset + 1;
+    cache_block_count++;
+    return true;
+}
+
+static void cache_record(uint32_t start_pc, uint32_t *start_insnp, int insn_count, uint8_t **jtbl) {
+    struct cache_block block;
+    uint32_t code_size = out - block_start;
+    uint32_t offset = cache_data_size;
+    uint32_t size;
+
+    if (block_reloc_count < 0 || code_size > MAX_BLOCK_INSN_SIZE)
+        return;
+
+    block.start_pc = start_pc;
+    block.rom_offset = (uint8_t *)start_insnp - mem_areas[0].ptr;
+    block.insn_hash = cache_hash_insns(start_insnp, insn_count);
+    block.insn_count = insn_count;
+    block.reloc_count = block_reloc_count;
+    block.code_size = code_size;
+    size = cache_block_bytes(&block);
+
+    if (cache_index_size && *cache_find_slot(block.start_pc, block.rom_offset))
+        return;
+    if (cache_data_size + size > TRANSLATION_CACHE_MAX_SIZE)
+        return;
+    if (cache_data_size + size > cache_data_capacity) {
+        uint32_t capacity = cache_data_capacity ? cache_data_capacity : 0x10000;
+        while (capacity < cache_data_size + size)
+            capacity *= 2;
+        uint8_t *data = realloc(cache_data, capacity);
+        if (!data)
+            return;
+        cache_data = data;
+        cache_data_capacity = capacity;
+    }
+
+    uint8_t *ptr = cache_data + offset;
+    memcpy(ptr, &block, sizeof(block));
+    ptr += sizeof(block);
+    for (int i = 0; i < insn_count; i++, ptr += sizeof(uint32_t))
+        *(uint32_t *)ptr = jtbl[i] - block_start;
+    memcpy(ptr, block_relocs, block_reloc_count * sizeof(struct cache_reloc));
+    ptr += block_reloc_count * sizeof(struct cache_reloc);
+    memcpy(ptr, block_start, code_size);
+
+    cache_data_size += size;
+    if (!cache_index_add(offset))
+        cache_data_size = offset;
+}
+
+/* Copies a recorded block into the arena, returns false if there is none that can be used */
+static bool cache_install(struct translation_arena *arena, uint32_t start_pc, uint32_t *start_insnp) {
+    if (!cache_block_count)
+        return false;
+
+    uint32_t slot = *cache_find_slot(start_pc, (uint8_t *)start_insnp - mem_areas[0].ptr);
+    if (!slot)
+        return false;
+
+    struct cache_block *block = (struct cache_block *)(cache_data + slot - 1);
+    const uint32_t *jtbl_offsets = (const uint32_t *)(block + 1);
+    const struct cache_reloc *relocs = (const struct cache_reloc *)(jtbl_offsets + block->insn_count);
+    const uint8_t *code = (const uint8_t *)(relocs + block->reloc_count);
+    uint8_t *dest = arena->insn_ptr;
+    int i;
+
+    // The translator would stop at these, and they may have changed since the block was recorded
+    for (i = 0; i < block->insn_count; i++)
+        if (RAM_FLAGS(start_insnp + i) & DONT_TRANSLATE)
+            return false;
+    if (cache_hash_insns(start_insnp, block->insn_count) != block->insn_hash)
+        return false;
+
+    memcpy(dest, code, block->code_size);
+    for (i = 0; i < block->reloc_count; i++) {
+        uint8_t *field = dest + relocs[i].offset;
+        if (relocs[i].type == RELOC_ADDR_CACHE) {
+            *(uint64_t *)field = (uintptr_t)addr_cache;
+        } else {
+            int64_t diff = helpers[relocs[i].helper] - ((uintptr_t)field + 4);
+            if (diff > INT32_MAX || diff < INT32_MIN)
+                return false;
+            *(int32_t *)field = diff;
+        }
+    }
+
+    mem_flags_commit(start_insnp);
+    int index = arena->next_index++;
+    for (i = 0; i < block->insn_count; i++) {
+        arena->jtbl_ptr[i] = dest + jtbl_offsets[i];
+        RAM_FLAGS(start_insnp + i) |= (RF_CODE_TRANSLATED | index << RFS_TRANSLATION_INDEX);
+    }
+
+    translation_table[index].jump_table = (void**) arena->jtbl_ptr;
+    translation_table[index].start_ptr  = start_insnp;
+    translation_table[index].end_ptr    = start_insnp + block->insn_count;
+
+    arena->insn_ptr += block->code_size;
+    arena->jtbl_ptr += block->insn_count;
+    return true;
+}
+
+uint32_t translate_cache_size() {
+    if (!cache_block_count)
+        return 0;
+    return sizeof(struct cache_header) + cache_data_size;
+}
+
+bool translate_cache_save(uint8_t *data, uint32_t size) {
+    struct cache_header header;
+
+    if (!cache_block_count || size < sizeof(header) + cache_data_size)
+        return false;
+
+    header.magic = TRANSLATION_CACHE_MAGIC;
+    header.version = TRANSLATION_CACHE_VERSION;
+    header.rom_hash = cache_get_rom_hash();
+    header.rom_size = mem_areas[0].size;
+    header.arm_size = sizeof(arm);
+    header.block_count = cache_block_count;
+    header.data_size = cache_data_size;
+    header.data_hash = cache_hash_insns((const uint32_t *)cache_data, cache_data_size / 4);
+    memcpy(data, &header, sizeof(header));
+    memcpy(data + sizeof(header), cache_data, cache_data_size);
+    return true;
+}
+
+bool translate_cache_load(const uint8_t *data, uint32_t size) {
+    struct cache_header header;
+    uint32_t offset;
+    uint32_t count;
+
+    if (!insn_buffer || size < sizeof(header))
+        return false;
+
+    memcpy(&header, data, sizeof(header));
+    if (header.magic != TRANSLATION_CACHE_MAGIC || header.version != TRANSLATION_CACHE_VERSION
+        || header.rom_size != mem_areas[0].size || header.arm_size != sizeof(arm)
+        || header.data_size != size - sizeof(header) || header.data_size > TRANSLATION_CACHE_MAX_SIZE
+        || header.rom_hash != cache_get_rom_hash())
+        return false;
+    data += sizeof(header);
+    if (header.data_size % 4 || header.data_hash != cache_hash_insns((const uint32_t *)data, header.data_size / 4))
+        return false;
+
+    // Check every block before taking any of them
+    for (offset = count = 0; offset < header.data_size; count++) {
+        const struct cache_block *block = (const struct cache_block *)(data + offset);
+        if (header.data_size - offset < sizeof(*block))
+            return false;
+        if (block->insn_count == 0 || block->insn_count > MAX_BLOCK_INSNS || block->code_size > MAX_BLOCK_INSN_SIZE
+            || block->reloc_count > MAX_BLOCK_RELOCS || block->rom_offset % 4
+            || block->rom_offset >= mem_areas[0].size || mem_areas[0].size - block->rom_offset < block->insn_count * 4u
+            || header.data_size - offset < cache_block_bytes(block))
+            return false;
+
+        const uint32_t *jtbl_offsets = (const uint32_t *)(block + 1);
+        const struct cache_reloc *relocs = (const struct cache_reloc *)(jtbl_offsets + block->insn_count);
+        for (int i = 0; i < block->insn_count; i++)
+            if (jtbl_offsets[i] >= block->code_size)
+                return false;
+        for (int i = 0; i < block->reloc_count; i++) {
+            if (relocs[i].type == RELOC_ADDR_CACHE ? relocs[i].offset + 8 > block->code_size
+                : relocs[i].type != RELOC_HELPER || relocs[i].helper >= HELPER_COUNT || relocs[i].offset + 4 > block->code_size)
+                return false;
+        }
+        offset += cache_block_bytes(block);
+    }
+    if (count != header.block_count)
+        return false;
+
+    uint8_t *copy = malloc(header.data_size);
+    if (!copy)
+        return false;
+    memcpy(copy, data, header.data_size);
+
+    free(cache_data);
+    free(cache_index);
+    cache_data = copy;
+    cache_data_size = cache_data_capacity = header.data_size;
+    cache_index = NULL;
+    cache_index_size = cache_block_count = 0;
+    for (offset = 0; offset < cache_data_size; offset += cache_block_bytes((struct cache_block *)(cache_data + offset)))
+        cache_index_add(offset);
+
+    return true;
+}
+
+static void flush_arena(struct translation_arena *arena) {
+    int index;
+    for (index = arena->first_index; index < arena->next_index; index++) {
+        uint32_t *start = translation_table[index].start_ptr;
+        uint32_t *end   = translation_table[index].end_ptr;
+        for (; start < end; start++)
+            RAM_FLAGS(start) &= ~(RF_CODE_TRANSLATED | (~0u << RFS_TRANSLATION_INDEX));
+    }
+    arena->next_index = arena->first_index;
+    arena->insn_ptr = arena->insn_start;
+    arena->jtbl_ptr = arena->jtbl_start;
+}
+
+static struct translation_arena *get_arena(uint32_t *insnp) {
+    // mem_areas[0] is the ROM
+    if ((uintptr_t)insnp - (uintptr_t)mem_areas[0].ptr < mem_areas[0].size)
+        return &rom_arena;
+    return &ram_arena;
 }
 
 void translate(uint32_t start_pc, uint32_t *start_insnp) {
-    out = insn_bufptr;
-    outj = jtbl_bufptr;
-    uint32_t pc = start_pc;
-    uint32_t *insnp = start_insnp;
+    struct translation_arena *arena = get_arena(start_insnp);
+    if (arena->next_index >= arena->end_index
+        || arena->insn_end - arena->insn_ptr < MAX_BLOCK_INSN_SIZE
+        || arena->jtbl_end - arena->jtbl_ptr < MAX_BLOCK_JTBL_ENTRIES)
+        flush_arena(arena);
+
+    block_recording = arena == &rom_arena;
+    if (block_recording) {
+        // The first ROM block runs before anything could have written to the ROM, hash it now
+        cache_get_rom_hash();
+        if (cache_install(arena, start_pc, start_insnp))
+            return;
+    }
 
-    if (next_index >= MAX_TRANSLATIONS)
-        error("too many translations");
+    uint32_t pc;
+    uint32_t *insnp;
 
     uint8_t *insn_start;
-    int stop_here = 0;
+    int stop_here;
+    int limit = flags_liveness(start_pc, start_insnp, MAX_BLOCK_INSNS);
+
+    // Blocks never cross a 1KB page, so one commit covers every flag set below
+    mem_flags_commit(start_insnp);
+
+retranslate:
+    out = block_start = arena->insn_ptr;
+    outj = arena->jtbl_ptr;
+    block_reloc_count = 0;
+    pc = start_pc;
+    insnp = start_insnp;
+    stop_here = 0;
+    pending_flags = 0;
     while (1) {
-        if (out >= &insn_buffer[INSN_BUFFER_SIZE - 1000])
+        if (out >= arena->insn_end - 1000)
             error("Out of instruction space");
-        if (outj >= &jtbl_buffer[sizeof jtbl_buffer / sizeof *jtbl_buffer])
+        if (outj >= arena->jtbl_end)
             error("Out of jump table space");
 
-        insn_start = out;
-
+        if (insnp - start_insnp == limit) {
+            /* End of what the flag liveness pass covered */
+            goto branch_conditional;
+        }
         if ((pc ^ start_pc) & ~0x3FF) {
             //printf("stopping translation - end of page\n");
             goto branch_conditional;
@@ -320,6 +1017,27 @@ void translate(uint32_t start_pc, uint32_t *start_insnp) {
         int cond = insn >> 28;
         int jcc = JZ;
         uint8_t *cond_jmp_offset = NULL;
+
+        /* Store the flags of the previous instruction that are still needed,
+         * the rest is overwritten before anything can see it */
+        int native_flags = pending_flags;
+        emit_flush_flags(pending_flags & flags_live[insnp - start_insnp]);
+        pending_flags = 0;
+
+        /* Coming from the previous instruction the condition can be checked on
+         * the EFLAGS, entering through the jump table it has to use arm.cpsr_* */
+        uint8_t *native_skip_offset = NULL, *native_jmp_offset = NULL;
+        int native_jcc = native_skip_jcc(cond, native_flags);
+        if (native_jcc >= 0) {
+            emit_byte(native_jcc);
+            emit_byte(0);
+            native_skip_offset = out;
+            emit_byte(0xEB); // JMP rel8
+            emit_byte(0);
+            native_jmp_offset = out;
+        }
+        insn_start = out;
+
         switch (cond >> 1) {
             case 0: /* EQ (Z), NE (!Z) */
                 emit_cmp_flag_immediate(&arm.cpsr_z, 0);
@@ -358,6 +1076,8 @@ void translate(uint32_t start_pc, uint32_t *start_insnp) {
         emit_byte(jcc ^ (cond & 1));
         emit_byte(0);
         cond_jmp_offset = out;
+        if (native_jmp_offset)
+            native_jmp_offset[-1] = out - native_jmp_offset;
 no_condition:
 
         if ((insn & 0xE000090) == 0x0000090) {
@@ -379,8 +1099,10 @@ no_condition:
                 if (insn & 0x0100000) {
                     if (!(insn & 0x0200000))
                         emit_test_x86reg_x86reg(EAX, EAX);
-                    emit_setcc_flag(SETS, &arm.cpsr_n);
-                    emit_setcc_flag(SETZ, &arm.cpsr_z);
+                    if (cond == 0xE)
+                        pending_flags = FLAG_N | FLAG_Z;
+                    else
+                        emit_flush_flags((FLAG_N | FLAG_Z) & flags_live[insnp - start_insnp + 1]);
                 }
             } else if ((insn & 0xF8000F0) == 0x0800090) {
                 /* UMULL, UMLAL, SMULL, SMLAL: 32x32 to 64 multiplications */
@@ -448,12 +1170,12 @@ no_condition:
 
                 if (is_load) {
                     if (type == SB) {
-                        emit_call_nosave((uintptr_t)read_byte_asm);
+                        emit_memory_access(ACCESS_BYTE, false, true);
                         // movsx eax,al
                         emit_word(0xBE0F);
                         emit_byte(0xC0);
                     } else {
-                        emit_call_nosave((uintptr_t)read_half_asm);
+                        emit_memory_access(ACCESS_HALF, false, true);
                         if (type == SH) {
                             // cwde
                             emit_byte(0x98);
@@ -462,7 +1184,7 @@ no_condition:
                     emit_mov_armreg_x86reg(data_reg, EAX);
                 } else {
                     emit_mov_x86reg_armreg(REG_ARG2, data_reg);
-                    emit_call_nosave((uintptr_t)write_half_asm);
+                    emit_memory_access(ACCESS_HALF, true, true);
                 }
 
                 if (post_index || pre_index)
@@ -775,16 +1497,22 @@ simple_shift:
             }
 data_proc_done:
             if (setcc) {
-                emit_setcc_flag(SETS, &arm.cpsr_n);
-                emit_setcc_flag(SETZ, &arm.cpsr_z);
+                int flags = FLAG_N | FLAG_Z;
                 if (set_carry >= 0) {
-                    if (set_carry < 2)
+                    if (set_carry < 2) {
                         emit_mov_flag_immediate(&arm.cpsr_c, set_carry);
-                    else
-                        emit_setcc_flag(set_carry, &arm.cpsr_c);
+                    } else {
+                        flags |= FLAG_C;
+                        pending_carry = set_carry;
+                    }
                 }
                 if (set_overflow >= 0)
-                    emit_setcc_flag(set_overflow, &arm.cpsr_v);
+                    flags |= FLAG_V;
+
+                if (cond == 0xE)
+                    pending_flags = flags;
+                else
+                    emit_flush_flags(flags & flags_live[insnp - start_insnp + 1]);
             }
         } else if ((insn & 0xC000000) == 0x4000000) {
             /* Byte/word memory access */
@@ -850,7 +1578,7 @@ data_proc_done:
 
             if (is_load) {
                 /* LDR/LDRB instruction */
-                emit_call_nosave(is_byteop ? (uintptr_t)read_byte_asm : (uintptr_t)read_word_asm);
+                emit_memory_access(is_byteop ? ACCESS_BYTE : ACCESS_WORD, false, true);
                 if (data_reg != 15)
                     emit_mov_armreg_x86reg(data_reg, EAX);
             } else {
@@ -859,7 +1587,7 @@ data_proc_done:
                     emit_mov_x86reg_immediate(REG_ARG2, pc + 12);
                 else
                     emit_mov_x86reg_armreg(REG_ARG2, data_reg);
-                emit_call_nosave(is_byteop ? (uintptr_t)write_byte_asm : (uintptr_t)write_word_asm);
+                emit_memory_access(is_byteop ? ACCESS_BYTE : ACCESS_WORD, true, true);
             }
 
             if (pre_index || post_index) { // Writeback
@@ -879,6 +1607,8 @@ data_proc_done:
             int load      = insn & (1 << 20);
             int reg, offset, wb_offset, count;
             bool loaded_addr_reg = false;
+            // Inlining every access would overflow the conditional jump around the instruction
+            bool inline_lookup = cond == 0xE;
 
             if (insn & (1 << 22)) // restore CPSR, or use umode regs
                 goto unimpl;
@@ -912,7 +1642,7 @@ data_proc_done:
                 emit_byte(0x8D); // LEA
                 emit_modrm_base_offset(REG_ARG1, EDX, offset);
                 if (load) {
-                    emit_call_nosave((uintptr_t)read_word_asm);
+                    emit_memory_access(ACCESS_WORD, false, inline_lookup);
                     if (reg == addr_reg && (insn & ~0u << reg & 0xFFFF)) {
                         // Loading the address register, but there are still more
                         // registers to go. In case they cause a data abort, don't
@@ -926,7 +1656,7 @@ data_proc_done:
                         emit_mov_x86reg_immediate(REG_ARG2, pc + 12);
                     else
                         emit_mov_x86reg_armreg(REG_ARG2, reg);
-                    emit_call_nosave((uintptr_t)write_word_asm);
+                    emit_memory_access(ACCESS_WORD, true, inline_lookup);
                 }
                 offset += 4;
             }
@@ -959,8 +1689,13 @@ data_proc_done:
                 goto unimpl; /* yes, this could happen (with large LDM/STM) */
             cond_jmp_offset[-1] = out - cond_jmp_offset;
         }
+        if (native_skip_offset) {
+            if (out - native_skip_offset > 0x7F)
+                goto unimpl;
+            native_skip_offset[-1] = out - native_skip_offset;
+        }
 
-        RAM_FLAGS(insnp) |= (RF_CODE_TRANSLATED | next_index << RFS_TRANSLATION_INDEX);
+        RAM_FLAGS(insnp) |= (RF_CODE_TRANSLATED | arena->next_index << RFS_TRANSLATION_INDEX);
         pc += 4;
         insnp++;
         *outj++ = insn_start;
@@ -973,9 +1708,19 @@ data_proc_done:
         }
     }
 unimpl:
-    out = insn_start;
     RAM_FLAGS(insnp) |= RF_CODE_NO_TRANSLATE;
+    if (pc == start_pc)
+        return;
+    /* The liveness pass expected the block to go on, redo it ending here */
+    limit = insnp - start_insnp;
+    while (insnp > start_insnp)
+        RAM_FLAGS(--insnp) &= ~(RF_CODE_TRANSLATED | (~0u << RFS_TRANSLATION_INDEX));
+    limit = flags_liveness(start_pc, start_insnp, limit);
+    goto retranslate;
 branch_conditional:
+    /* Leaving the block, everything has to be in arm.cpsr_* */
+    emit_flush_flags(pending_flags);
+    pending_flags = 0;
     emit_mov_x86reg_immediate(EAX, pc);
     emit_jump((uintptr_t)translation_next);
 branch_unconditional:
@@ -983,29 +1728,24 @@ branch_unconditional:
     if (pc == start_pc)
         return;
 
-    int index = next_index++;
+    int index = arena->next_index++;
 
     //jump_table[0] is pointer to code on pc=start_ptr
     //jump_table[1] is pointer to code on pc=start_ptr+4
-    translation_table[index].jump_table = (void**) jtbl_bufptr;
+    translation_table[index].jump_table = (void**) arena->jtbl_ptr;
     translation_table[index].start_ptr  = start_insnp;
     translation_table[index].end_ptr    = insnp;
 
-    insn_bufptr = out;
-    jtbl_bufptr = outj;
+    if (block_recording)
+        cache_record(start_pc, start_insnp, insnp - start_insnp, arena->jtbl_ptr);
+
+    arena->insn_ptr = out;
+    arena->jtbl_ptr = outj;
 }
 
 void flush_translations() {
-    int index;
-    for (index = 0; index < next_index; index++) {
-        uint32_t *start = translation_table[index].start_ptr;
-        uint32_t *end   = translation_table[index].end_ptr;
-        for (; start < end; start++)
-            RAM_FLAGS(start) &= ~(RF_CODE_TRANSLATED | (~0u << RFS_TRANSLATION_INDEX));
-    }
-    next_index = 0;
-    insn_bufptr = insn_buffer;
-    jtbl_bufptr = jtbl_buffer;
+    flush_arena(&rom_arena);
+    flush_arena(&ram_arena);
 }
 
 void invalidate_translation(int index) {
@@ -1014,7 +1754,10 @@ void invalidate_translation(int index) {
         if ((flags & RF_CODE_TRANSLATED) && (int)(flags >> RFS_TRANSLATION_INDEX) == index)
             error("Cannot modify currently executing code block.");
     }
-    flush_translations();
+    if (index >= ram_arena.first_index)
+        flush_arena(&ram_arena);
+    else
+        flush_translations();
 }
 
 void translate_fix_pc() {
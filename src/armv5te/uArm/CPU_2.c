@@ -11,6 +11,7 @@
 
 
 #include "CPU_2.h"
+#include "../emu.h"
 #include "../../pxa260/pxa260_math64.h"
 
 
@@ -235,6 +236,77 @@ static void cpuPrvHandleMemErr(ArmCpu* cpu, UInt32 addr, _UNUSED_ UInt8 sz, _UNU
 	}
 }
 
+static _INLINE_ UInt32 cpuPrvArmShiftImm(UInt32 ret, UInt8 type, UInt8 amount, Boolean* carryP){	//carry in is the C flag, RRX and LSL #0 use it
+	
+	Boolean co = *carryP;
+	
+	switch(type){
+		
+		case 0:			//LSL
+		
+			if(amount == 0){
+				//nothing
+			}
+			else{
+				co = (ret >> (32 - amount)) & 1;
+				ret = ret << amount;
+			}
+			break;
+		
+		case 1:			//LSR
+		
+			if(amount == 0){
+				co = ret >> 31;
+				ret = 0;
+			}
+			else{
+				co = (ret >> (amount - 1)) & 1;
+				ret = ret >> amount;
+			}
+			break;
+		
+		case 2:			//ASR
+
+			if(amount == 0){
+				if(ret & 0x80000000UL){
+					co = 1;
+					ret = 0xFFFFFFFFUL;
+				}
+				else{
+					co = 0;
+					ret = 0;
+				}
+			}
+			else{
+				co = (ret >> (amount - 1)) & 1;
+				if(ret & 0x80000000UL){
+					ret = (ret >> amount) | (0xFFFFFFFFUL << (32 - amount));
+				}
+				else{
+					ret = ret >> amount;
+				}
+			}
+			break;
+		
+		case 3:			//ROR or RRX
+		
+			if(amount == 0){	//RRX
+				amount = co;
+				co = ret & 1;
+				ret = ret >> 1;
+				if(amount) ret |= 0x80000000UL;
+			}
+			else{
+				co = (ret >> (amount - 1)) & 1;
+				ret = cpuPrvROR(ret, amount);
+			}
+			break;
+	}
+
+	*carryP = co;
+	return ret;
+}
+
 static _INLINE_ UInt32 cpuPrvArmAdrMode_1(ArmCpu* cpu, UInt32 instr, Boolean* carryOutP, Boolean wasT, Boolean specialPC){
 	
 	UInt32 ret;
@@ -331,70 +403,7 @@ static _INLINE_ UInt32 cpuPrvArmAdrMode_1(ArmCpu* cpu, UInt32 instr, Boolean* ca
 		}
 		else{					//reg with immed shift
 	
-			a = (instr >> 7) & 0x1F;	//get imm
-			
-			switch(v){
-				
-				case 0:			//LSL
-				
-					if(a == 0){
-						//nothing
-					}
-					else{
-						co = (ret >> (32 - a)) & 1;
-						ret = ret << a;
-					}
-					break;
-				
-				case 1:			//LSR
-				
-					if(a == 0){
-						co = ret >> 31;
-						ret = 0;
-					}
-					else{
-						co = (ret >> (a - 1)) & 1;
-						ret = ret >> a;
-					}
-					break;
-				
-				case 2:			//ASR
-
-					if(a == 0){
-						if(ret & 0x80000000UL){
-							co = 1;
-							ret = 0xFFFFFFFFUL;
-						}
-						else{
-							co = 0;
-							ret = 0;
-						}
-					}
-					else{
-						co = (ret >> (a - 1)) & 1;
-						if(ret & 0x80000000UL){
-							ret = (ret >> a) | (0xFFFFFFFFUL << (32 - a));
-						}
-						else{
-							ret = ret >> a;
-						}
-					}
-					break;
-				
-				case 3:			//ROR or RRX
-				
-					if(a == 0){	//RRX
-						a = co;
-						co = ret & 1;
-						ret = ret >> 1;
-						if(a) ret |= 0x80000000UL;
-					}
-					else{
-						co = (ret >> (a - 1)) & 1;
-						ret = cpuPrvROR(ret, a);
-					}
-					break;
-			}
+			ret = cpuPrvArmShiftImm(ret, v, (instr >> 7) & 0x1F, &co);
 		}
 	}
 
@@ -1198,7 +1207,7 @@ static _INLINE_ UInt32 cpuPrvMedia_signedSaturate32(UInt32 sign){
 	}
 #endif
 
-static Err cpuPrvExecInstr(ArmCpu* cpu, UInt32 instr, UInt32 instrPC/* lower bit always clear */, Boolean wasT , Boolean privileged, Boolean specialPC/* for thumb*/){
+static Err cpuPrvExecInstr(ArmCpu* cpu, UInt32 instr, const icacheOp* op/* NULL if not cached */, UInt32 instrPC/* lower bit always clear */, Boolean wasT , Boolean privileged, Boolean specialPC/* for thumb*/){
 	
 	Boolean specialInstr = false, usesUsrRegs, execute = false, L, ok;
 	UInt8 fsr;
@@ -1263,6 +1272,31 @@ static Err cpuPrvExecInstr(ArmCpu* cpu, UInt32 instr, UInt32 instrPC/* lower bit
 		UInt32 m32, x32;	//non-register 32-bit val
 		UInt16 v16;
 		UInt8 va8, vb8 = 0, vc8;
+		Boolean carryOut;
+
+		//predecoded ops skip the decode tree and enter the matching handler with their operands ready
+		if(op) switch(op->handler){
+
+			case ICACHE_HANDLER_DATA_IMM:
+				tmp = op->imm;
+				carryOut = op->shift ? (tmp >> 31) : ((cpu->CPSR & ARM_SR_C) != 0);
+				goto data_processing_decoded;
+
+			case ICACHE_HANDLER_DATA_REG:
+				carryOut = (cpu->CPSR & ARM_SR_C) != 0;
+				tmp = cpuPrvArmShiftImm(cpuPrvGetReg(cpu, op->reg, wasT, specialPC), op->shift >> 5, op->shift & 0x1F, &carryOut);
+				goto data_processing_decoded;
+
+			case ICACHE_HANDLER_LOAD_STORE_IMM:
+				va8 = op->reg;
+				tmp = op->imm;
+				v32 = op->imm2;
+				goto load_store_mode_2_decoded;
+
+			case ICACHE_HANDLER_BRANCH:
+				tmp = op->imm + instrPC;
+				goto branch_decoded;
+		}
 
 		switch((instr >> 24) & 0x0F){
 
@@ -1798,12 +1832,13 @@ static Err cpuPrvExecInstr(ArmCpu* cpu, UInt32 instr, UInt32 instrPC/* lower bit
 				}
 				
 data_processing:							//data processing
+				tmp = cpuPrvArmAdrMode_1(cpu, instr, &carryOut, wasT, specialPC);
+data_processing_decoded:						//operand 2 in tmp, shifter carry in carryOut
 				{
-					Boolean carryOut, carryIn, V, S, store = true;
+					Boolean carryIn, V, S, store = true;
 					S = (instr & 0x00100000UL) != 0;
 					V = (cpu->CPSR & ARM_SR_V) != 0;
 					carryIn = (cpu->CPSR & ARM_SR_C) != 0;
-					tmp = cpuPrvArmAdrMode_1(cpu, instr, &carryOut, wasT, specialPC);
 					va8 = (instr >> 16) & 0x0F;
 					
 					switch((instr >> 21) & 0x0F){
@@ -2008,6 +2043,7 @@ load_store_mode_2:
 				tmp = m32;
 				v32 = x32;
 				if(va8 & ARM_MODE_2_INV) goto invalid_instr;
+load_store_mode_2_decoded:					//mode 2 flags in va8, offsets in tmp and v32
 				if(va8 & ARM_MODE_2_T) privileged = false;
 				vb8 = (va8 & ARM_MODE_2_WORD) ? 4 : 1;	//get operation size
 				
@@ -2154,6 +2190,7 @@ load_store_mode_2:
 				if(tmp & 0x00800000UL) tmp |= 0xFF000000UL;	//sign extend
 				tmp = tmp << (wasT ? 1 : 2);			//shift left 2(ARM) or 1(thumb)
 				tmp += instrPC + (wasT ? 4 : 8); 		//add where PC would point in an ARM 
+branch_decoded:
 				if(specialInstr){				//handle BLX
 					if(instr & 0x01000000UL) tmp += 2;
 					cpu->regs[14] = instrPC + (wasT ? 2 : 4);
@@ -2244,44 +2281,91 @@ load_store_mode_2:
 	return errNone;
 }
 
+static void cpuPrvDecodeOp(ArmCpu* cpu, icacheOp* op, UInt32 instr, Boolean wasT){	//picks the handler for an ARM form instruction and pulls its operands out, anything unusual is left to the full decoder
+	
+	op->instr = instr;
+	op->handler = ICACHE_HANDLER_DECODE;
+	
+	if((instr >> 28) == 0x0F) return;	//unconditional space, nothing fast in there
+	
+	switch((instr >> 25) & 0x07){
+		
+		case 0:		//data processing reg shifted by an immediate
+			if((instr & 0x00000010UL) || (instr & 0x01900000UL) == 0x01000000UL) return;	//reg shifted by reg, multiplies, extra loads/stores, misc instrs
+			op->handler = ICACHE_HANDLER_DATA_REG;
+			op->reg = instr & 0x0F;
+			op->shift = (instr & 0x60) | ((instr >> 7) & 0x1F);
+			break;
+		
+		case 1:		//data processing immediate
+			if((instr & 0x01900000UL) == 0x01000000UL) return;	//MSR, MOVW, MOVT, hints
+			op->handler = ICACHE_HANDLER_DATA_IMM;
+			op->shift = (instr >> 7) & 0x1E;
+			op->imm = cpuPrvROR(instr & 0xFF, op->shift);
+			break;
+		
+		case 2:		//load/store immediate offset, the offsets dont depend on any register
+			op->handler = ICACHE_HANDLER_LOAD_STORE_IMM;
+			op->reg = cpuPrvArmAdrMode_2(cpu, instr, &op->imm, &op->imm2, wasT, false);
+			break;
+		
+		case 5:		//B/BL
+			op->handler = ICACHE_HANDLER_BRANCH;
+			op->imm = instr & 0x00FFFFFFUL;
+			if(op->imm & 0x00800000UL) op->imm |= 0xFF000000UL;
+			op->imm = (op->imm << (wasT ? 1 : 2)) + (wasT ? 4 : 8);
+			break;
+	}
+}
+
 static Err cpuPrvCycleArm(ArmCpu* cpu){
 	
-	Boolean privileged, ok;
+	Boolean privileged;
 	UInt32 instr, pc;
 	UInt8 fsr;
+	icacheOp* op;
 
 	privileged = (cpu->CPSR & ARM_SR_M) != ARM_SR_MODE_USR;
 	//fetch instruction
 	{
-		ok = icacheFetch(&cpu->ic, pc = cpu->regs[15], 4, privileged, &fsr, &instr);
-		if(!ok){
+		op = icacheFetchOp(&cpu->ic, pc = cpu->regs[15], 4, privileged, &fsr, &instr);
+		if(!op){
 			cpuPrvHandleMemErr(cpu, cpu->regs[15], 4, false, true, fsr);
 			return errNone;						//exit here so that debugger can see us execute first instr of execption handler
 		}
 		cpu->regs[15] += 4;
 	}
 	
-	return cpuPrvExecInstr(cpu, instr, pc, false, privileged, false);
+	if(op->type != ICACHE_OP_ARM){
+		cpuPrvDecodeOp(cpu, op, instr, false);
+		op->type = ICACHE_OP_ARM;
+	}
+	
+	return cpuPrvExecInstr(cpu, instr, op, pc, false, privileged, false);
 }
 
 
 static Err cpuPrvCycleThumb(ArmCpu* cpu){
 	
-	Boolean privileged, vB, specialPC = false, ok;
+	Boolean privileged, vB, specialPC = false, cacheable = true;
 	UInt32 t, instr = 0xE0000000UL /*most likely thing*/, pc;
 	UInt16 instrT, v16;
 	UInt8 v8, fsr;
+	icacheOp* op;
 
 	privileged = (cpu->CPSR & ARM_SR_M) != ARM_SR_MODE_USR;
 	
 	pc = cpu->regs[15];
-	ok = icacheFetch(&cpu->ic, pc, 2, privileged, &fsr, &instrT);
-	if(!ok){
+	op = icacheFetchOp(&cpu->ic, pc, 2, privileged, &fsr, &instrT);
+	if(!op){
 		cpuPrvHandleMemErr(cpu, pc, 2, false, true, fsr);
 		return errNone;						//exit here so that debugger can see us execute first instr of execption handler
 	}
 	cpu->regs[15] += 2;
 	
+	//already converted to ARM
+	if(op->type == ICACHE_OP_THUMB || op->type == ICACHE_OP_THUMB_SPECIAL_PC) return cpuPrvExecInstr(cpu, op->instr, op, pc, true, privileged, op->type == ICACHE_OP_THUMB_SPECIAL_PC);
+	
 	switch(instrT >> 12){
 		
 		case 0:		// LSL(1) LSR(1) ASR(1) ADD(1) SUB(1) ADD(3) SUB(3)
@@ -2369,8 +2453,10 @@ static Err cpuPrvCycleThumb(ArmCpu* cpu){
 					
 					case 3:			// BX
 						
-						if (instrT & 0x80)	//BLX
+						if (instrT & 0x80){	//BLX
 							cpu->regs[14] = cpu->regs[15] + 1;
+							cacheable = false;
+						}
 	
 						if(instrT == 0x4778){	//special handing for thumb's "BX PC" as aparently docs are wrong on it
 							
@@ -2606,7 +2692,11 @@ static Err cpuPrvCycleThumb(ArmCpu* cpu){
 	}
 
 instr_execute:
-	return cpuPrvExecInstr(cpu, instr, pc, true, privileged, specialPC);
+	if(cacheable){
+		cpuPrvDecodeOp(cpu, op, instr, true);
+		op->type = specialPC ? ICACHE_OP_THUMB_SPECIAL_PC : ICACHE_OP_THUMB;
+	}
+	return cpuPrvExecInstr(cpu, instr, cacheable ? op : NULL, pc, true, privileged, specialPC);
 instr_done:
 	return errNone;
 undefined:
@@ -2646,7 +2736,7 @@ Err cpuDeinit(_UNUSED_ ArmCpu* cpu){
 	return errNone;
 }
 
-void cpuCycle(ArmCpu* cpu){
+static _INLINE_ void cpuPrvCheckInterrupts(ArmCpu* cpu){
 
 	UInt32 vector, newCPSR;
 
@@ -2668,12 +2758,15 @@ void cpuCycle(ArmCpu* cpu){
 	}
 #endif
 	else{
-		goto normal;
+		return;
 	}
 
 	cpuPrvException(cpu, vector, cpu->regs[15] + 4, newCPSR);
+}
 
-normal:
+void cpuCycle(ArmCpu* cpu){
+
+	cpuPrvCheckInterrupts(cpu);
 
 	if(cpu->CPSR & ARM_SR_T){
 		cpuPrvCycleThumb(cpu);
@@ -2684,6 +2777,36 @@ normal:
 	}
 }
 
+UInt32 cpuRun(ArmCpu* cpu, UInt32 maxCycles){
+
+	cpu->runCycles = 0;
+	cpu->runCyclesLeft = maxCycles;
+
+	//a deinit request sets exiting, stop here instead of finishing the slice like cpu_arm_loop does
+	while(cpu->runCyclesLeft && !exiting){
+		
+		//the lines only change when the interrupt controller calls cpuIrq, so the masks dont need to be checked while nothing is pending
+#ifdef ARM_V6
+		if(cpu->waitingFiqs | cpu->waitingIrqs | cpu->impreciseAbtWaiting) cpuPrvCheckInterrupts(cpu);
+#else
+		if(cpu->waitingFiqs | cpu->waitingIrqs) cpuPrvCheckInterrupts(cpu);
+#endif
+
+		if(cpu->CPSR & ARM_SR_T){
+			cpuPrvCycleThumb(cpu);
+		}
+		else{
+			
+			cpuPrvCycleArm(cpu);
+		}
+		
+		cpu->runCycles++;
+		if(cpu->runCyclesLeft) cpu->runCyclesLeft--;
+	}
+
+	return cpu->runCycles;
+}
+
 void cpuIrq(ArmCpu* cpu, Boolean fiq, Boolean raise){	//unraise when acknowledged
 
 	if(fiq){
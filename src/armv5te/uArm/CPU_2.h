@@ -123,6 +123,8 @@ typedef struct ArmCpu{
 	UInt16		waitingIrqs;
 	UInt16		waitingFiqs;
 	UInt16		CPAR;
+	UInt32		runCycles;		//cycles executed by the current cpuRun so far
+	UInt32		runCyclesLeft;		//cycles left in the current cpuRun, can be lowered while running to return sooner
 
 	ArmCoprocessor	coproc[16];		//coprocessors
 
@@ -149,6 +151,7 @@ typedef struct ArmCpu{
 Err cpuInit(ArmCpu* cpu, UInt32 pc, ArmCpuMemF memF, ArmCpuEmulErr emulErrF, ArmCpuHypercall hypercallF, ArmSetFaultAdrF setFaultAdrF);
 Err cpuDeinit(ArmCpu* cp);
 void cpuCycle(ArmCpu* cpu);
+UInt32 cpuRun(ArmCpu* cpu, UInt32 maxCycles);	//returns the amount of cycles executed
 void cpuIrq(ArmCpu* cpu, Boolean fiq, Boolean raise);	//unraise when acknowledged
 
 #ifdef ARM_V6
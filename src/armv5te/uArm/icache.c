@@ -22,6 +22,7 @@ void icacheInval(icache* ic){
 		for(j = 0; j < ICACHE_BUCKET_SZ; j++) ic->lines[i][j].info = 0;
 		ic->ptr[i] = 0;
 	}
+	ic->last = NULL;
 }
 
 void icacheInit(icache* ic, ArmCpu* cpu, ArmCpuMemF memF){
@@ -67,14 +68,14 @@ void icacheInvalAddr(icache* ic, UInt32 va){
 	we cannot have data overlap cachelines since data is self aligned (word on 4-byte boundary, halfwords on2, etc. this is enforced elsewhere
 */
 
-Boolean _icache_fetch_func(icache* ic, UInt32 va, UInt8 sz, Boolean priviledged, UInt8* fsrP, void* buf){
+static icacheLine* icachePrvGetLine(icache* ic, UInt32 va, Boolean priviledged, UInt8* fsrP){
 
-	UInt32 off = va % ICACHE_LINE_SZ;
 	Int8 i, j, bucket;
 	icacheLine* lines;
 	icacheLine* line;
 	
-	va -= off;
+	//va is line aligned here
+	if(ic->last && (ic->last->info & (ICACHE_ADDR_MASK | ICACHE_USED_MASK)) == (va | ICACHE_USED_MASK)) return ic->last;
 
 	bucket = icachePrvHash(va);
 	lines = ic->lines[bucket];
@@ -85,14 +86,8 @@ Boolean _icache_fetch_func(icache* ic, UInt32 va, UInt8 sz, Boolean priviledged,
 		
 		if((lines[j].info & (ICACHE_ADDR_MASK | ICACHE_USED_MASK)) == (va | ICACHE_USED_MASK)){	//found it!
 		
-			if(sz == 4){
-				*(UInt32*)buf = *(UInt32*)(lines[j].data + off);
-			}
-			else if(sz == 2){
-				*(UInt16*)buf = *(UInt16*)(lines[j].data + off);
-			}
-			else __mem_copy(buf, lines[j].data + off, sz);
-			return priviledged || !(lines[j].info & ICACHE_PRIV_MASK);	
+			ic->last = lines + j;
+			return ic->last;
 		}
 	}
 	//if we're here, we found nothing - time to populate the cache
@@ -103,9 +98,22 @@ Boolean _icache_fetch_func(icache* ic, UInt32 va, UInt8 sz, Boolean priviledged,
 	line->info = va | (priviledged ? ICACHE_PRIV_MASK : 0);
 	if(!ic->memF(ic->cpu, line->data, va, ICACHE_LINE_SZ, false, priviledged, fsrP)){
 	
-		return false;	
+		return NULL;	
 	}
 	line->info |= ICACHE_USED_MASK;
+	__mem_zero(line->ops, sizeof(line->ops));
+	
+	ic->last = line;
+	return line;
+}
+
+Boolean _icache_fetch_func(icache* ic, UInt32 va, UInt8 sz, Boolean priviledged, UInt8* fsrP, void* buf){
+
+	UInt32 off = va % ICACHE_LINE_SZ;
+	icacheLine* line;
+	
+	line = icachePrvGetLine(ic, va - off, priviledged, fsrP);
+	if(!line) return false;
 	
 	if(sz == 4){
 		*(UInt32*)buf = *(UInt32*)(line->data + off);
@@ -114,7 +122,24 @@ Boolean _icache_fetch_func(icache* ic, UInt32 va, UInt8 sz, Boolean priviledged,
 		*(UInt16*)buf = *(UInt16*)(line->data + off);
 	}
 	else __mem_copy(buf, line->data + off, sz);
-	return true;
+	return priviledged || !(line->info & ICACHE_PRIV_MASK);
+}
+
+icacheOp* icacheFetchOp(icache* ic, UInt32 va, UInt8 sz, Boolean priviledged, UInt8* fsrP, void* buf){
+
+	UInt32 off = va % ICACHE_LINE_SZ;
+	icacheLine* line;
+	
+	line = icachePrvGetLine(ic, va - off, priviledged, fsrP);
+	if(!line || !(priviledged || !(line->info & ICACHE_PRIV_MASK))) return NULL;
+	
+	if(sz == 4){
+		*(UInt32*)buf = *(UInt32*)(line->data + off);
+	}
+	else{
+		*(UInt16*)buf = *(UInt16*)(line->data + off);
+	}
+	return line->ops + off / 2;
 }
 
 #include "stdio.h"
@@ -20,10 +20,37 @@
 #define ICACHE_USED_MASK	1UL
 #define ICACHE_PRIV_MASK	2UL
 
+#define ICACHE_OP_SLOTS		(ICACHE_LINE_SZ / 2)	//one per halfword so Thumb code fits
+
+
+#define ICACHE_OP_NONE		0	//not decoded yet, or has to go through the full decoder every time
+#define ICACHE_OP_THUMB		1	//Thumb instruction, instr is its ARM form
+#define ICACHE_OP_THUMB_SPECIAL_PC	2	//same but run with specialPC set
+#define ICACHE_OP_ARM		3	//ARM instruction
+
+#define ICACHE_HANDLER_DECODE	0	//run instr through the full decoder
+#define ICACHE_HANDLER_DATA_IMM	1	//data processing, operand 2 in imm
+#define ICACHE_HANDLER_DATA_REG	2	//data processing, operand 2 is reg shifted by an immediate
+#define ICACHE_HANDLER_LOAD_STORE_IMM	3	//LDR/STR/LDRB/STRB with an immediate offset
+#define ICACHE_HANDLER_BRANCH	4	//B/BL
+
+typedef struct{
+
+	UInt32 instr;	//ARM form of the instruction
+	UInt32 imm;	//operand 2 for data processing, offset before the access for loads/stores, target minus instrPC for branches
+	UInt32 imm2;	//writeback offset for loads/stores
+	UInt8 type;	//ICACHE_OP_*
+	UInt8 handler;	//ICACHE_HANDLER_*
+	UInt8 reg;	//Rm for data processing, base reg and ARM_MODE_2_* flags for loads/stores
+	UInt8 shift;	//shift type << 5 | amount for data processing from a reg, rotation for an immediate
+	
+}icacheOp;
+
 typedef struct{
 
 	UInt32 info;	//addr, masks
 	UInt8 data[ICACHE_LINE_SZ];
+	icacheOp ops[ICACHE_OP_SLOTS];	//decoded instructions, cleared when the line is filled
 	
 }icacheLine;
 
@@ -33,12 +60,14 @@ typedef struct{
 	ArmCpuMemF memF;
 	icacheLine lines[ICACHE_BUCKET_NUM][ICACHE_BUCKET_SZ];
 	UInt8 ptr[ICACHE_BUCKET_NUM];
+	icacheLine* last;	//last line used, sequential fetches skip the set search
 
 }icache;
 
 
 void icacheInit(icache* ic, struct ArmCpu* cpu, ArmCpuMemF memF);
 Boolean icacheFetch(icache* ic, UInt32 va, UInt8 sz, Boolean priviledged, UInt8* fsr, void* buf);
+icacheOp* icacheFetchOp(icache* ic, UInt32 va, UInt8 sz, Boolean priviledged, UInt8* fsr, void* buf);	//same as icacheFetch but returns the decoded op slot, NULL on failure
 void icacheInval(icache* ic);
 void icacheInvalAddr(icache* ic, UInt32 addr);
 
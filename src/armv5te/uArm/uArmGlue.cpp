@@ -1,3 +1,5 @@
+#include <string.h>
+
 #include "uArmGlue.h"
 #include "CPU_2.h"
 
@@ -162,3 +164,106 @@ void uArmInitCpXX(ArmCpu* cpu){
    cpuCoprocessorRegister(cpu, 14, &uArmCp14);
    cpuCoprocessorRegister(cpu, 15, &uArmCp15);
 }
+
+static ArmBankedRegs* uArmGetModeBank(ArmCpu* cpu, UInt32 mode){
+   switch(mode){
+      case ARM_SR_MODE_FIQ:
+         return &cpu->bank_fiq;
+
+      case ARM_SR_MODE_IRQ:
+         return &cpu->bank_irq;
+
+      case ARM_SR_MODE_SVC:
+         return &cpu->bank_svc;
+
+      case ARM_SR_MODE_ABT:
+         return &cpu->bank_abt;
+
+      case ARM_SR_MODE_UND:
+         return &cpu->bank_und;
+
+      default:
+         return &cpu->bank_usr;
+   }
+}
+
+void uArmStateToArmv5te(ArmCpu* cpu){
+   //uARM keeps the current modes R13, R14 and SPSR in regs and SPSR, put them in the bank temporarily so all banks can be copied the same way
+   ArmBankedRegs* current = uArmGetModeBank(cpu, cpu->CPSR & ARM_SR_M);
+   ArmBankedRegs inactive = *current;
+
+   current->R13 = cpu->regs[13];
+   current->R14 = cpu->regs[14];
+   current->SPSR = cpu->SPSR;
+
+   arm.r13_usr[0] = cpu->bank_usr.R13;
+   arm.r13_usr[1] = cpu->bank_usr.R14;
+   arm.r13_fiq[0] = cpu->bank_fiq.R13;
+   arm.r13_fiq[1] = cpu->bank_fiq.R14;
+   arm.spsr_fiq = cpu->bank_fiq.SPSR;
+   arm.r13_irq[0] = cpu->bank_irq.R13;
+   arm.r13_irq[1] = cpu->bank_irq.R14;
+   arm.spsr_irq = cpu->bank_irq.SPSR;
+   arm.r13_svc[0] = cpu->bank_svc.R13;
+   arm.r13_svc[1] = cpu->bank_svc.R14;
+   arm.spsr_svc = cpu->bank_svc.SPSR;
+   arm.r13_abt[0] = cpu->bank_abt.R13;
+   arm.r13_abt[1] = cpu->bank_abt.R14;
+   arm.spsr_abt = cpu->bank_abt.SPSR;
+   arm.r13_und[0] = cpu->bank_und.R13;
+   arm.r13_und[1] = cpu->bank_und.R14;
+   arm.spsr_und = cpu->bank_und.SPSR;
+
+   *current = inactive;
+
+   memcpy(arm.reg, cpu->regs, sizeof(arm.reg));
+   if((cpu->CPSR & ARM_SR_M) == ARM_SR_MODE_FIQ){
+      memcpy(arm.r8_fiq, &cpu->regs[8], sizeof(arm.r8_fiq));
+      memcpy(arm.r8_usr, cpu->extra_regs, sizeof(arm.r8_usr));
+   }
+   else{
+      memcpy(arm.r8_usr, &cpu->regs[8], sizeof(arm.r8_usr));
+      memcpy(arm.r8_fiq, cpu->extra_regs, sizeof(arm.r8_fiq));
+   }
+
+   arm.cpsr_low28 = cpu->CPSR & 0x090000FF;
+   set_cpsr_flags(cpu->CPSR);
+   arm.interrupts = (cpu->waitingIrqs ? 0x80 : 0x00) | (cpu->waitingFiqs ? 0x40 : 0x00);
+}
+
+void uArmStateFromArmv5te(ArmCpu* cpu){
+   UInt32 cpsr = get_cpsr();
+
+   cpu->bank_usr.R13 = arm.r13_usr[0];
+   cpu->bank_usr.R14 = arm.r13_usr[1];
+   cpu->bank_usr.SPSR = 0x00000000;
+   cpu->bank_fiq.R13 = arm.r13_fiq[0];
+   cpu->bank_fiq.R14 = arm.r13_fiq[1];
+   cpu->bank_fiq.SPSR = arm.spsr_fiq;
+   cpu->bank_irq.R13 = arm.r13_irq[0];
+   cpu->bank_irq.R14 = arm.r13_irq[1];
+   cpu->bank_irq.SPSR = arm.spsr_irq;
+   cpu->bank_svc.R13 = arm.r13_svc[0];
+   cpu->bank_svc.R14 = arm.r13_svc[1];
+   cpu->bank_svc.SPSR = arm.spsr_svc;
+   cpu->bank_abt.R13 = arm.r13_abt[0];
+   cpu->bank_abt.R14 = arm.r13_abt[1];
+   cpu->bank_abt.SPSR = arm.spsr_abt;
+   cpu->bank_und.R13 = arm.r13_und[0];
+   cpu->bank_und.R14 = arm.r13_und[1];
+   cpu->bank_und.SPSR = arm.spsr_und;
+
+   //the current modes bank is stale in both layouts, the live values are in the main registers
+   memcpy(cpu->regs, arm.reg, sizeof(arm.reg));
+   if((cpsr & ARM_SR_M) == ARM_SR_MODE_FIQ)
+      memcpy(cpu->extra_regs, arm.r8_usr, sizeof(arm.r8_usr));
+   else
+      memcpy(cpu->extra_regs, arm.r8_fiq, sizeof(arm.r8_fiq));
+
+   cpu->CPSR = cpsr;
+   cpu->SPSR = uArmGetModeBank(cpu, cpsr & ARM_SR_M)->SPSR;
+   cpu->waitingIrqs = !!(arm.interrupts & 0x80);
+   cpu->waitingFiqs = !!(arm.interrupts & 0x40);
+
+   icacheInval(&cpu->ic);
+}
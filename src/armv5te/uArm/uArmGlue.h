@@ -13,6 +13,8 @@ void	uArmEmulErr	(struct ArmCpu* cpu, const char* err_str);
 void	uArmSetFaultAddr(struct ArmCpu* cpu, UInt32 adr, UInt8 faultStatus);
 
 void uArmInitCpXX(ArmCpu* cpu);
+void uArmStateToArmv5te(ArmCpu* cpu);//copies the uARM registers to the armv5te state, which is the only layout saved to save states
+void uArmStateFromArmv5te(ArmCpu* cpu);//copies the armv5te registers to uARM
 
 #ifdef __cplusplus
 }
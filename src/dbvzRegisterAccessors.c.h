@@ -511,21 +511,14 @@ static void setSpiCont2(uint16_t value){
    //do a transfer if enabled(this register write and last) and exchange set
    if(value & oldSpiCont2 & 0x0200 && value & 0x0100){
       uint8_t bitCount = (value & 0x000F) + 1;
-      uint16_t startBit = 1 << (bitCount - 1);
       uint16_t spi2Data = registerArrayRead16(SPIDATA2);
       bool spiClk2Enabled = !(registerArrayRead8(PESEL) & 0x04);
       //uint16_t oldSpi2Data = spi2Data;
 
       //the input data is shifted into the unused bits if the transfer is less than 16 bits
       if(spiClk2Enabled){
-         uint8_t bits;
-
          //shift in valid data
-         for(bits = 0; bits < bitCount; bits++){
-            bool newBit = ads7846ExchangeBit(!!(spi2Data & startBit));
-            spi2Data <<= 1;
-            spi2Data |= newBit;
-         }
+         spi2Data = spi2Data << bitCount | ads7846ExchangeWord(bitCount, spi2Data & fillBottomWith1s(0, bitCount));
       }
       else{
          //shift in 0s, this is inaccurate, it should be whatever the last bit on SPIRXD(the SPI2 pin, not the SPI1 register) was
@@ -821,7 +814,7 @@ static uint8_t getPortDInputPinValues(void){
 
    //portDInputValues |= 0x80;//battery dead bit, dont know the proper level to set this
 
-   if(palmSdCard.flashChipData)
+   if(sdCardIsInserted())
       portDInputValues |= 0x20;
 
    //kbd row 0
@@ -64,6 +64,7 @@ double    palmCycleCounter;//can be greater then 0 if too many cycles where run
 double    palmClockMultiplier;//used by the emulator to overclock the emulated Palm
 bool      palmSyncRtc;//doesnt go in save states, its a property of the session not the device
 bool      palmAllowInvalidBehavior;//doesnt go in save states, its a property of the session not the device
+bool      palmDemandPaging;//doesnt go in save states, its a property of the host process not the device
 void      (*palmIrSetPortProperties)(serial_port_properties_t* properties);//configure port I/O behavior, used for proxyed native I/R connections
 uint32_t  (*palmIrDataSize)(void);//returns the current number of bytes in the hosts IR receive FIFO
 uint16_t  (*palmIrDataReceive)(void);//called by the emulator to read the hosts IR receive FIFO
@@ -100,7 +101,7 @@ static void patchOsRom(uint32_t address, char* patch){
 }
 
 
-uint32_t emulatorInit(uint8_t emulatedDevice, uint8_t* palmRomData, uint32_t palmRomSize, uint8_t* palmBootloaderData, uint32_t palmBootloaderSize, bool syncRtc, bool allowInvalidBehavior){
+uint32_t emulatorInit(uint8_t emulatedDevice, uint8_t* palmRomData, uint32_t palmRomSize, uint8_t* palmBootloaderData, uint32_t palmBootloaderSize, bool syncRtc, bool allowInvalidBehavior, uint8_t armCore){
    if(emulatorInitialized)
       return EMU_ERROR_RESOURCE_LOCKED;
 
@@ -129,7 +130,7 @@ uint32_t emulatorInit(uint8_t emulatedDevice, uint8_t* palmRomData, uint32_t pal
       //emulating Tungsten T3
       bool dynarecInited = false;
 
-      dynarecInited = pxa260Init(&palmRom, &palmRam);
+      dynarecInited = pxa260Init(&palmRom, &palmRam, armCore == EMU_ARM_CORE_UARM);
       palmFramebuffer = malloc(320 * 480 * sizeof(uint16_t));
       palmAudio = malloc(AUDIO_SAMPLES_PER_FRAME * 2 * sizeof(int16_t));
       palmAudioResampler = blip_new(AUDIO_SAMPLE_RATE);//have 1 second of samples
@@ -160,7 +161,6 @@ uint32_t emulatorInit(uint8_t emulatedDevice, uint8_t* palmRomData, uint32_t pal
       blip_set_rates(palmAudioResampler, DBVZ_AUDIO_MAX_CLOCK_RATE, AUDIO_SAMPLE_RATE);
 
       patchOsRom(0x333EC6, "0000");//blocks out the slot driver
-      patchOsRom(0x205C, "0000A0E1");//blocks idle loop jump with NOP
 
       //reset everything
       emulatorSoftReset();
@@ -247,6 +247,7 @@ void emulatorDeinit(void){
          pxa260Deinit();
 #endif
       free(palmSdCard.flashChipData);
+      sdCardVirtualEject();
       emulatorInitialized = false;
    }
 }
@@ -592,6 +593,8 @@ bool emulatorLoadState(uint8_t* data, uint32_t size){
    offset += sizeof(uint8_t);
    if(palmSdCard.flashChipData)
       free(palmSdCard.flashChipData);
+   if(stateSdCardBuffer)
+      sdCardVirtualEject();//a virtual card cant be in the state, so the states card replaces it
    palmSdCard.flashChipData = stateSdCardBuffer;
    palmSdCard.flashChipSize = stateSdCardSize;
    memcpy(palmSdCard.flashChipData, data + offset, stateSdCardSize);
@@ -655,18 +658,50 @@ bool emulatorLoadRam(uint8_t* data, uint32_t size){
    return true;
 }
 
-uint32_t emulatorInsertSdCard(uint8_t* data, uint32_t size, sd_card_info_t* sdInfo){
-   //from the no name SD card that came instered in my test device
-   static const sd_card_info_t defaultSdInfo = {
-      {0x00, 0x2F, 0x00, 0x32, 0x5F, 0x59, 0x83, 0xB8, 0x6D, 0xB7, 0xFF, 0x9F, 0x96, 0x40, 0x00, 0x00},//csd
-      {0x1D, 0x41, 0x44, 0x53, 0x44, 0x20, 0x20, 0x20, 0x10, 0xA0, 0x50, 0x33, 0xA4, 0x00, 0x81, 0x00},//cid
-      {0x01, 0x25, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},//scr
-      0x01FF8000,//ocr
-      false//writeProtectSwitch
-   };
+uint64_t emulatorGetCommittedMemory(void){
+#if defined(EMU_SUPPORT_PALM_OS5)
+   if(palmEmulatingTungstenT3)
+      return pxa260GetCommittedMemory();
+#endif
+   return M5XX_ROM_SIZE + emulatorGetRamSize();
+}
+
+uint32_t emulatorGetTranslationCacheSize(void){
+#if defined(EMU_SUPPORT_PALM_OS5)
+   if(palmEmulatingTungstenT3)
+      return pxa260TranslationCacheSize();
+#endif
+   return 0;
+}
+
+bool emulatorSaveTranslationCache(uint8_t* data, uint32_t size){
+#if defined(EMU_SUPPORT_PALM_OS5)
+   if(palmEmulatingTungstenT3)
+      return pxa260SaveTranslationCache(data, size);
+#endif
+   return false;
+}
+
+bool emulatorLoadTranslationCache(uint8_t* data, uint32_t size){
+#if defined(EMU_SUPPORT_PALM_OS5)
+   if(palmEmulatingTungstenT3)
+      return pxa260LoadTranslationCache(data, size);
+#endif
+   return false;
+}
+
+//from the no name SD card that came instered in my test device
+static const sd_card_info_t emulatorDefaultSdInfo = {
+   {0x00, 0x2F, 0x00, 0x32, 0x5F, 0x59, 0x83, 0xB8, 0x6D, 0xB7, 0xFF, 0x9F, 0x96, 0x40, 0x00, 0x00},//csd
+   {0x1D, 0x41, 0x44, 0x53, 0x44, 0x20, 0x20, 0x20, 0x10, 0xA0, 0x50, 0x33, 0xA4, 0x00, 0x81, 0x00},//cid
+   {0x01, 0x25, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},//scr
+   0x01FF8000,//ocr
+   false//writeProtectSwitch
+};
 
+uint32_t emulatorInsertSdCard(uint8_t* data, uint32_t size, sd_card_info_t* sdInfo){
    //SD card is currently inserted
-   if(palmSdCard.flashChipData)
+   if(sdCardIsInserted())
       return EMU_ERROR_RESOURCE_LOCKED;
 
    //no 0 sized chips, max out at 2gb SD card, Palms cant handle higher than that anyway because of incompatibility with FAT32 and SDHC
@@ -694,7 +729,33 @@ uint32_t emulatorInsertSdCard(uint8_t* data, uint32_t size, sd_card_info_t* sdIn
    if(sdInfo)
       palmSdCard.sdInfo = *sdInfo;
    else
-      palmSdCard.sdInfo = defaultSdInfo;
+      palmSdCard.sdInfo = emulatorDefaultSdInfo;
+   sdCardReset();
+
+   return EMU_ERROR_NONE;
+}
+
+uint32_t emulatorInsertVirtualSdCard(const sd_card_virtual_volume_t* volume, sd_card_info_t* sdInfo){
+   //SD card is currently inserted
+   if(sdCardIsInserted())
+      return EMU_ERROR_RESOURCE_LOCKED;
+
+   if(!volume)
+      return EMU_ERROR_INVALID_PARAMETER;
+
+   //the volume was sized when it was created, same limit as a raw image
+   if(!sdCardVirtualInsert(volume))
+      return EMU_ERROR_INVALID_PARAMETER;
+   if(sdCardVirtualGetSize() > 0x20000000){
+      sdCardVirtualEject();
+      return EMU_ERROR_INVALID_PARAMETER;
+   }
+
+   //reinit SD card
+   if(sdInfo)
+      palmSdCard.sdInfo = *sdInfo;
+   else
+      palmSdCard.sdInfo = emulatorDefaultSdInfo;
    sdCardReset();
 
    return EMU_ERROR_NONE;
@@ -726,6 +787,7 @@ void emulatorEjectSdCard(void){
       palmSdCard.flashChipData = NULL;
       palmSdCard.flashChipSize = 0x00000000;
    }
+   sdCardVirtualEject();
 }
 
 void emulatorRunFrame(void){
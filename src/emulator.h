@@ -13,6 +13,7 @@ extern "C" {
 
 #include "audio/blip_buf.h"
 #include "m5XXBus.h"//for size macros
+#include "sdCardVirtual.h"
 
 //DEFINE INFO!!!
 //define EMU_SUPPORT_PALM_OS5 to compile in Tungsten T3 support(not reccomended for low power devices)
@@ -39,7 +40,7 @@ void frontendHandleDebugPrint();
 #endif
 #else
 //msvc2003 doesnt support variadic macros, so just use an empty variadic function instead, EMU_DEBUG is not supported at all on msvc2003
-static void debugLog(char* str, ...){};
+static void debugLog(const char* str, ...){};
 #endif
 
 //config options
@@ -106,6 +107,12 @@ enum{
 #endif
 };
 
+//ARM CPU cores, only used when emulating a Palm OS 5 device
+enum{
+   EMU_ARM_CORE_ARMV5TE = 0,//dynarec when available, armv5te interpreter otherwise
+   EMU_ARM_CORE_UARM//slow reference interpreter, useful to check if a bug is in the dynarec
+};
+
 //types
 typedef struct{
    bool     enable;
@@ -200,6 +207,7 @@ extern double    palmCycleCounter;//dont touch
 extern double    palmClockMultiplier;//dont touch
 extern bool      palmSyncRtc;//dont touch
 extern bool      palmAllowInvalidBehavior;//dont touch
+extern bool      palmDemandPaging;//write allowed before emulatorInit, lets OS 5 commit its address cache on first use, this takes over SIGSEGV and SIGBUS so only set it if the host never installs its own handlers
 extern void      (*palmIrSetPortProperties)(serial_port_properties_t* properties);//configure port I/O behavior, used for proxyed native I/R connections
 extern uint32_t  (*palmIrDataSize)(void);//returns the current number of bytes in the hosts IR receive FIFO
 extern uint16_t  (*palmIrDataReceive)(void);//called by the emulator to read the hosts IR receive FIFO
@@ -213,7 +221,7 @@ extern void      (*palmSerialDataFlush)(void);//called by the emulator to delete
 extern void      (*palmGetRtcFromHost)(uint8_t* writeBack);//[0] = hours, [1] = minutes, [2] = seconds
 
 //functions
-uint32_t emulatorInit(uint8_t emulatedDevice, uint8_t* palmRomData, uint32_t palmRomSize, uint8_t* palmBootloaderData, uint32_t palmBootloaderSize, bool syncRtc, bool allowInvalidBehavior);
+uint32_t emulatorInit(uint8_t emulatedDevice, uint8_t* palmRomData, uint32_t palmRomSize, uint8_t* palmBootloaderData, uint32_t palmBootloaderSize, bool syncRtc, bool allowInvalidBehavior, uint8_t armCore);
 void emulatorDeinit(void);
 void emulatorHardReset(void);
 void emulatorSoftReset(void);
@@ -225,7 +233,12 @@ bool emulatorLoadState(uint8_t* data, uint32_t size);//true = success
 uint32_t emulatorGetRamSize(void);
 bool emulatorSaveRam(uint8_t* data, uint32_t size);//true = success
 bool emulatorLoadRam(uint8_t* data, uint32_t size);//true = success
+uint64_t emulatorGetCommittedMemory(void);//host bytes backing guest memory, on OS 5 this includes the flags and address cache pages committed so far
+uint32_t emulatorGetTranslationCacheSize(void);//0 when there is nothing to save, only the OS 5 dynarec keeps translations
+bool emulatorSaveTranslationCache(uint8_t* data, uint32_t size);//true = success
+bool emulatorLoadTranslationCache(uint8_t* data, uint32_t size);//true = success, call before the first frame, a cache from a different ROM or build is rejected
 uint32_t emulatorInsertSdCard(uint8_t* data, uint32_t size, sd_card_info_t* sdInfo);//use (NULL, desired size) to create a new empty SD card, pass NULL for sdInfo to use defaults
+uint32_t emulatorInsertVirtualSdCard(const sd_card_virtual_volume_t* volume, sd_card_info_t* sdInfo);//guest writes are kept in memory until ejected, virtual cards are not part of save states and have no raw data
 uint32_t emulatorGetSdCardSize(void);
 uint32_t emulatorGetSdCardData(uint8_t* data, uint32_t size);
 void emulatorEjectSdCard(void);
@@ -2,12 +2,19 @@
 #include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdio.h>
 
 #include "../emulator.h"
 #include "../portability.h"
 #include "../m68k/m68k.h"
 #include "../m68k/m68kcpu.h"
+#include "../m68k/m68kops.h"
 #include "../dbvz.h"
+#include "../m5XXBus.h"
+#include "../sdCard.h"
+#if defined(EMU_SUPPORT_PALM_OS5)
+#include "../tungstenT3Bus.h"
+#endif
 #include "launcher.h"
 
 
@@ -21,6 +28,9 @@ typedef struct{
 
 
 #define LAUNCHER_TOUCH_DURATION 0.3//in seconds
+#define LAUNCHER_GUEST_CALL_SLICE 100000//in m68k cycles, the slice is ended early when the function returns
+#define LAUNCHER_GUEST_CALL_SENTINEL 0x4848//BKPT #0, illegal on the 68000 so nothing else uses it
+#define LAUNCHER_BOOT_CACHE_PATH_SIZE 1024
 
 //APIs called by this file
 #define MemChunkNew                    0xA011
@@ -34,6 +44,12 @@ typedef struct{
 bool launcherSaveSdCardImage;
 
 
+static void (*launcherSentinelOldHandler)(void);
+static uint32_t launcherSentinelAddress;
+static bool launcherSentinelHit;
+static char launcherBootCacheDirectory[LAUNCHER_BOOT_CACHE_PATH_SIZE];
+
+
 static uint32_t launcherM5XXGetStackFrameSize(const char* prototype){
    const char* params = prototype + 2;
    uint32_t size = 0;
@@ -62,6 +78,18 @@ static uint32_t launcherM5XXGetStackFrameSize(const char* prototype){
    return size;
 }
 
+static void launcherM5XXSentinelHandler(void){
+   //the guest function returned, only treat it as the sentinel if it was hit at the expected address, anything else is a real illegal opcode
+   if(REG_PPC == launcherSentinelAddress){
+      REG_PC = REG_PPC;
+      launcherSentinelHit = true;
+      m68k_end_timeslice();
+   }
+   else{
+      launcherSentinelOldHandler();
+   }
+}
+
 static uint32_t launcherM5XXCallGuestFunction(uint32_t address, uint16_t trap, const char* prototype, uint32_t* argData){
    //prototype is a Java style function signature describing values passed and returned "v(wllp)"
    //is return void and pass a uint16_t(word), 2 uint32_t(long) and 1 pointer
@@ -131,13 +159,21 @@ static uint32_t launcherM5XXCallGuestFunction(uint32_t address, uint16_t trap, c
       callWriteOut += 2;
    }
 
+   //returning lands on the sentinel, which ends the timeslice so the function can run at full speed instead of 1 opcode at a time
+   m68k_write_memory_16(callWriteOut, LAUNCHER_GUEST_CALL_SENTINEL);
+   launcherSentinelAddress = callWriteOut;
+   launcherSentinelHit = false;
+   launcherSentinelOldHandler = m68ki_instruction_jump_table[LAUNCHER_GUEST_CALL_SENTINEL];
+   m68ki_instruction_jump_table[LAUNCHER_GUEST_CALL_SENTINEL] = launcherM5XXSentinelHandler;
+
    m68ki_cpu.stopped = 0;
    m68k_set_reg(M68K_REG_SP, stackFrameStart - newStackFrameSize);
    m68k_set_reg(M68K_REG_PC, callStart);
 
-   //run until function returns
-   while(m68k_get_reg(NULL, M68K_REG_PC) != callWriteOut)
-      m68k_execute(1);//m68k_execute() always runs requested cycles + extra cycles of the final opcode, this executes 1 opcode
+   //run until function returns, m68k_execute() is called directly so the DBVZ timers and interrupts dont run during the call
+   while(!launcherSentinelHit)
+      m68k_execute(LAUNCHER_GUEST_CALL_SLICE);
+   m68ki_instruction_jump_table[LAUNCHER_GUEST_CALL_SENTINEL] = launcherSentinelOldHandler;
    if(prototype[0] == 'p')
       functionReturn = m68k_get_reg(NULL, M68K_REG_A0);
    else if(prototype[0] == 'b' || prototype[0] == 'w' || prototype[0] == 'l')
@@ -358,9 +394,176 @@ static void launcherPushHomeButtonTouchscreenTungstenT3(void){
 }
 #endif
 
+static uint64_t launcherHashBuffer(uint64_t hash, const uint8_t* data, uint32_t size){
+   //64 bit FNV-1a
+   uint32_t index;
+
+   for(index = 0; index < size; index++){
+      hash ^= data[index];
+      hash *= UINT64_C(0x00000100000001B3);
+   }
+
+   return hash;
+}
+
+static bool launcherGetBootCachePath(char* path){
+   uint64_t hash = UINT64_C(0xCBF29CE484222325);
+   uint32_t value;
+
+   if(launcherBootCacheDirectory[0] == '\0')
+      return false;
+
+#if defined(EMU_SUPPORT_PALM_OS5)
+   //the T3 state is missing most of the PXA260 peripherals, a restored boot would run a booted OS on reset hardware
+   if(palmEmulatingTungstenT3)
+      return false;
+#endif
+
+   //the snapshot is only valid for the exact same device, ROM, bootloader, RAM size and state format
+   value = palmEmulatingM500;
+   hash = launcherHashBuffer(hash, (uint8_t*)&value, sizeof(value));
+   value = emulatorGetRamSize();
+   hash = launcherHashBuffer(hash, (uint8_t*)&value, sizeof(value));
+   value = SAVE_STATE_VERSION;
+   hash = launcherHashBuffer(hash, (uint8_t*)&value, sizeof(value));
+   value = emulatorGetStateSize();
+   hash = launcherHashBuffer(hash, (uint8_t*)&value, sizeof(value));
+   hash = launcherHashBuffer(hash, palmRom, M5XX_ROM_SIZE);
+   hash = launcherHashBuffer(hash, dbvzReg + DBVZ_REG_SIZE - DBVZ_BOOTLOADER_SIZE, DBVZ_BOOTLOADER_SIZE);
+
+   return snprintf(path, LAUNCHER_BOOT_CACHE_PATH_SIZE, "%s/boot-%08X%08X.state", launcherBootCacheDirectory, (uint32_t)(hash >> 32), (uint32_t)hash) < LAUNCHER_BOOT_CACHE_PATH_SIZE;
+}
+
+static bool launcherLoadBootCache(const char* path){
+   FILE* stateFile = fopen(path, "rb");
+   uint32_t stateSize = emulatorGetStateSize();
+   uint8_t* stateData;
+   bool loaded = false;
+
+   if(!stateFile)
+      return false;
+
+   stateData = malloc(stateSize);
+   if(stateData){
+      //a short file is an interrupted write, dont try to load it
+      if(fread(stateData, 1, stateSize, stateFile) == stateSize && fgetc(stateFile) == EOF)
+         loaded = emulatorLoadState(stateData, stateSize);
+      free(stateData);
+   }
+   fclose(stateFile);
+
+   return loaded;
+}
+
+static void launcherWriteCacheFile(const char* path, const uint8_t* data, uint32_t size){
+   char tempPath[LAUNCHER_BOOT_CACHE_PATH_SIZE + 4];
+   FILE* cacheFile;
+   bool written;
+
+   //write to a temp file first so another instance never sees a partial file
+   snprintf(tempPath, sizeof(tempPath), "%s.tmp", path);
+   cacheFile = fopen(tempPath, "wb");
+   if(cacheFile){
+      written = fwrite(data, 1, size, cacheFile) == size;
+      written = fclose(cacheFile) == 0 && written;
+      if(!written || rename(tempPath, path) != 0)
+         remove(tempPath);
+   }
+}
+
+static void launcherSaveBootCache(const char* path){
+   uint32_t stateSize = emulatorGetStateSize();
+   uint8_t* stateData = malloc(stateSize);
+
+   if(!stateData)
+      return;
+
+   emulatorSaveState(stateData, stateSize);//no need to check for errors since the buffer is always the right size
+   launcherWriteCacheFile(path, stateData, stateSize);
+
+   free(stateData);
+}
+
+#if defined(EMU_SUPPORT_PALM_OS5)
+static bool launcherGetTranslationCachePath(char* path){
+   uint64_t hash;
+
+   //only the OS 5 dynarec keeps translations, they depend on nothing but the ROM, the translator checks its own version
+   if(launcherBootCacheDirectory[0] == '\0' || !palmEmulatingTungstenT3)
+      return false;
+
+   hash = launcherHashBuffer(UINT64_C(0xCBF29CE484222325), palmRom, TUNGSTEN_T3_ROM_SIZE);
+
+   return snprintf(path, LAUNCHER_BOOT_CACHE_PATH_SIZE, "%s/translations-%08X%08X.bin", launcherBootCacheDirectory, (uint32_t)(hash >> 32), (uint32_t)hash) < LAUNCHER_BOOT_CACHE_PATH_SIZE;
+}
+
+static void launcherLoadTranslationCache(const char* path){
+   FILE* cacheFile = fopen(path, "rb");
+   long cacheSize;
+   uint8_t* cacheData;
+
+   if(!cacheFile)
+      return;
+
+   if(fseek(cacheFile, 0, SEEK_END) == 0 && (cacheSize = ftell(cacheFile)) > 0 && fseek(cacheFile, 0, SEEK_SET) == 0){
+      cacheData = malloc(cacheSize);
+      if(cacheData){
+         //a cache from another build or a damaged file is rejected, the blocks are just translated again
+         if(fread(cacheData, 1, cacheSize, cacheFile) == (size_t)cacheSize)
+            emulatorLoadTranslationCache(cacheData, cacheSize);
+         free(cacheData);
+      }
+   }
+   fclose(cacheFile);
+}
+
+static void launcherSaveTranslationCache(const char* path){
+   uint32_t cacheSize = emulatorGetTranslationCacheSize();
+   uint8_t* cacheData;
+
+   if(cacheSize == 0)
+      return;
+
+   cacheData = malloc(cacheSize);
+   if(!cacheData)
+      return;
+
+   if(emulatorSaveTranslationCache(cacheData, cacheSize))
+      launcherWriteCacheFile(path, cacheData, cacheSize);
+
+   free(cacheData);
+}
+#endif
+
+void launcherSetBootCacheDirectory(const char* path){
+   if(path && strlen(path) < LAUNCHER_BOOT_CACHE_PATH_SIZE)
+      strcpy(launcherBootCacheDirectory, path);
+   else
+      launcherBootCacheDirectory[0] = '\0';
+}
+
 void launcherBootInstantly(bool hasSram){
+   char bootCachePath[LAUNCHER_BOOT_CACHE_PATH_SIZE];
+#if defined(EMU_SUPPORT_PALM_OS5)
+   char translationCachePath[LAUNCHER_BOOT_CACHE_PATH_SIZE];
+   bool useTranslationCache = launcherGetTranslationCachePath(translationCachePath);
+#endif
+   bool useBootCache = false;
    uint32_t index;
 
+#if defined(EMU_SUPPORT_PALM_OS5)
+   //the ROM code translated on earlier runs, this has to happen before the first frame
+   if(useTranslationCache)
+      launcherLoadTranslationCache(translationCachePath);
+#endif
+
+   //a cold boot with no SD card always ends in the same state, so it only needs to be run once per ROM
+   if(!hasSram && !sdCardIsInserted() && launcherGetBootCachePath(bootCachePath)){
+      if(launcherLoadBootCache(bootCachePath))
+         return;
+      useBootCache = true;
+   }
+
    if(hasSram){
       //just boot from SRAM
       for(index = 0; index < EMU_FPS * 7.0; index++)
@@ -394,7 +597,16 @@ void launcherBootInstantly(bool hasSram){
       //give it time to go home
       for(index = 0; index < EMU_FPS * 1.0; index++)
          emulatorSkipFrame();
+
+      if(useBootCache)
+         launcherSaveBootCache(bootCachePath);
    }
+
+#if defined(EMU_SUPPORT_PALM_OS5)
+   //everything the boot translated is kept for the next run
+   if(useTranslationCache)
+      launcherSaveTranslationCache(translationCachePath);
+#endif
 }
 
 uint32_t launcherInstallFile(uint8_t* data, uint32_t size){
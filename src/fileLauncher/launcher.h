@@ -11,6 +11,7 @@ extern "C" {
 
 #include "../emulator.h"
 
+void launcherSetBootCacheDirectory(const char* path);//NULL disables it, cold m5XX boots without an SD card are saved here and restored instead of being rerun, the RTC comes from the snapshot unless syncRtc is on, on OS 5 the ROM translations from the boot are kept here too
 void launcherBootInstantly(bool hasSram);//fastforwards through the boot sequence
 uint32_t launcherInstallFile(uint8_t* data, uint32_t size);//only call after the emu has booted, launcherBootInstantly() will ensure a full boot has completed otherwise this is up to the frontend to be safe
 bool launcherIsExecutable(uint8_t* data, uint32_t size);
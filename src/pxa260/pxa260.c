@@ -16,10 +16,9 @@
 #include "pxa260Ssp.h"
 #include "pxa260Udc.h"
 #include "pxa260Timing.h"
-#if !defined(EMU_NO_SAFETY)
+#include "pxa260_CPU.h"
 #include "../armv5te/uArm/CPU_2.h"
 #include "../armv5te/uArm/uArmGlue.h"
-#endif
 #include "../armv5te/cpu.h"
 #include "../armv5te/emu.h"
 #include "../armv5te/mem.h"
@@ -29,43 +28,52 @@
 #include "../tungstenT3Bus.h"
 #include "../tsc2101.h"
 #include "../tps65010.h"
+#include "../w86l488.h"
 #include "../emulator.h"
+#include "../portability.h"
 
 
 #define PXA260_IO_BASE 0x40000000
-#define PXA260_MEMCTRL_BASE 0x48000000
+#define PXA260_IO_SIZE 0x04000000
+#define PXA260_IO_BLOCK_SIZE 0x00010000
+#define PXA260_LCD_BANK_SIZE 0x04000000
+#define PXA260_MEMCTRL_BANK_SIZE 0x04000000
 
 #define PXA260_TIMER_TICKS_PER_FRAME (TUNGSTEN_T3_CPU_CRYSTAL_FREQUENCY / EMU_FPS)
 
-#if !defined(EMU_NO_SAFETY)
+bool         pxa260UsingUarm;
 ArmCpu       pxa260CpuState;
-#endif
 uint16_t*    pxa260Framebuffer;
 Pxa260pwrClk pxa260PwrClk;
 Pxa260ic     pxa260Ic;
 Pxa260gpio   pxa260Gpio;
 Pxa260timr   pxa260Timer;
+Pxa260dma    pxa260Dma;
 
 static Pxa260lcd  pxa260Lcd;
 
 
 #include "pxa260Accessors.c.h"
 
-bool pxa260Init(uint8_t** returnRom, uint8_t** returnRam){
+bool pxa260Init(uint8_t** returnRom, uint8_t** returnRam, bool useUarm){
    uint32_t mem_offset = 0;
-   uint8_t i;
 
    //set timing callback pointers
    pxa260TimingInit();
 
-   //enable dynarec if available
-   do_translate = true;
+   //enable dynarec if available, if the translation buffer cant be allocated the armv5te interpreter is used instead
+   pxa260UsingUarm = useUarm;
+#if !defined(NO_TRANSLATION)
+   do_translate = !useUarm && translate_init();
+#else
+   do_translate = false;
+#endif
 
-   mem_and_flags = os_reserve(MEM_MAXSIZE * 2);
-   if(!mem_and_flags)
+   //flag pages are committed before the first flag in them is set, addr_cache pages only if the host allows demand paging
+   if(!mem_and_flags_init())
       return false;
 
-   addr_cache_init();
+   addr_cache_init(palmDemandPaging);
    memset(mem_areas, 0x00, sizeof(mem_areas));
 
    //regions
@@ -84,69 +92,33 @@ bool pxa260Init(uint8_t** returnRom, uint8_t** returnRam){
    //memory regions that are not directly mapped to a buffer are not added to mem_areas
    //adding them causes SIGSEGVs
 
-   //accessors
-   //default
-   for(i = 0; i < PXA260_TOTAL_MEMORY_BANKS; i++){
-       // will fallback to bad_* on non-memory addresses
-       read_byte_map[i] = memory_read_byte;
-       read_half_map[i] = memory_read_half;
-       read_word_map[i] = memory_read_word;
-       write_byte_map[i] = memory_write_byte;
-       write_half_map[i] = memory_write_half;
-       write_word_map[i] = memory_write_word;
-   }
-
-   //PCMCIA0
-   for(i = PXA260_START_BANK(PXA260_PCMCIA0_START_ADDRESS); i <= PXA260_END_BANK(PXA260_PCMCIA0_START_ADDRESS, PXA260_PCMCIA0_SIZE); i++){
-       read_byte_map[i] = pxa260_pcmcia0_read_byte;
-       read_half_map[i] = pxa260_pcmcia0_read_half;
-       read_word_map[i] = pxa260_pcmcia0_read_word;
-       write_byte_map[i] = pxa260_pcmcia0_write_byte;
-       write_half_map[i] = pxa260_pcmcia0_write_half;
-       write_word_map[i] = pxa260_pcmcia0_write_word;
-   }
-
-   //PCMCIA1
-   for(i = PXA260_START_BANK(PXA260_PCMCIA1_START_ADDRESS); i <= PXA260_END_BANK(PXA260_PCMCIA1_START_ADDRESS, PXA260_PCMCIA1_SIZE); i++){
-       read_byte_map[i] = pxa260_pcmcia1_read_byte;
-       read_half_map[i] = pxa260_pcmcia1_read_half;
-       read_word_map[i] = pxa260_pcmcia1_read_word;
-       write_byte_map[i] = pxa260_pcmcia1_write_byte;
-       write_half_map[i] = pxa260_pcmcia1_write_half;
-       write_word_map[i] = pxa260_pcmcia1_write_word;
-   }
-
-   //IO
-   read_byte_map[PXA260_START_BANK(PXA260_IO_BASE)] = pxa260_io_read_byte;
-   read_half_map[PXA260_START_BANK(PXA260_IO_BASE)] = pxa260_io_read_half;
-   read_word_map[PXA260_START_BANK(PXA260_IO_BASE)] = pxa260_io_read_word;
-   write_byte_map[PXA260_START_BANK(PXA260_IO_BASE)] = pxa260_io_write_byte;
-   write_half_map[PXA260_START_BANK(PXA260_IO_BASE)] = pxa260_io_write_half;
-   write_word_map[PXA260_START_BANK(PXA260_IO_BASE)] = pxa260_io_write_word;
-
-   //LCD
-   read_byte_map[PXA260_START_BANK(PXA260_LCD_BASE)] = bad_read_byte;
-   read_half_map[PXA260_START_BANK(PXA260_LCD_BASE)] = bad_read_half;
-   read_word_map[PXA260_START_BANK(PXA260_LCD_BASE)] = pxa260_lcd_read_word;
-   write_byte_map[PXA260_START_BANK(PXA260_LCD_BASE)] = bad_write_byte;
-   write_half_map[PXA260_START_BANK(PXA260_LCD_BASE)] = bad_write_half;
-   write_word_map[PXA260_START_BANK(PXA260_LCD_BASE)] = pxa260_lcd_write_word;
-
-   //MEMCTRL
-   read_byte_map[PXA260_START_BANK(PXA260_MEMCTRL_BASE)] = bad_read_byte;
-   read_half_map[PXA260_START_BANK(PXA260_MEMCTRL_BASE)] = bad_read_half;
-   read_word_map[PXA260_START_BANK(PXA260_MEMCTRL_BASE)] = pxa260MemctrlReadWord;
-   write_byte_map[PXA260_START_BANK(PXA260_MEMCTRL_BASE)] = bad_write_byte;
-   write_half_map[PXA260_START_BANK(PXA260_MEMCTRL_BASE)] = bad_write_half;
-   write_word_map[PXA260_START_BANK(PXA260_MEMCTRL_BASE)] = pxa260MemctrlWriteWord;
-
-   //W86L488
-   read_byte_map[PXA260_START_BANK(TUNGSTEN_T3_W86L488_START_ADDRESS)] = bad_read_byte;
-   read_half_map[PXA260_START_BANK(TUNGSTEN_T3_W86L488_START_ADDRESS)] = pxa260_static_chip_select_2_read_half;
-   read_word_map[PXA260_START_BANK(TUNGSTEN_T3_W86L488_START_ADDRESS)] = bad_read_word;
-   write_byte_map[PXA260_START_BANK(TUNGSTEN_T3_W86L488_START_ADDRESS)] = bad_write_byte;
-   write_half_map[PXA260_START_BANK(TUNGSTEN_T3_W86L488_START_ADDRESS)] = pxa260_static_chip_select_2_write_half;
-   write_word_map[PXA260_START_BANK(TUNGSTEN_T3_W86L488_START_ADDRESS)] = bad_write_word;
+   //accessors, everything not mapped goes to bad_*
+   mem_map_reset();
+   if(!mem_map_memory(mem_areas[0].base, mem_areas[0].size, mem_areas[0].ptr))
+      return false;
+   if(!mem_map_memory(mem_areas[1].base, mem_areas[1].size, mem_areas[1].ptr))
+      return false;
+   mem_map_mmio(PXA260_PCMCIA0_START_ADDRESS, PXA260_PCMCIA0_SIZE, &pxa260Pcmcia0Handlers);
+   mem_map_mmio(PXA260_PCMCIA1_START_ADDRESS, PXA260_PCMCIA1_SIZE, &pxa260Pcmcia1Handlers);
+   mem_map_mmio(TUNGSTEN_T3_W86L488_START_ADDRESS, TUNGSTEN_T3_W86L488_SIZE, &pxa260StaticChipSelect2Handlers);
+   mem_map_mmio(PXA260_LCD_BASE, PXA260_LCD_BANK_SIZE, &pxa260LcdHandlers);
+   mem_map_mmio(PXA260_MEMCTRL_BASE, PXA260_MEMCTRL_BANK_SIZE, &pxa260MemctrlHandlers);
+
+   //IO, each peripheral decodes a 64KB block, only split sections need a page table
+   mem_map_mmio(PXA260_IO_BASE, PXA260_IO_SIZE, &pxa260IoHandlers);
+   mem_map_mmio(PXA260_DMA_BASE, PXA260_IO_BLOCK_SIZE, &pxa260DmaHandlers);
+   mem_map_mmio(PXA260_FFUART_BASE, PXA260_IO_BLOCK_SIZE, &pxa260UnimplementedHandlers);
+   mem_map_mmio(PXA260_BTUART_BASE, PXA260_IO_BLOCK_SIZE, &pxa260UnimplementedHandlers);
+   mem_map_mmio(PXA260_I2C_BASE, PXA260_IO_BLOCK_SIZE, &pxa260I2cHandlers);
+   mem_map_mmio(PXA260_UDC_BASE, PXA260_IO_BLOCK_SIZE, &pxa260UdcHandlers);
+   mem_map_mmio(PXA260_STUART_BASE, PXA260_IO_BLOCK_SIZE, &pxa260UnimplementedHandlers);
+   mem_map_mmio(PXA260_RTC_BASE, PXA260_IO_BLOCK_SIZE, &pxa260UnimplementedHandlers);
+   mem_map_mmio(PXA260_TIMR_BASE, PXA260_IO_BLOCK_SIZE, &pxa260TimerHandlers);
+   mem_map_mmio(PXA260_IC_BASE, PXA260_IO_BLOCK_SIZE, &pxa260IcHandlers);
+   mem_map_mmio(PXA260_GPIO_BASE, PXA260_IO_BLOCK_SIZE, &pxa260GpioHandlers);
+   mem_map_mmio(PXA260_POWER_MANAGER_BASE, PXA260_IO_BLOCK_SIZE, &pxa260PowerManagerHandlers);
+   mem_map_mmio(PXA260_SSP_BASE, PXA260_IO_BLOCK_SIZE, &pxa260SspHandlers);
+   mem_map_mmio(PXA260_CLOCK_MANAGER_BASE, PXA260_IO_BLOCK_SIZE, &pxa260ClockManagerHandlers);
 
    *returnRom = mem_areas[0].ptr;
    *returnRam = mem_areas[1].ptr;
@@ -159,11 +131,15 @@ void pxa260Deinit(void){
        // translation_table uses absolute addresses
        flush_translations();
        memset(mem_areas, 0, sizeof(mem_areas));
-       os_free(mem_and_flags, MEM_MAXSIZE * 2);
-       mem_and_flags = NULL;
+       mem_and_flags_deinit();
    }
 
+   mem_map_reset();
+
    addr_cache_deinit();
+#if !defined(NO_TRANSLATION)
+   translate_deinit();
+#endif
 }
 
 void pxa260Reset(void){
@@ -191,27 +167,26 @@ void pxa260Reset(void){
    pxa260lcdInit(&pxa260Lcd, &pxa260Ic);
    pxa260timrInit(&pxa260Timer, &pxa260Ic);
    pxa260gpioInit(&pxa260Gpio, &pxa260Ic);
+   pxa260dmaInit(&pxa260Dma, &pxa260Ic);
    pxa260I2cReset();
    pxa260MemctrlReset();
    pxa260SspReset();
    pxa260UdcReset();
    pxa260TimingReset();
 
-   //set first timer event
-   pxa260TimingTriggerEvent(PXA260_TIMING_CALLBACK_TICK_CPU_TIMER, TUNGSTEN_T3_CPU_PLL_FREQUENCY / TUNGSTEN_T3_CPU_CRYSTAL_FREQUENCY);
-
-#if !defined(EMU_NO_SAFETY)
-   debugLog("Using uARM CPU core!\n");
-   cpuInit(&pxa260CpuState, 0x00000000, uArmMemAccess, uArmEmulErr, uArmHypercall, uArmSetFaultAddr);
-   uArmInitCpXX(&pxa260CpuState);
-#else
+   //the armv5te state is always valid, uARM just mirrors it when its being used
    memset(&arm, 0, sizeof arm);
    arm.control = 0x00050078;
    arm.cpsr_low28 = MODE_SVC | 0xC0;
    cycle_count_delta = 0;
    cpu_events = 0;
    //cpu_events &= EVENT_DEBUG_STEP;
-#endif
+
+   if(pxa260UsingUarm){
+      debugLog("Using uARM CPU core!\n");
+      cpuInit(&pxa260CpuState, 0x00000000, uArmMemAccess, uArmEmulErr, uArmHypercall, uArmSetFaultAddr);
+      uArmInitCpXX(&pxa260CpuState);
+   }
 
    addr_cache_flush();//SIGSEGVs on reset without this because the MMU needs to be turned off
 
@@ -225,21 +200,183 @@ void pxa260SetRtc(uint16_t days, uint8_t hours, uint8_t minutes, uint8_t seconds
 uint32_t pxa260StateSize(void){
    uint32_t size = 0;
 
+   //both CPU cores are saved in the armv5te layout so states can be loaded with either core
+   size += sizeof(uint32_t) * 49;//arm
+   size += sizeof(uint8_t) * 3;//arm
+   size += pxa260TimingStateSize();
+
    return size;
 }
 
 void pxa260SaveState(uint8_t* data){
    uint32_t offset = 0;
+   uint8_t index;
+
+   if(pxa260UsingUarm)
+      uArmStateToArmv5te(&pxa260CpuState);
 
+   //CPU
+   for(index = 0; index < 16; index++){
+      writeStateValue32(data + offset, arm.reg[index]);
+      offset += sizeof(uint32_t);
+   }
+   writeStateValue32(data + offset, get_cpsr());
+   offset += sizeof(uint32_t);
+   writeStateValue32(data + offset, arm.control);
+   offset += sizeof(uint32_t);
+   writeStateValue32(data + offset, arm.translation_table_base);
+   offset += sizeof(uint32_t);
+   writeStateValue32(data + offset, arm.domain_access_control);
+   offset += sizeof(uint32_t);
+   writeStateValue32(data + offset, arm.fault_address);
+   offset += sizeof(uint32_t);
+   writeStateValue8(data + offset, arm.data_fault_status);
+   offset += sizeof(uint8_t);
+   writeStateValue8(data + offset, arm.instruction_fault_status);
+   offset += sizeof(uint8_t);
+   for(index = 0; index < 5; index++){
+      writeStateValue32(data + offset, arm.r8_usr[index]);
+      offset += sizeof(uint32_t);
+      writeStateValue32(data + offset, arm.r8_fiq[index]);
+      offset += sizeof(uint32_t);
+   }
+   for(index = 0; index < 2; index++){
+      writeStateValue32(data + offset, arm.r13_usr[index]);
+      offset += sizeof(uint32_t);
+      writeStateValue32(data + offset, arm.r13_fiq[index]);
+      offset += sizeof(uint32_t);
+      writeStateValue32(data + offset, arm.r13_irq[index]);
+      offset += sizeof(uint32_t);
+      writeStateValue32(data + offset, arm.r13_svc[index]);
+      offset += sizeof(uint32_t);
+      writeStateValue32(data + offset, arm.r13_abt[index]);
+      offset += sizeof(uint32_t);
+      writeStateValue32(data + offset, arm.r13_und[index]);
+      offset += sizeof(uint32_t);
+   }
+   writeStateValue32(data + offset, arm.spsr_fiq);
+   offset += sizeof(uint32_t);
+   writeStateValue32(data + offset, arm.spsr_irq);
+   offset += sizeof(uint32_t);
+   writeStateValue32(data + offset, arm.spsr_svc);
+   offset += sizeof(uint32_t);
+   writeStateValue32(data + offset, arm.spsr_abt);
+   offset += sizeof(uint32_t);
+   writeStateValue32(data + offset, arm.spsr_und);
+   offset += sizeof(uint32_t);
+   writeStateValue8(data + offset, arm.interrupts);
+   offset += sizeof(uint8_t);
+   writeStateValue32(data + offset, cpu_events);
+   offset += sizeof(uint32_t);
+
+   //timing
+   pxa260TimingSaveState(data + offset);
+   offset += pxa260TimingStateSize();
 }
 
 void pxa260LoadState(uint8_t* data){
    uint32_t offset = 0;
+   uint8_t index;
+   uint32_t cpsr;
+
+   //CPU
+   for(index = 0; index < 16; index++){
+      arm.reg[index] = readStateValue32(data + offset);
+      offset += sizeof(uint32_t);
+   }
+   cpsr = readStateValue32(data + offset);
+   offset += sizeof(uint32_t);
+   arm.cpsr_low28 = cpsr & 0x090000FF;
+   set_cpsr_flags(cpsr);
+   arm.control = readStateValue32(data + offset);
+   offset += sizeof(uint32_t);
+   arm.translation_table_base = readStateValue32(data + offset);
+   offset += sizeof(uint32_t);
+   arm.domain_access_control = readStateValue32(data + offset);
+   offset += sizeof(uint32_t);
+   arm.fault_address = readStateValue32(data + offset);
+   offset += sizeof(uint32_t);
+   arm.data_fault_status = readStateValue8(data + offset);
+   offset += sizeof(uint8_t);
+   arm.instruction_fault_status = readStateValue8(data + offset);
+   offset += sizeof(uint8_t);
+   for(index = 0; index < 5; index++){
+      arm.r8_usr[index] = readStateValue32(data + offset);
+      offset += sizeof(uint32_t);
+      arm.r8_fiq[index] = readStateValue32(data + offset);
+      offset += sizeof(uint32_t);
+   }
+   for(index = 0; index < 2; index++){
+      arm.r13_usr[index] = readStateValue32(data + offset);
+      offset += sizeof(uint32_t);
+      arm.r13_fiq[index] = readStateValue32(data + offset);
+      offset += sizeof(uint32_t);
+      arm.r13_irq[index] = readStateValue32(data + offset);
+      offset += sizeof(uint32_t);
+      arm.r13_svc[index] = readStateValue32(data + offset);
+      offset += sizeof(uint32_t);
+      arm.r13_abt[index] = readStateValue32(data + offset);
+      offset += sizeof(uint32_t);
+      arm.r13_und[index] = readStateValue32(data + offset);
+      offset += sizeof(uint32_t);
+   }
+   arm.spsr_fiq = readStateValue32(data + offset);
+   offset += sizeof(uint32_t);
+   arm.spsr_irq = readStateValue32(data + offset);
+   offset += sizeof(uint32_t);
+   arm.spsr_svc = readStateValue32(data + offset);
+   offset += sizeof(uint32_t);
+   arm.spsr_abt = readStateValue32(data + offset);
+   offset += sizeof(uint32_t);
+   arm.spsr_und = readStateValue32(data + offset);
+   offset += sizeof(uint32_t);
+   arm.interrupts = readStateValue8(data + offset);
+   offset += sizeof(uint8_t);
+   cpu_events = readStateValue32(data + offset);
+   offset += sizeof(uint32_t);
+
+   //timing
+   pxa260TimingLoadState(data + offset);
+   offset += pxa260TimingStateSize();
+
+   //MMU state changed, this also drops all translations and the uARM icache
+   addr_cache_flush();
+
+   if(pxa260UsingUarm)
+      uArmStateFromArmv5te(&pxa260CpuState);
+}
+
+uint64_t pxa260GetCommittedMemory(void){
+   return mem_committed_bytes() + addr_cache_committed_bytes();
+}
+
+uint32_t pxa260TranslationCacheSize(void){
+#if !defined(NO_TRANSLATION)
+   if(!pxa260UsingUarm)
+      return translate_cache_size();
+#endif
+   return 0;
+}
+
+bool pxa260SaveTranslationCache(uint8_t* data, uint32_t size){
+#if !defined(NO_TRANSLATION)
+   if(!pxa260UsingUarm)
+      return translate_cache_save(data, size);
+#endif
+   return false;
+}
 
+bool pxa260LoadTranslationCache(uint8_t* data, uint32_t size){
+   //must be loaded before the first ROM block is translated, blocks are only installed when they are reached
+#if !defined(NO_TRANSLATION)
+   if(!pxa260UsingUarm && do_translate)
+      return translate_cache_load(data, size);
+#endif
+   return false;
 }
 
 void pxa260Execute(bool wantVideo){
-   tsc2101UpdateInterrupt();
+   tsc2101UpdatePen();
    tps65010UpdateInterrupt();
    pxa260gpioUpdateKeyMatrix(&pxa260Gpio);
 
@@ -250,51 +387,88 @@ void pxa260Execute(bool wantVideo){
       pxa260lcdFrame(&pxa260Lcd);
 }
 
+UInt32 pxa260CpuGetReg(UInt8 reg){
+   if(pxa260UsingUarm)
+      return cpuGetRegExternal(&pxa260CpuState, reg);
+   return reg_pc(reg);
+}
+
+void pxa260CpuSetReg(UInt8 reg, UInt32 value){
+   if(pxa260UsingUarm)
+      cpuSetReg(&pxa260CpuState, reg, value);
+   else
+      set_reg(reg, value);
+}
+
+void pxa260CpuIrq(Boolean fiq, Boolean raise){
+   uint8_t line = fiq ? 0x40 : 0x80;
+
+   //the interrupt line is always tracked in the armv5te state so masking works and it can be saved
+   if(raise)
+      arm.interrupts |= line;
+   else
+      arm.interrupts &= ~line;
+
+   if(pxa260UsingUarm)
+      cpuIrq(&pxa260CpuState, fiq, raise);
+   else
+      cpu_int_check();
+}
+
+void pxa260CpuWaitForInterrupt(void){
+   //any pending interrupt wakes the CPU even if its masked, the PC is left after the wait instruction for both cores
+   if(arm.interrupts != 0)
+      return;
+
+   cpu_events |= EVENT_WAITING;
+   if(pxa260UsingUarm)
+      pxa260CpuState.runCyclesLeft = 0;
+   else
+      cycle_count_delta = 0;
+}
+
 uint32_t pxa260GetRegister(uint8_t reg){
-#if !defined(EMU_NO_SAFETY)
-   return cpuGetRegExternal(&pxa260CpuState, reg);
-#else
+   if(pxa260UsingUarm)
+      return cpuGetRegExternal(&pxa260CpuState, reg);
    return reg_pc_mem(reg);
-#endif
 }
 
 uint32_t pxa260GetCpsr(void){
-#if !defined(EMU_NO_SAFETY)
-   return cpuGetRegExternal(&pxa260CpuState, ARM_REG_NUM_CPSR);
-#else
+   if(pxa260UsingUarm)
+      return cpuGetRegExternal(&pxa260CpuState, ARM_REG_NUM_CPSR);
    return get_cpsr();
-#endif
 }
 
 uint32_t pxa260GetSpsr(void){
-#if !defined(EMU_NO_SAFETY)
-   return cpuGetRegExternal(&pxa260CpuState, ARM_REG_NUM_SPSR);
-#else
+   if(pxa260UsingUarm)
+      return cpuGetRegExternal(&pxa260CpuState, ARM_REG_NUM_SPSR);
    return get_spsr();
-#endif
 }
 
 uint64_t pxa260ReadArbitraryMemory(uint32_t address, uint8_t size){
    uint64_t data = UINT64_MAX;//invalid access
+   const mem_mmio_handlers* handlers;
 
    address = mmu_translate(address, false, NULL, NULL);
 
+   handlers = mem_get_handlers(address);
+
    switch(size){
       case 8:
-         if(read_byte_map[address >> 26] != bad_read_byte){
-            data = read_byte_map[address >> 26](address);
+         if(handlers->read_byte != bad_read_byte){
+            data = handlers->read_byte(address);
          }
          break;
 
       case 16:
-         if(read_half_map[address >> 26] != bad_read_half){
-            data = read_half_map[address >> 26](address);
+         if(handlers->read_half != bad_read_half){
+            data = handlers->read_half(address);
          }
          break;
 
       case 32:
-         if(read_word_map[address >> 26] != bad_read_word){
-            data = read_word_map[address >> 26](address);
+         if(handlers->read_word != bad_read_word){
+            data = handlers->read_word(address);
          }
          break;
    }
@@ -7,30 +7,33 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#include "pxa260_DMA.h"
 #include "pxa260_IC.h"
 #include "pxa260_PwrClk.h"
 #include "pxa260_GPIO.h"
 #include "pxa260_TIMR.h"
-#if !defined(EMU_NO_SAFETY)
 #include "../armv5te/uArm/CPU_2.h"
-#endif
 
-#if !defined(EMU_NO_SAFETY)
-extern ArmCpu       pxa260CpuState;
-#endif
+extern bool         pxa260UsingUarm;//read only, the armv5te core is used otherwise
+extern ArmCpu       pxa260CpuState;//only valid when pxa260UsingUarm is set
 extern uint16_t*    pxa260Framebuffer;
 extern Pxa260pwrClk pxa260PwrClk;
 extern Pxa260ic     pxa260Ic;
 extern Pxa260gpio   pxa260Gpio;
 extern Pxa260timr   pxa260Timer;
+extern Pxa260dma    pxa260Dma;
 
-bool pxa260Init(uint8_t** returnRom, uint8_t** returnRam);
+bool pxa260Init(uint8_t** returnRom, uint8_t** returnRam, bool useUarm);
 void pxa260Deinit(void);
 void pxa260Reset(void);
 void pxa260SetRtc(uint16_t days, uint8_t hours, uint8_t minutes, uint8_t seconds);
 uint32_t pxa260StateSize(void);
 void pxa260SaveState(uint8_t* data);
 void pxa260LoadState(uint8_t* data);
+uint64_t pxa260GetCommittedMemory(void);//host bytes actually backing guest memory, flags and the address cache
+uint32_t pxa260TranslationCacheSize(void);
+bool pxa260SaveTranslationCache(uint8_t* data, uint32_t size);
+bool pxa260LoadTranslationCache(uint8_t* data, uint32_t size);
 
 void pxa260Execute(bool wantVideo);//runs the CPU for 1 frame
 
@@ -9,51 +9,8 @@ static uint16_t pxa260_io_read_half(uint32_t addr){
 }
 
 static uint32_t pxa260_io_read_word(uint32_t addr){
-   uint32_t out;
-
-   switch(addr >> 16){
-      case PXA260_CLOCK_MANAGER_BASE >> 16:
-         pxa260pwrClkPrvClockMgrMemAccessF(&pxa260PwrClk, addr, 4, false, &out);
-         break;
-      case PXA260_POWER_MANAGER_BASE >> 16:
-         pxa260pwrClkPrvPowerMgrMemAccessF(&pxa260PwrClk, addr, 4, false, &out);
-         break;
-      case PXA260_TIMR_BASE >> 16:
-         pxa260timrPrvMemAccessF(&pxa260Timer, addr, 4, false, &out);
-         break;
-      case PXA260_GPIO_BASE >> 16:
-         pxa260gpioPrvMemAccessF(&pxa260Gpio, addr, 4, false, &out);
-         break;
-      case PXA260_I2C_BASE >> 16:
-         out = pxa260I2cReadWord(addr);
-         break;
-      case PXA260_SSP_BASE >> 16:
-         out = pxa260SspReadWord(addr);
-         break;
-      case PXA260_UDC_BASE >> 16:
-         out = pxa260UdcReadWord(addr);
-         break;
-      case PXA260_IC_BASE >> 16:
-         pxa260icPrvMemAccessF(&pxa260Ic, addr, 4, false, &out);
-         break;
-
-      case PXA260_DMA_BASE >> 16:
-      case PXA260_RTC_BASE >> 16:
-      case PXA260_FFUART_BASE >> 16:
-      case PXA260_BTUART_BASE >> 16:
-      case PXA260_STUART_BASE >> 16:
-         //need to implement these
-         debugLog("Unimplemented 32 bit PXA260 register read:0x%08X, PC:0x%08X\n", addr, pxa260GetPc());
-         out = 0x00000000;
-         break;
-
-      default:
-         debugLog("Invalid 32 bit PXA260 register read:0x%08X, PC:0x%08X\n", addr, pxa260GetPc());
-         out = 0x00000000;
-         break;
-   }
-
-   return out;
+   debugLog("Invalid 32 bit PXA260 register read:0x%08X, PC:0x%08X\n", addr, pxa260GetPc());
+   return 0x00000000;
 }
 
 static void pxa260_io_write_byte(uint32_t addr, uint8_t value){
@@ -65,45 +22,84 @@ static void pxa260_io_write_half(uint32_t addr, uint16_t value){
 }
 
 static void pxa260_io_write_word(uint32_t addr, uint32_t value){
-   switch(addr >> 16){
-      case PXA260_CLOCK_MANAGER_BASE >> 16:
-         pxa260pwrClkPrvClockMgrMemAccessF(&pxa260PwrClk, addr, 4, true, &value);
-         break;
-      case PXA260_POWER_MANAGER_BASE >> 16:
-         pxa260pwrClkPrvPowerMgrMemAccessF(&pxa260PwrClk, addr, 4, true, &value);
-         break;
-      case PXA260_TIMR_BASE >> 16:
-         pxa260timrPrvMemAccessF(&pxa260Timer, addr, 4, true, &value);
-         break;
-      case PXA260_GPIO_BASE >> 16:
-         pxa260gpioPrvMemAccessF(&pxa260Gpio, addr, 4, true, &value);
-         break;
-      case PXA260_I2C_BASE >> 16:
-         pxa260I2cWriteWord(addr, value);
-         break;
-      case PXA260_SSP_BASE >> 16:
-         pxa260SspWriteWord(addr, value);
-         break;
-      case PXA260_UDC_BASE >> 16:
-         pxa260UdcWriteWord(addr, value);
-         break;
-      case PXA260_IC_BASE >> 16:
-         pxa260icPrvMemAccessF(&pxa260Ic, addr, 4, true, &value);
-         break;
-
-      case PXA260_DMA_BASE >> 16:
-      case PXA260_RTC_BASE >> 16:
-      case PXA260_FFUART_BASE >> 16:
-      case PXA260_BTUART_BASE >> 16:
-      case PXA260_STUART_BASE >> 16:
-         //need to implement these
-         debugLog("Unimplemented 32 bit PXA260 register write:0x%08X, value:0x%08X, PC:0x%08X\n", addr, value, pxa260GetPc());
-         break;
-
-      default:
-         debugLog("Invalid 32 bit PXA260 register write:0x%08X, value:0x%08X, PC:0x%08X\n", addr, value, pxa260GetPc());
-         break;
-   }
+   debugLog("Invalid 32 bit PXA260 register write:0x%08X, value:0x%08X, PC:0x%08X\n", addr, value, pxa260GetPc());
+}
+
+static uint32_t pxa260_unimplemented_read_word(uint32_t addr){
+   //need to implement these
+   debugLog("Unimplemented 32 bit PXA260 register read:0x%08X, PC:0x%08X\n", addr, pxa260GetPc());
+   return 0x00000000;
+}
+
+static void pxa260_unimplemented_write_word(uint32_t addr, uint32_t value){
+   //need to implement these
+   debugLog("Unimplemented 32 bit PXA260 register write:0x%08X, value:0x%08X, PC:0x%08X\n", addr, value, pxa260GetPc());
+}
+
+static uint32_t pxa260_clock_manager_read_word(uint32_t addr){
+   uint32_t out;
+
+   pxa260pwrClkPrvClockMgrMemAccessF(&pxa260PwrClk, addr, 4, false, &out);
+   return out;
+}
+
+static void pxa260_clock_manager_write_word(uint32_t addr, uint32_t value){
+   pxa260pwrClkPrvClockMgrMemAccessF(&pxa260PwrClk, addr, 4, true, &value);
+}
+
+static uint32_t pxa260_power_manager_read_word(uint32_t addr){
+   uint32_t out;
+
+   pxa260pwrClkPrvPowerMgrMemAccessF(&pxa260PwrClk, addr, 4, false, &out);
+   return out;
+}
+
+static void pxa260_power_manager_write_word(uint32_t addr, uint32_t value){
+   pxa260pwrClkPrvPowerMgrMemAccessF(&pxa260PwrClk, addr, 4, true, &value);
+}
+
+static uint32_t pxa260_timer_read_word(uint32_t addr){
+   uint32_t out;
+
+   pxa260timrPrvMemAccessF(&pxa260Timer, addr, 4, false, &out);
+   return out;
+}
+
+static void pxa260_timer_write_word(uint32_t addr, uint32_t value){
+   pxa260timrPrvMemAccessF(&pxa260Timer, addr, 4, true, &value);
+}
+
+static uint32_t pxa260_dma_read_word(uint32_t addr){
+   uint32_t out;
+
+   pxa260dmaPrvMemAccessF(&pxa260Dma, addr, 4, false, &out);
+   return out;
+}
+
+static void pxa260_dma_write_word(uint32_t addr, uint32_t value){
+   pxa260dmaPrvMemAccessF(&pxa260Dma, addr, 4, true, &value);
+}
+
+static uint32_t pxa260_gpio_read_word(uint32_t addr){
+   uint32_t out;
+
+   pxa260gpioPrvMemAccessF(&pxa260Gpio, addr, 4, false, &out);
+   return out;
+}
+
+static void pxa260_gpio_write_word(uint32_t addr, uint32_t value){
+   pxa260gpioPrvMemAccessF(&pxa260Gpio, addr, 4, true, &value);
+}
+
+static uint32_t pxa260_ic_read_word(uint32_t addr){
+   uint32_t out;
+
+   pxa260icPrvMemAccessF(&pxa260Ic, addr, 4, false, &out);
+   return out;
+}
+
+static void pxa260_ic_write_word(uint32_t addr, uint32_t value){
+   pxa260icPrvMemAccessF(&pxa260Ic, addr, 4, true, &value);
 }
 
 static uint32_t pxa260_lcd_read_word(uint32_t addr){
@@ -181,3 +177,21 @@ static void pxa260_static_chip_select_2_write_half(uint32_t addr, uint16_t value
    w86l488Write16(addr & 0x0E, value);
 }
 
+
+//IO peripherals only have 32 bit registers
+static const mem_mmio_handlers pxa260IoHandlers = {pxa260_io_read_byte, pxa260_io_read_half, pxa260_io_read_word, pxa260_io_write_byte, pxa260_io_write_half, pxa260_io_write_word};
+static const mem_mmio_handlers pxa260UnimplementedHandlers = {pxa260_io_read_byte, pxa260_io_read_half, pxa260_unimplemented_read_word, pxa260_io_write_byte, pxa260_io_write_half, pxa260_unimplemented_write_word};
+static const mem_mmio_handlers pxa260ClockManagerHandlers = {pxa260_io_read_byte, pxa260_io_read_half, pxa260_clock_manager_read_word, pxa260_io_write_byte, pxa260_io_write_half, pxa260_clock_manager_write_word};
+static const mem_mmio_handlers pxa260PowerManagerHandlers = {pxa260_io_read_byte, pxa260_io_read_half, pxa260_power_manager_read_word, pxa260_io_write_byte, pxa260_io_write_half, pxa260_power_manager_write_word};
+static const mem_mmio_handlers pxa260TimerHandlers = {pxa260_io_read_byte, pxa260_io_read_half, pxa260_timer_read_word, pxa260_io_write_byte, pxa260_io_write_half, pxa260_timer_write_word};
+static const mem_mmio_handlers pxa260DmaHandlers = {pxa260_io_read_byte, pxa260_io_read_half, pxa260_dma_read_word, pxa260_io_write_byte, pxa260_io_write_half, pxa260_dma_write_word};
+static const mem_mmio_handlers pxa260GpioHandlers = {pxa260_io_read_byte, pxa260_io_read_half, pxa260_gpio_read_word, pxa260_io_write_byte, pxa260_io_write_half, pxa260_gpio_write_word};
+static const mem_mmio_handlers pxa260IcHandlers = {pxa260_io_read_byte, pxa260_io_read_half, pxa260_ic_read_word, pxa260_io_write_byte, pxa260_io_write_half, pxa260_ic_write_word};
+static const mem_mmio_handlers pxa260I2cHandlers = {pxa260_io_read_byte, pxa260_io_read_half, pxa260I2cReadWord, pxa260_io_write_byte, pxa260_io_write_half, pxa260I2cWriteWord};
+static const mem_mmio_handlers pxa260SspHandlers = {pxa260_io_read_byte, pxa260_io_read_half, pxa260SspReadWord, pxa260_io_write_byte, pxa260_io_write_half, pxa260SspWriteWord};
+static const mem_mmio_handlers pxa260UdcHandlers = {pxa260_io_read_byte, pxa260_io_read_half, pxa260UdcReadWord, pxa260_io_write_byte, pxa260_io_write_half, pxa260UdcWriteWord};
+static const mem_mmio_handlers pxa260LcdHandlers = {bad_read_byte, bad_read_half, pxa260_lcd_read_word, bad_write_byte, bad_write_half, pxa260_lcd_write_word};
+static const mem_mmio_handlers pxa260MemctrlHandlers = {bad_read_byte, bad_read_half, pxa260MemctrlReadWord, bad_write_byte, bad_write_half, pxa260MemctrlWriteWord};
+static const mem_mmio_handlers pxa260Pcmcia0Handlers = {pxa260_pcmcia0_read_byte, pxa260_pcmcia0_read_half, pxa260_pcmcia0_read_word, pxa260_pcmcia0_write_byte, pxa260_pcmcia0_write_half, pxa260_pcmcia0_write_word};
+static const mem_mmio_handlers pxa260Pcmcia1Handlers = {pxa260_pcmcia1_read_byte, pxa260_pcmcia1_read_half, pxa260_pcmcia1_read_word, pxa260_pcmcia1_write_byte, pxa260_pcmcia1_write_half, pxa260_pcmcia1_write_word};
+static const mem_mmio_handlers pxa260StaticChipSelect2Handlers = {bad_read_byte, pxa260_static_chip_select_2_read_half, bad_read_word, bad_write_byte, pxa260_static_chip_select_2_write_half, bad_write_word};
@@ -83,6 +83,12 @@ static void pxa260SspTxFifoFlush(void){
 }
 
 static void pxa260SspUpdateInterrupt(void){
+   bool enabled = !!(pxa260SspSscr0 & 0x0080);
+
+   //DMA service requests follow the FIFO thresholds, the interrupt enables dont mask them
+   pxa260dmaSetRequest(&pxa260Dma, PXA260_DMA_REQUEST_SSP_RX, enabled && pxa260SspRxFifoEntrys() >= ((pxa260SspSscr1 >> 10) & 0x000F) + 1);
+   pxa260dmaSetRequest(&pxa260Dma, PXA260_DMA_REQUEST_SSP_TX, enabled && pxa260SspTxFifoEntrys() <= ((pxa260SspSscr1 >> 6) & 0x000F) + 1);
+
    //SYNCHRONOUS SERIAL PORT ENABLE
    if(pxa260SspSscr0 & 0x0080){
       //RECEIVE FIFO INTERRUPT
@@ -177,18 +183,21 @@ void pxa260SspWriteWord(uint32_t address, uint32_t value){
    address &= 0xFFFF;
 
    switch(address){
-      case SSCR0:
-         pxa260SspSscr0 = value & 0xFFFF;
+      case SSCR0:{
+            bool enableChanged = (value & 0x0080) != (pxa260SspSscr0 & 0x0080);
 
-         if(!(value & 0x0080)){
-            //disable SSP
-            pxa260SspRxFifoFlush();
-            pxa260SspTxFifoFlush();
-            pxa260SspTransfering = false;
-         }
+            pxa260SspSscr0 = value & 0xFFFF;
 
-         if((value & 0x0080) != (pxa260SspSscr0 & 0x0080))
-            pxa260SspUpdateInterrupt();
+            if(!(value & 0x0080)){
+               //disable SSP
+               pxa260SspRxFifoFlush();
+               pxa260SspTxFifoFlush();
+               pxa260SspTransfering = false;
+            }
+
+            if(enableChanged)
+               pxa260SspUpdateInterrupt();
+         }
          return;
 
       case SSCR1:
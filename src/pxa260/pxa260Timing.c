@@ -9,137 +9,304 @@
 #include "pxa260Udc.h"
 #include "pxa260Timing.h"
 #include "../tsc2101.h"
-#if !defined(EMU_NO_SAFETY)
 #include "../armv5te/uArm/CPU_2.h"
-#endif
 #include "../armv5te/os/os.h"
 #include "../armv5te/emu.h"
 #include "../armv5te/cpu.h"
 #include "../emulator.h"
+#include "../portability.h"
+
+
+#define PXA260_TIMING_NEVER UINT64_MAX
+#define PXA260_TIMING_HEAP_SIZE (PXA260_TIMING_TOTAL_CALLBACKS * 4)//canceled and requeued events stay in the heap until they reach the top
+
+
+typedef struct{
+   uint64_t time;
+   uint8_t  id;
+}pxa260_timing_heap_entry_t;
+
+static uint64_t pxa260TimingTotalCycles;//cycles run before the current slice
+static uint64_t pxa260TimingRunEnd;//when the current pxa260TimingRun call should stop, overshooting it shortens the next one
+static int32_t  pxa260TimingSliceCycles;//length of the current slice, doesnt need to go in save states
+static bool     pxa260TimingInSlice;
+static bool     pxa260TimingInUarmRun;
+static pxa260_timing_heap_entry_t pxa260TimingHeap[PXA260_TIMING_HEAP_SIZE];
+static uint8_t  pxa260TimingHeapEntries;
+
+static uint64_t pxa260TimingEventTimes[PXA260_TIMING_TOTAL_CALLBACKS];//absolute, indexed by callback ID so it can be saved
+
+void (*pxa260TimingCallbacks[PXA260_TIMING_TOTAL_CALLBACKS])(void);
+
 
+static void pxa260TimingHeapSwap(uint8_t a, uint8_t b){
+   pxa260_timing_heap_entry_t temp = pxa260TimingHeap[a];
 
-#define PXA260_TIMING_NEVER 0xFFFFFFFF
+   pxa260TimingHeap[a] = pxa260TimingHeap[b];
+   pxa260TimingHeap[b] = temp;
+}
+
+static void pxa260TimingHeapPush(uint64_t time, uint8_t id){
+   uint8_t index = pxa260TimingHeapEntries++;
+
+   pxa260TimingHeap[index].time = time;
+   pxa260TimingHeap[index].id = id;
 
+   while(index > 0 && pxa260TimingHeap[(index - 1) / 2].time > pxa260TimingHeap[index].time){
+      pxa260TimingHeapSwap(index, (index - 1) / 2);
+      index = (index - 1) / 2;
+   }
+}
 
-static int32_t pxa260TimingLeftoverCycles;//doesnt need to go in save states
+static void pxa260TimingHeapPop(void){
+   uint8_t index = 0;
 
-void    (*pxa260TimingCallbacks[PXA260_TIMING_TOTAL_CALLBACKS])(void);
-int32_t pxa260TimingQueuedEvents[PXA260_TIMING_TOTAL_CALLBACKS];
+   pxa260TimingHeapEntries--;
+   pxa260TimingHeap[0] = pxa260TimingHeap[pxa260TimingHeapEntries];
 
+   while(true){
+      uint8_t smallest = index;
+      uint8_t child = index * 2 + 1;
+
+      if(child < pxa260TimingHeapEntries && pxa260TimingHeap[child].time < pxa260TimingHeap[smallest].time)
+         smallest = child;
+      child++;
+      if(child < pxa260TimingHeapEntries && pxa260TimingHeap[child].time < pxa260TimingHeap[smallest].time)
+         smallest = child;
+
+      if(smallest == index)
+         break;
+
+      pxa260TimingHeapSwap(index, smallest);
+      index = smallest;
+   }
+}
 
-static int32_t pxa260TimingGetDurationUntilNextEvent(int32_t duration/*call with how long you want to run*/){
+static void pxa260TimingHeapRebuild(void){
    uint8_t index;
 
+   //drops all stale entries, only needed when the heap fills up or after loading a state
+   pxa260TimingHeapEntries = 0;
    for(index = 0; index < PXA260_TIMING_TOTAL_CALLBACKS; index++)
-      if(pxa260TimingQueuedEvents[index] != PXA260_TIMING_NEVER && pxa260TimingQueuedEvents[index] < duration)
-         duration = pxa260TimingQueuedEvents[index];
+      if(pxa260TimingEventTimes[index] != PXA260_TIMING_NEVER)
+         pxa260TimingHeapPush(pxa260TimingEventTimes[index], index);
+}
+
+static uint64_t pxa260TimingGetNextEventTime(void){
+   //entries that dont match pxa260TimingEventTimes have been canceled or requeued
+   while(pxa260TimingHeapEntries > 0 && pxa260TimingHeap[0].time != pxa260TimingEventTimes[pxa260TimingHeap[0].id])
+      pxa260TimingHeapPop();
 
-   return duration;
+   return pxa260TimingHeapEntries > 0 ? pxa260TimingHeap[0].time : PXA260_TIMING_NEVER;
+}
+
+static int32_t pxa260TimingGetSliceElapsed(void){
+   int32_t delta = cycle_count_delta;
+
+   if(!pxa260TimingInSlice)
+      return 0;
+
+   //uARM only adds its cycles to cycle_count_delta when cpuRun returns
+   if(pxa260TimingInUarmRun)
+      delta += pxa260CpuState.runCycles;
+
+   return pxa260TimingSliceCycles + delta / palmClockMultiplier;
 }
 
 void pxa260TimingInit(void){
-   pxa260TimingCallbacks[PXA260_TIMING_CALLBACK_TICK_CPU_TIMER] = pxa260TimingTickCpuTimer;
+   pxa260TimingCallbacks[PXA260_TIMING_CALLBACK_CPU_TIMER_MATCH] = pxa260TimingCpuTimerMatch;
    pxa260TimingCallbacks[PXA260_TIMING_CALLBACK_I2C_TRANSMIT_EMPTY] = pxa260I2cTransmitEmpty;
    pxa260TimingCallbacks[PXA260_TIMING_CALLBACK_I2C_RECEIVE_FULL] = pxa260I2cReceiveFull;
    pxa260TimingCallbacks[PXA260_TIMING_CALLBACK_SSP_TRANSFER_COMPLETE] = pxa260SspTransferComplete;
    pxa260TimingCallbacks[PXA260_TIMING_CALLBACK_UDC_DEVICE_RESUME_COMPLETE] = pxa260UdcDeviceResumeComplete;
    pxa260TimingCallbacks[PXA260_TIMING_CALLBACK_TSC2101_SCAN] = tsc2101Scan;
+   pxa260TimingCallbacks[PXA260_TIMING_CALLBACK_DMA_UPDATE] = pxa260TimingDmaUpdate;
 }
 
 void pxa260TimingReset(void){
    uint8_t index;
 
    for(index = 0; index < PXA260_TIMING_TOTAL_CALLBACKS; index++)
-      pxa260TimingQueuedEvents[index] = PXA260_TIMING_NEVER;
+      pxa260TimingEventTimes[index] = PXA260_TIMING_NEVER;
+   pxa260TimingHeapEntries = 0;
 }
 
-void pxa260TimingTriggerEvent(uint8_t callbackId, int32_t wait){
-   pxa260TimingQueuedEvents[callbackId] = wait;
-   //dont need to check if in handler since cycle_count_delta is 0 or positive when in handlers are called
-   if(wait < -cycle_count_delta){
-      pxa260TimingLeftoverCycles = -cycle_count_delta - wait;
-      cycle_count_delta = -wait;
+uint32_t pxa260TimingStateSize(void){
+   uint32_t size = 0;
+
+   size += sizeof(uint64_t) * 2;
+   size += sizeof(uint64_t) * PXA260_TIMING_TOTAL_CALLBACKS;
+
+   return size;
+}
+
+void pxa260TimingSaveState(uint8_t* data){
+   uint32_t offset = 0;
+   uint8_t index;
+
+   writeStateValue64(data + offset, pxa260TimingTotalCycles);
+   offset += sizeof(uint64_t);
+   writeStateValue64(data + offset, pxa260TimingRunEnd);
+   offset += sizeof(uint64_t);
+   for(index = 0; index < PXA260_TIMING_TOTAL_CALLBACKS; index++){
+      writeStateValue64(data + offset, pxa260TimingEventTimes[index]);
+      offset += sizeof(uint64_t);
+   }
+}
+
+void pxa260TimingLoadState(uint8_t* data){
+   uint32_t offset = 0;
+   uint8_t index;
+
+   pxa260TimingTotalCycles = readStateValue64(data + offset);
+   offset += sizeof(uint64_t);
+   pxa260TimingRunEnd = readStateValue64(data + offset);
+   offset += sizeof(uint64_t);
+   for(index = 0; index < PXA260_TIMING_TOTAL_CALLBACKS; index++){
+      pxa260TimingEventTimes[index] = readStateValue64(data + offset);
+      offset += sizeof(uint64_t);
+   }
+
+   pxa260TimingHeapRebuild();
+}
+
+uint64_t pxa260TimingGetCycles(void){
+   return pxa260TimingTotalCycles + pxa260TimingGetSliceElapsed();
+}
+
+void pxa260TimingTriggerEventAt(uint8_t callbackId, uint64_t time){
+   pxa260TimingEventTimes[callbackId] = time;
+   if(pxa260TimingHeapEntries == PXA260_TIMING_HEAP_SIZE)
+      pxa260TimingHeapRebuild();
+   else
+      pxa260TimingHeapPush(time, callbackId);
+
+   //end the running slice early so the event isnt late, this works from inside the dynarec too since it checks cycle_count_delta
+   if(pxa260TimingInSlice && time < pxa260TimingTotalCycles + pxa260TimingSliceCycles){
+      int32_t elapsed = pxa260TimingGetSliceElapsed();
+      int32_t wait = time > pxa260TimingTotalCycles + elapsed ? time - pxa260TimingTotalCycles - elapsed : 0;
+      int32_t cpuCyclesLeft = wait * palmClockMultiplier;
+
+      pxa260TimingSliceCycles = elapsed + wait;
+      if(pxa260TimingInUarmRun){
+         pxa260CpuState.runCyclesLeft = cpuCyclesLeft;
+         cycle_count_delta = -cpuCyclesLeft - (int32_t)pxa260CpuState.runCycles;
+      }
+      else{
+         cycle_count_delta = -cpuCyclesLeft;
+      }
    }
 }
 
+void pxa260TimingTriggerEvent(uint8_t callbackId, int32_t wait){
+   uint64_t now = pxa260TimingGetCycles();
+
+   pxa260TimingTriggerEventAt(callbackId, wait > 0 ? now + wait : now);
+}
+
 void pxa260TimingCancelEvent(uint8_t callbackId){
-   pxa260TimingQueuedEvents[callbackId] = PXA260_TIMING_NEVER;
+   //the heap entry is dropped when it reaches the top
+   pxa260TimingEventTimes[callbackId] = PXA260_TIMING_NEVER;
 }
 
 void pxa260TimingRun(int32_t cycles){
 #if OS_HAS_PAGEFAULT_HANDLER
    os_exception_frame_t seh_frame = {NULL, NULL};
 #endif
-   uint8_t index;
-   int32_t addCycles;
 
 #if OS_HAS_PAGEFAULT_HANDLER
    os_faulthandler_arm(&seh_frame);
 #endif
 
-   while(setjmp(restart_after_exception)){};
-   exiting = false;
-   pxa260TimingLeftoverCycles = 0;//used when an event is added while the CPU is running
-
-   keepRunning:
-   addCycles = pxa260TimingGetDurationUntilNextEvent(cycles);
-   cycle_count_delta = -addCycles * palmClockMultiplier;
-
-   while (!exiting && cycle_count_delta < 0) {
-#if !defined(EMU_NO_SAFETY)
-      cpuCycle(&pxa260CpuState);
-      cycle_count_delta += 1;
-#else
-      if (cpu_events & (EVENT_FIQ | EVENT_IRQ)) {
-          // Align PC in case the interrupt occurred immediately after a jump
-          if (arm.cpsr_low28 & 0x20)
-              arm.reg[15] &= ~1;
-          else
-              arm.reg[15] &= ~3;
-
-          if (cpu_events & EVENT_WAITING)
-              arm.reg[15] += 4; // Skip over wait instruction
-
-          arm.reg[15] += 4;
-          cpu_exception((cpu_events & EVENT_FIQ) ? EX_FIQ : EX_IRQ);
+   //overshooting the last frame makes this one shorter
+   if(pxa260TimingRunEnd + cycles < pxa260TimingTotalCycles)
+      pxa260TimingRunEnd = pxa260TimingTotalCycles;
+   pxa260TimingRunEnd += cycles;
+
+   while(setjmp(restart_after_exception)){
+      //a data abort from the shared memory accessors can jump out of cpuRun too, keep the cycles it ran
+      if(pxa260TimingInUarmRun){
+         cycle_count_delta += pxa260CpuState.runCycles;
+         pxa260TimingInUarmRun = false;
       }
-      cpu_events &= ~EVENT_WAITING;//the wait opcode will be executed again if still waiting, that will clear the remaining cycle count and exit the function again
+   };
+   exiting = false;
 
-      if (arm.cpsr_low28 & 0x20)
-          cpu_thumb_loop();
-      else
-          cpu_arm_loop();
-#endif
-   }
+   while(!exiting && pxa260TimingTotalCycles < pxa260TimingRunEnd){
+      uint64_t next;
+      uint8_t id;
 
-   //if more then the requested cycles are executed count those too
-   addCycles += cycle_count_delta / palmClockMultiplier;
+      //a data abort restarts here in the middle of a slice
+      if(!pxa260TimingInSlice){
+         next = pxa260TimingGetNextEventTime();
+         if(next > pxa260TimingRunEnd)
+            next = pxa260TimingRunEnd;
+         pxa260TimingSliceCycles = next > pxa260TimingTotalCycles ? next - pxa260TimingTotalCycles : 0;
+         cycle_count_delta = -pxa260TimingSliceCycles * palmClockMultiplier;
+         pxa260TimingInSlice = true;
+      }
 
-   //remove the unused cycles
-   addCycles -= pxa260TimingLeftoverCycles;
-   pxa260TimingLeftoverCycles = 0;
+      //interrupts can only be raised by events while the CPU is idle, so skip straight to the next one
+      if(cpu_events & EVENT_WAITING){
+         if(arm.interrupts != 0)
+            cpu_events &= ~EVENT_WAITING;
+         else
+            cycle_count_delta = 0;
+      }
 
-   for(index = 0; index < PXA260_TIMING_TOTAL_CALLBACKS; index++){
-      if(pxa260TimingQueuedEvents[index] != PXA260_TIMING_NEVER){
-         pxa260TimingQueuedEvents[index] -= addCycles;
-         if(pxa260TimingQueuedEvents[index] <= 0){
-            //execute event
-            pxa260TimingQueuedEvents[index] = PXA260_TIMING_NEVER;//set to never before calling function because it may retrigger the event and we dont want the new one cleared
-            pxa260TimingCallbacks[index]();
+      if(pxa260UsingUarm){
+         while(!exiting && cycle_count_delta < 0){
+            pxa260TimingInUarmRun = true;
+            cpuRun(&pxa260CpuState, -cycle_count_delta);
+            pxa260TimingInUarmRun = false;
+            cycle_count_delta += pxa260CpuState.runCycles;
+            if(cpu_events & EVENT_WAITING)
+               cycle_count_delta = 0;
          }
       }
-   }
+      else{
+         while (!exiting && cycle_count_delta < 0) {
+            if (cpu_events & (EVENT_FIQ | EVENT_IRQ)) {
+                // Align PC in case the interrupt occurred immediately after a jump
+                if (arm.cpsr_low28 & 0x20)
+                    arm.reg[15] &= ~1;
+                else
+                    arm.reg[15] &= ~3;
 
-   cycles -= addCycles;
-   if(cycles > 0)
-      goto keepRunning;
+                arm.reg[15] += 4;
+                cpu_exception((cpu_events & EVENT_FIQ) ? EX_FIQ : EX_IRQ);
+            }
+            if (arm.cpsr_low28 & 0x20)
+                cpu_thumb_loop();
+            else
+                cpu_arm_loop();
+         }
+      }
+
+      //if more then the requested cycles are executed count those too
+      pxa260TimingTotalCycles += pxa260TimingGetSliceElapsed();
+      pxa260TimingInSlice = false;
+      pxa260TimingSliceCycles = 0;
+      cycle_count_delta = 0;
+
+      //run everything that is due, handlers may queue more events
+      while((next = pxa260TimingGetNextEventTime()) <= pxa260TimingTotalCycles){
+         id = pxa260TimingHeap[0].id;
+         pxa260TimingHeapPop();
+         pxa260TimingEventTimes[id] = PXA260_TIMING_NEVER;//set to never before calling function because it may retrigger the event and we dont want the new one cleared
+         pxa260TimingCallbacks[id]();
+      }
+   }
 
 #if OS_HAS_PAGEFAULT_HANDLER
    os_faulthandler_unarm(&seh_frame);
 #endif
 }
 
-void pxa260TimingTickCpuTimer(void){
-   pxa260timrTick(&pxa260Timer);
-   pxa260TimingTriggerEvent(PXA260_TIMING_CALLBACK_TICK_CPU_TIMER, TUNGSTEN_T3_CPU_PLL_FREQUENCY / TUNGSTEN_T3_CPU_CRYSTAL_FREQUENCY);
+void pxa260TimingCpuTimerMatch(void){
+   pxa260timrMatch(&pxa260Timer);
+}
+
+void pxa260TimingDmaUpdate(void){
+   pxa260dmaUpdate(&pxa260Dma);
 }
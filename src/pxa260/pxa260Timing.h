@@ -4,25 +4,31 @@
 #include <stdint.h>
 
 enum{
-   PXA260_TIMING_CALLBACK_TICK_CPU_TIMER = 0,
+   PXA260_TIMING_CALLBACK_CPU_TIMER_MATCH = 0,
    PXA260_TIMING_CALLBACK_I2C_TRANSMIT_EMPTY,
    PXA260_TIMING_CALLBACK_I2C_RECEIVE_FULL,
    PXA260_TIMING_CALLBACK_SSP_TRANSFER_COMPLETE,
    PXA260_TIMING_CALLBACK_UDC_DEVICE_RESUME_COMPLETE,
    PXA260_TIMING_CALLBACK_TSC2101_SCAN,
+   PXA260_TIMING_CALLBACK_DMA_UPDATE,
    PXA260_TIMING_TOTAL_CALLBACKS
 };
 
 extern void (*pxa260TimingCallbacks[])(void);//saving a function pointer in a state is not portable and will crash even on the same system between program loads with ASLR
-extern int32_t pxa260TimingQueuedEvents[];
 
 void pxa260TimingInit(void);
 void pxa260TimingReset(void);
+uint32_t pxa260TimingStateSize(void);
+void pxa260TimingSaveState(uint8_t* data);
+void pxa260TimingLoadState(uint8_t* data);
 
+uint64_t pxa260TimingGetCycles(void);//total cycles run, used for timers that are calculated when read
+void pxa260TimingTriggerEventAt(uint8_t callbackId, uint64_t time);//time is from pxa260TimingGetCycles
 void pxa260TimingTriggerEvent(uint8_t callbackId, int32_t wait);
 void pxa260TimingCancelEvent(uint8_t callbackId);
 void pxa260TimingRun(int32_t cycles);//this runs the CPU
 
-void pxa260TimingTickCpuTimer(void);
+void pxa260TimingCpuTimerMatch(void);
+void pxa260TimingDmaUpdate(void);
 
 #endif
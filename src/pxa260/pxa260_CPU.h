@@ -3,17 +3,11 @@
 
 #include "pxa260_types.h"
 
-#if defined(EMU_NO_SAFETY)
-#include "../armv5te/emu.h"
-#include "../armv5te/cpu.h"
-
-#define cpuGetRegExternal(x, regNum) reg_pc(regNum)
-#define cpuSetReg(x, regNum, value) set_reg(regNum, value)
-
-#define cpuIrq(x, fiq, raise) (raise ? (cpu_events |= (fiq ? EVENT_FIQ : EVENT_IRQ)) : (cpu_events &= (fiq ? ~EVENT_FIQ : ~EVENT_IRQ)))
-#else
-#include "../armv5te/uArm/CPU_2.h"
-#endif
+//these go to whichever ARM core is currently running, peripherals should never talk to a core directly
+UInt32 pxa260CpuGetReg(UInt8 reg);
+void pxa260CpuSetReg(UInt8 reg, UInt32 value);
+void pxa260CpuIrq(Boolean fiq, Boolean raise);
+void pxa260CpuWaitForInterrupt(void);
 
 #endif
 
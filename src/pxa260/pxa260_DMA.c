@@ -1,5 +1,10 @@
+#include <string.h>
+
 #include "pxa260.h"
 #include "pxa260_DMA.h"
+#include "pxa260Timing.h"
+#include "../armv5te/mem.h"
+#include "../emulator.h"
 
 #define REG_DAR 	0
 #define REG_SAR 	1
@@ -7,37 +12,345 @@
 #define REG_CR		3
 #define REG_CSR   4
 
+#define DCSR_RUN		0x80000000UL
+#define DCSR_NODESCFETCH	0x40000000UL
+#define DCSR_STOPIRQEN		0x20000000UL
+#define DCSR_STOPSTATE		0x00000008UL
+#define DCSR_ENDINTR		0x00000004UL
+#define DCSR_STARTINTR		0x00000002UL
+#define DCSR_BUSERRINTR		0x00000001UL
+#define DCSR_INTS		(DCSR_ENDINTR | DCSR_STARTINTR | DCSR_BUSERRINTR)
+
+#define DCMD_INCSRCADDR		0x80000000UL
+#define DCMD_INCTRGADDR		0x40000000UL
+#define DCMD_FLOWSRC		0x20000000UL
+#define DCMD_FLOWTRG		0x10000000UL
+#define DCMD_STARTIRQEN		0x00400000UL
+#define DCMD_ENDIRQEN		0x00200000UL
+#define DCMD_SIZE		0x00030000UL
+#define DCMD_LENGTH		0x00001FFFUL
+
+#define DDADR_STOP		0x00000001UL
+
+#define DRCMR_MAPVLD		0x80
+#define DRCMR_CHLNUM		0x0F
+
+#define PXA260_DMA_DESCRIPTOR_CYCLES	16	//descriptor fetch and channel setup
+#define PXA260_DMA_CYCLES_PER_WORD	1
+
+
+static void pxa260dmaPrvUpdateInts(Pxa260dma* dma){
+
+	UInt8 i;
+
+	dma->DINT = 0;
+	for(i = 0; i < PXA260_DMA_CHANNELS; i++){
+		UInt32 csr = dma->channels[i].CSR;
+
+		if((csr & DCSR_INTS) || ((csr & DCSR_STOPIRQEN) && (csr & DCSR_STOPSTATE)))
+			dma->DINT |= 1UL << i;
+	}
+
+	pxa260icInt(dma->ic, PXA260_I_DMA, dma->DINT != 0);
+}
+
+static Boolean pxa260dmaPrvRequestAsserted(Pxa260dma* dma, UInt8 channel){
+
+	UInt8 i;
+
+	//a flow controlled channel only moves data while a request line mapped to it is asserted
+	for(i = 0; i < PXA260_DMA_REQUESTS; i++){
+		if((dma->CMR[i] & DRCMR_MAPVLD) && (dma->CMR[i] & DRCMR_CHLNUM) == channel && (dma->requests >> i & 1))
+			return true;
+	}
+
+	return false;
+}
+
+static UInt32 pxa260dmaPrvBurstSize(Pxa260dmaChannel* chan){
+
+	UInt32 size = (chan->CR & DCMD_SIZE) >> 16;
+
+	//0 is reserved, treat it as the smallest burst
+	return 4UL << (size ? size : 1);
+}
+
+static UInt32 pxa260dmaPrvBurstCycles(Pxa260dmaChannel* chan){
+
+	return pxa260dmaPrvBurstSize(chan) / 4 * PXA260_DMA_CYCLES_PER_WORD;
+}
+
+static void pxa260dmaPrvSchedule(Pxa260dma* dma){
+
+	UInt64 next = UINT64_MAX;
+	UInt8 i;
+
+	for(i = 0; i < PXA260_DMA_CHANNELS; i++){
+		if((dma->channels[i].CSR & DCSR_RUN) && dma->channels[i].doneCycle < next)
+			next = dma->channels[i].doneCycle;
+	}
+
+	if(next != UINT64_MAX)
+		pxa260TimingTriggerEventAt(PXA260_TIMING_CALLBACK_DMA_UPDATE, next);
+	else
+		pxa260TimingCancelEvent(PXA260_TIMING_CALLBACK_DMA_UPDATE);
+}
+
+static void pxa260dmaPrvStop(Pxa260dmaChannel* chan){
+
+	chan->CSR = (chan->CSR &~ DCSR_RUN) | DCSR_STOPSTATE;
+}
+
+static void pxa260dmaPrvBeginTransfer(Pxa260dma* dma, UInt8 channel){
+
+	Pxa260dmaChannel* chan = &dma->channels[channel];
+	UInt32 length = chan->CR & DCMD_LENGTH;
+
+	//flow controlled transfers move one burst at a time, and wait whenever their request line is deasserted
+	if(chan->CR & (DCMD_FLOWSRC | DCMD_FLOWTRG)){
+		if(length && !pxa260dmaPrvRequestAsserted(dma, channel))
+			chan->doneCycle = UINT64_MAX;
+		else
+			chan->doneCycle = pxa260TimingGetCycles() + PXA260_DMA_DESCRIPTOR_CYCLES + pxa260dmaPrvBurstCycles(chan);
+		return;
+	}
+
+	chan->doneCycle = pxa260TimingGetCycles() + PXA260_DMA_DESCRIPTOR_CYCLES + (length + 3) / 4 * PXA260_DMA_CYCLES_PER_WORD;
+}
+
+static Boolean pxa260dmaPrvFetchDescriptor(Pxa260dmaChannel* chan){
+
+	const UInt32* desc = phys_mem_ptr(chan->DAR & ~0xFUL, 16);
+
+	if(!desc){
+		debugLog("PXA260 DMA descriptor at invalid address:0x%08X\n", chan->DAR);
+		chan->CSR |= DCSR_BUSERRINTR;
+		pxa260dmaPrvStop(chan);
+		return false;
+	}
+
+	chan->DAR = desc[0];
+	chan->SAR = desc[1];
+	chan->TAR = desc[2];
+	chan->CR = desc[3];
+	if(chan->CR & DCMD_STARTIRQEN)
+		chan->CSR |= DCSR_STARTINTR;
+
+	return true;
+}
+
+static void pxa260dmaPrvStart(Pxa260dma* dma, UInt8 channel){
+
+	Pxa260dmaChannel* chan = &dma->channels[channel];
+
+	chan->CSR &= ~DCSR_STOPSTATE;
+	if(!(chan->CSR & DCSR_NODESCFETCH) && !pxa260dmaPrvFetchDescriptor(chan))
+		return;
+	pxa260dmaPrvBeginTransfer(dma, channel);
+}
+
+static UInt32 pxa260dmaPrvRead(const mem_mmio_handlers* handlers, UInt32 addr, UInt8 width){
+
+	switch(width){
+		case 1:
+			return handlers->read_byte(addr);
+		case 2:
+			return handlers->read_half(addr);
+		default:
+			return handlers->read_word(addr);
+	}
+}
 
-static void pxa260dmaPrvChannelRegWrite(_UNUSED_ Pxa260dma* dma, UInt8 channel, UInt8 reg, UInt32 val){
-	
-	if(val){	//we start with zeros, so non-zero writes are all we care about
-		
-		const char* regs[] = {"DADDR", "SADDR", "TADDR", "CR", "CSR"};
-		
-		err_str("dma: writes unimpl!");
-	//	err_str("PXA260 dma engine: writes unimpl! (writing 0x");
-	//	err_hex(val);
-	//	err_str(" to channel ");
-	//	err_dec(channel);
-	//	err_str(" reg ");
-	//	err_str(regs[reg]);
-	//	err_str(". Halting.\r\n");
-		while(1);	
+static void pxa260dmaPrvWrite(const mem_mmio_handlers* handlers, UInt32 addr, UInt8 width, UInt32 value){
+
+	switch(width){
+		case 1:
+			handlers->write_byte(addr, value);
+			break;
+		case 2:
+			handlers->write_half(addr, value);
+			break;
+		default:
+			handlers->write_word(addr, value);
+			break;
+	}
+}
+
+static UInt32 pxa260dmaPrvLoad(const UInt8* ptr, UInt8 width){
+
+	switch(width){
+		case 1:
+			return *ptr;
+		case 2:
+			return *(const UInt16*)ptr;
+		default:
+			return *(const UInt32*)ptr;
 	}
 }
 
-static UInt32 pxa260dmaPrvChannelRegRead(_UNUSED_ Pxa260dma* dma, _UNUSED_ UInt8 channel, _UNUSED_ UInt8 reg){
-	
-	
-	return 0;	
+static void pxa260dmaPrvStore(UInt8* ptr, UInt8 width, UInt32 value){
+
+	switch(width){
+		case 1:
+			*ptr = value;
+			break;
+		case 2:
+			*(UInt16*)ptr = value;
+			break;
+		default:
+			*(UInt32*)ptr = value;
+			break;
+	}
 }
 
-static Boolean pxa260dmaPrvMemAccessF(void* userData, UInt32 pa, UInt8 size, Boolean write, void* buf){
+static void pxa260dmaPrvWriteActions(UInt8* dst, UInt32 length){
+
+	UInt8* word;
+
+	//same as a CPU write, translated code in the range has to be dropped
+	for(word = (UInt8*)((uintptr_t)dst & ~3); word < dst + length; word += 4){
+		if(RAM_FLAGS(word) & DO_WRITE_ACTION)
+			write_action(word);
+	}
+}
+
+static void pxa260dmaPrvTransfer(Pxa260dmaChannel* chan, UInt32 length){
+
+	Boolean incSrc = !!(chan->CR & DCMD_INCSRCADDR);
+	Boolean incTrg = !!(chan->CR & DCMD_INCTRGADDR);
+	UInt8 width = (chan->CR >> 14) & 3;
+	UInt8* src;
+	UInt8* dst;
+
+	if(!length)
+		return;
+
+	//memory to memory transfers dont set a width
+	width = width == 3 || width == 0 ? 4 : width;
+
+	//memory is resolved once for the whole burst, a peripheral FIFO is the same register every access
+	src = incSrc ? phys_mem_ptr(chan->SAR, length) : NULL;
+	dst = incTrg ? phys_mem_ptr(chan->TAR, length) : NULL;
+
+	if(dst)
+		pxa260dmaPrvWriteActions(dst, length);
+
+	if(src && dst){
+		memmove(dst, src, length);
+	}
+	else{
+		const mem_mmio_handlers* srcHandlers = src ? NULL : mem_get_handlers(chan->SAR);
+		const mem_mmio_handlers* dstHandlers = dst ? NULL : mem_get_handlers(chan->TAR);
+		UInt32 offset;
+
+		for(offset = 0; offset < length; offset += width){
+			UInt32 srcAddr = chan->SAR + (incSrc ? offset : 0);
+			UInt32 dstAddr = chan->TAR + (incTrg ? offset : 0);
+			UInt32 value;
+
+			//an incrementing range that isnt all memory has to be looked up every access
+			if(src)
+				value = pxa260dmaPrvLoad(src + offset, width);
+			else
+				value = pxa260dmaPrvRead(incSrc ? mem_get_handlers(srcAddr) : srcHandlers, srcAddr, width);
+
+			if(dst)
+				pxa260dmaPrvStore(dst + offset, width, value);
+			else
+				pxa260dmaPrvWrite(incTrg ? mem_get_handlers(dstAddr) : dstHandlers, dstAddr, width, value);
+		}
+	}
+
+	if(incSrc)
+		chan->SAR += length;
+	if(incTrg)
+		chan->TAR += length;
+	chan->CR -= length;
+}
+
+static void pxa260dmaPrvChannelRegWrite(Pxa260dma* dma, UInt8 channel, UInt8 reg, UInt32 val){
+
+	Pxa260dmaChannel* chan = &dma->channels[channel];
+	UInt32 wasRunning;
+
+	switch(reg){
+		case REG_DAR:
+			chan->DAR = val;
+			break;
+
+		case REG_SAR:
+			chan->SAR = val;
+			break;
+
+		case REG_TAR:
+			chan->TAR = val;
+			break;
+
+		case REG_CR:
+			chan->CR = val;
+			break;
+
+		case REG_CSR:
+			wasRunning = chan->CSR & DCSR_RUN;
+			chan->CSR &= ~(val & DCSR_INTS);
+			chan->CSR = (chan->CSR &~ (DCSR_RUN | DCSR_NODESCFETCH | DCSR_STOPIRQEN)) | (val & (DCSR_RUN | DCSR_NODESCFETCH | DCSR_STOPIRQEN));
+
+			if(!wasRunning && (val & DCSR_RUN))
+				pxa260dmaPrvStart(dma, channel);
+			else if(wasRunning && !(val & DCSR_RUN))
+				pxa260dmaPrvStop(chan);
+
+			pxa260dmaPrvUpdateInts(dma);
+			pxa260dmaPrvSchedule(dma);
+			break;
+	}
+}
+
+static UInt32 pxa260dmaPrvChannelRegRead(Pxa260dma* dma, UInt8 channel, UInt8 reg){
+
+	Pxa260dmaChannel* chan = &dma->channels[channel];
+
+	switch(reg){
+		case REG_DAR:
+			return chan->DAR;
+
+		case REG_SAR:
+			return chan->SAR;
+
+		case REG_TAR:
+			return chan->TAR;
+
+		case REG_CR:
+			return chan->CR;
+
+		case REG_CSR:
+			return chan->CSR;
+	}
+
+	return 0;
+}
+
+static void pxa260dmaPrvMapRequest(Pxa260dma* dma, UInt8 request, UInt32 val){
+
+	UInt8 i;
+
+	dma->CMR[request] = val;
+
+	//a channel that was waiting for this request can start now
+	for(i = 0; i < PXA260_DMA_CHANNELS; i++){
+		if((dma->channels[i].CSR & DCSR_RUN) && dma->channels[i].doneCycle == UINT64_MAX)
+			pxa260dmaPrvBeginTransfer(dma, i);
+	}
+
+	pxa260dmaPrvSchedule(dma);
+}
+
+Boolean pxa260dmaPrvMemAccessF(void* userData, UInt32 pa, UInt8 size, Boolean write, void* buf){
 
    Pxa260dma* dma = userData;
 	UInt8 reg, set;
 	UInt32 val = 0;
-	
+
 	if(size != 4) {
 		err_str(__FILE__ ": Unexpected ");
 	//	err_str(write ? "write" : "read");
@@ -48,14 +361,14 @@ static Boolean pxa260dmaPrvMemAccessF(void* userData, UInt32 pa, UInt8 size, Boo
 	//	err_str("\r\n");
 		return true;		//we do not support non-word accesses
 	}
-	
+
 	pa = (pa - PXA260_DMA_BASE) >> 2;
 
    debugLog("PXA260 DMA access:0x%04X, write:%d, PC:0x%08X\n", pa, write, pxa260GetPc());
-	
+
 	if(write){
 		val = *(UInt32*)buf;
-		
+
 		switch(pa >> 6){		//weird, but quick way to avoide repeated if-then-elses. this is faster
 			case 0:
 				if(pa < 16){
@@ -64,12 +377,12 @@ static Boolean pxa260dmaPrvMemAccessF(void* userData, UInt32 pa, UInt8 size, Boo
 					pxa260dmaPrvChannelRegWrite(dma, set, reg, val);
 				}
 				break;
-				
+
 			case 1:
 				pa -= 64;
-				if(pa < 40) dma->CMR[pa] = val;
+				if(pa < 40) pxa260dmaPrvMapRequest(dma, pa, val);
 				break;
-			
+
 			case 2:
 				pa -= 128;
 				set = pa >> 2;
@@ -86,13 +399,16 @@ static Boolean pxa260dmaPrvMemAccessF(void* userData, UInt32 pa, UInt8 size, Boo
 					set = pa;
 					val = pxa260dmaPrvChannelRegRead(dma, set, reg);
 				}
+				else if(pa == 60){
+					val = dma->DINT;
+				}
 				break;
-				
+
 			case 1:
 				pa -= 64;
 				if(pa < 40) val = dma->CMR[pa];
 				break;
-			
+
 			case 2:
 				pa -= 128;
 				set = pa >> 2;
@@ -100,15 +416,92 @@ static Boolean pxa260dmaPrvMemAccessF(void* userData, UInt32 pa, UInt8 size, Boo
 				val = pxa260dmaPrvChannelRegRead(dma, set, reg);
 				break;
 		}
-		
+
 		*(UInt32*)buf = val;
 	}
-	
+
 	return true;
 }
 
 
 void pxa260dmaInit(Pxa260dma* dma, Pxa260ic* ic){
+
+	UInt8 i;
+
    __mem_zero(dma, sizeof(Pxa260dma));
 	dma->ic = ic;
+	for(i = 0; i < PXA260_DMA_CHANNELS; i++)
+		dma->channels[i].CSR = DCSR_STOPSTATE;
+}
+
+void pxa260dmaUpdate(Pxa260dma* dma){
+
+	UInt64 now = pxa260TimingGetCycles();
+	UInt8 i;
+
+	for(i = 0; i < PXA260_DMA_CHANNELS; i++){
+		Pxa260dmaChannel* chan = &dma->channels[i];
+
+		//a late event can finish several descriptors at once
+		while((chan->CSR & DCSR_RUN) && chan->doneCycle <= now){
+			UInt32 length = chan->CR & DCMD_LENGTH;
+
+			if(chan->CR & (DCMD_FLOWSRC | DCMD_FLOWTRG)){
+				UInt32 burst = pxa260dmaPrvBurstSize(chan);
+
+				//the peripheral stopped requesting, pxa260dmaSetRequest picks the channel up again
+				if(length && !pxa260dmaPrvRequestAsserted(dma, i)){
+					chan->doneCycle = UINT64_MAX;
+					break;
+				}
+
+				pxa260dmaPrvTransfer(chan, burst < length ? burst : length);
+				if(chan->CR & DCMD_LENGTH){
+					chan->doneCycle = now + pxa260dmaPrvBurstCycles(chan);
+					break;
+				}
+			}
+			else{
+				pxa260dmaPrvTransfer(chan, length);
+			}
+
+			if(chan->CR & DCMD_ENDIRQEN)
+				chan->CSR |= DCSR_ENDINTR;
+
+			if((chan->CSR & DCSR_NODESCFETCH) || (chan->DAR & DDADR_STOP)){
+				pxa260dmaPrvStop(chan);
+				break;
+			}
+			if(!pxa260dmaPrvFetchDescriptor(chan))
+				break;
+			pxa260dmaPrvBeginTransfer(dma, i);
+		}
+	}
+
+	pxa260dmaPrvUpdateInts(dma);
+	pxa260dmaPrvSchedule(dma);
+}
+
+void pxa260dmaSetRequest(Pxa260dma* dma, UInt8 request, Boolean asserted){
+
+	UInt64 bit = 1ULL << request;
+	Pxa260dmaChannel* chan;
+
+	if(((dma->requests & bit) != 0) == !!asserted)
+		return;
+
+	if(asserted)
+		dma->requests |= bit;
+	else
+		dma->requests &= ~bit;
+
+	if(!asserted || !(dma->CMR[request] & DRCMR_MAPVLD))
+		return;
+
+	//this is called from peripheral register accesses, possibly in the middle of a burst, so the waiting channel is only scheduled here
+	chan = &dma->channels[dma->CMR[request] & DRCMR_CHLNUM];
+	if((chan->CSR & DCSR_RUN) && chan->doneCycle == UINT64_MAX){
+		chan->doneCycle = pxa260TimingGetCycles() + pxa260dmaPrvBurstCycles(chan);
+		pxa260dmaPrvSchedule(dma);
+	}
 }
@@ -7,32 +7,54 @@
 /*
 	PXA260 OS DMA controller
 
+	PURRPOSE: moves data between memory and peripherals without the CPU
+
 */
 
 #define PXA260_DMA_BASE		0x40000000UL
 #define PXA260_DMA_SIZE		0x00001000UL
 
+#define PXA260_DMA_CHANNELS	16
+#define PXA260_DMA_REQUESTS	40
+
+//request lines driven by emulated peripherals, numbered like DRCMR
+#define PXA260_DMA_REQUEST_BTUART_RX	4
+#define PXA260_DMA_REQUEST_BTUART_TX	5
+#define PXA260_DMA_REQUEST_FFUART_RX	6
+#define PXA260_DMA_REQUEST_FFUART_TX	7
+#define PXA260_DMA_REQUEST_SSP_RX	13
+#define PXA260_DMA_REQUEST_SSP_TX	14
+#define PXA260_DMA_REQUEST_STUART_RX	19
+#define PXA260_DMA_REQUEST_STUART_TX	20
+#define PXA260_DMA_REQUEST_UDC_EP(n)	(24 + (n))	//endpoints 1 to 15
+
+
 typedef struct{
-	
+
 	UInt32 DAR;	//descriptor address register
 	UInt32 SAR;	//source address register
 	UInt32 TAR;	//target address register
 	UInt32 CR;	//command register
 	UInt32 CSR;	//control and status register
-	
+
+	UInt64 doneCycle;	//when the current descriptor finishes, only valid while the channel is running
+
 }Pxa260dmaChannel;
 
 typedef struct{
 
 	Pxa260ic* ic;
-	
+
 	UInt16 DINT;
-	Pxa260dmaChannel channels[16];
-	UInt8 CMR[40];			//channel map registers	[  we store lower 8 bits only :-)  ]
-	
+	Pxa260dmaChannel channels[PXA260_DMA_CHANNELS];
+	UInt8 CMR[PXA260_DMA_REQUESTS];			//channel map registers	[  we store lower 8 bits only :-)  ]
+	UInt64 requests;				//asserted request lines, bit n is DRCMRn
+
 }Pxa260dma;
 
-void pxa260dmaInit(Pxa260dma* gpio, Pxa260ic* ic);
+Boolean pxa260dmaPrvMemAccessF(void* userData, UInt32 pa, UInt8 size, Boolean write, void* buf);
+void pxa260dmaInit(Pxa260dma* dma, Pxa260ic* ic);
+void pxa260dmaUpdate(Pxa260dma* dma);
+void pxa260dmaSetRequest(Pxa260dma* dma, UInt8 request, Boolean asserted);	//called by peripherals when their FIFO needs servicing or no longer does
 
 #endif
-
@@ -12,12 +12,12 @@ Boolean pxa260dspAccess(void* userData, Boolean MRRC, UInt8 op, UInt8 RdLo, UInt
 	
 	if(MRRC){	//MRA: read acc0
 		
-      cpuSetReg(&pxa260CpuState, RdLo, u64_64_to_32(dsp->acc0));
-      cpuSetReg(&pxa260CpuState, RdHi, (UInt8)u64_get_hi(dsp->acc0));
+      pxa260CpuSetReg(RdLo, u64_64_to_32(dsp->acc0));
+      pxa260CpuSetReg(RdHi, (UInt8)u64_get_hi(dsp->acc0));
 	}
 	else{		//MAR: write acc0
 		
-      dsp->acc0 = u64_from_halves(cpuGetRegExternal(&pxa260CpuState, RdHi) & 0xFF, cpuGetRegExternal(&pxa260CpuState, RdLo));
+      dsp->acc0 = u64_from_halves(pxa260CpuGetReg(RdHi) & 0xFF, pxa260CpuGetReg(RdLo));
 	}
 	
 	return true;	
@@ -31,8 +31,8 @@ Boolean	pxa260dspOp(void* userData, Boolean two/* MCR2/MRC2 ? */, Boolean MRC, U
 	
 	if(op1 != 1 || two || MRC || acc != 0) return false;		//bad encoding
 	
-   Vs = cpuGetRegExternal(&pxa260CpuState, Rs);
-   Vm = cpuGetRegExternal(&pxa260CpuState, Rm);
+   Vs = pxa260CpuGetReg(Rs);
+   Vm = pxa260CpuGetReg(Rm);
 	
 	switch(opcode_3 >> 2){
 		
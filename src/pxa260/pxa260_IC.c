@@ -11,8 +11,8 @@ static void pxa260icPrvHandleChanges(Pxa260ic* ic){
 	nowFiq = (unmasked & ic->ICLR) != 0;
 	nowIrq = (unmasked & ~ic->ICLR) != 0;
 	
-   if(nowFiq != ic->wasFiq) cpuIrq(&pxa260CpuState, true, nowFiq);
-   if(nowIrq != ic->wasIrq) cpuIrq(&pxa260CpuState, false, nowIrq);
+   if(nowFiq != ic->wasFiq) pxa260CpuIrq(true, nowFiq);
+   if(nowIrq != ic->wasIrq) pxa260CpuIrq(false, nowIrq);
 
 	ic->wasFiq = nowFiq;
 	ic->wasIrq = nowIrq;
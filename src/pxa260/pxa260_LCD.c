@@ -200,6 +200,13 @@ static void pxa260LcdPrvDma(Pxa260lcd* lcd, void* dest, UInt32 addr, UInt32 len)
 
 	UInt32 t;
 	UInt8* d = dest;
+	void* src = phys_mem_ptr(addr, len);
+
+	//buffers in RAM are copied directly, anything else goes through the bus a word at a time
+	if(src){
+		__mem_copy(dest, src, len);
+		return;
+	}
 
 	//we assume aligntment here both on part of dest and of addr
 
@@ -214,69 +221,78 @@ static void pxa260LcdPrvDma(Pxa260lcd* lcd, void* dest, UInt32 addr, UInt32 len)
 	}
 }
 
-static _INLINE_ void pxa260LcdScreenDataPixel(Pxa260lcd* lcd, UInt8* buf){
-   static UInt32 pos = 0;
+static void pxa260LcdPrvBuildPaletteLut(Pxa260lcd* lcd, UInt8 bpp){
+   UInt8 bits = 1 << bpp;
+   UInt8 mask = (1 << bits) - 1;
+   UInt16 value;
+   UInt8 index;
 
-   pxa260Framebuffer[pos] = buf[0] || (buf[1] << 8);
-   pos++;
-   if(pos == 320 * 480)
-      pos = 0;
+   //pixels are stored starting at the low bits of each byte
+   for(value = 0; value < 256; value++)
+      for(index = 0; index < 8 / bits; index++)
+         lcd->paletteLut[value][index] = lcd->palette[(value >> index * bits) & mask];
+
+   lcd->paletteLutBpp = bpp;
 }
 
-static void pxa260LcdScreenDataDma(Pxa260lcd* lcd, UInt32 addr/*PA*/, UInt32 len){
-   UInt8 data[4];
-   UInt32 i, j;
-   void* ptr;
+static void pxa260LcdPrvConvertLine(Pxa260lcd* lcd, UInt16* dest, const UInt8* src, UInt32 bytes, UInt8 bpp){
+   UInt32 index;
 
-   len /= 4;
-   while(len--){
-      pxa260LcdPrvDma(lcd, data, addr, 4);
-      addr += 4;
+   switch(bpp){
 
-      switch((lcd->lccr3 >> 24) & 7){
+      case 0:		//1BPP
+      case 1:		//2BPP
+      case 2:		//4BPP
+         for(index = 0; index < bytes; index++){
+            __mem_copy(dest, lcd->paletteLut[src[index]], (8 >> bpp) * sizeof(UInt16));
+            dest += 8 >> bpp;
+         }
+         break;
+
+      case 3:		//8BPP
+         for(index = 0; index < bytes; index++)
+            dest[index] = lcd->palette[src[index]];
+         break;
+
+      case 4:		//16BPP
+         __mem_copy(dest, src, bytes);
+         break;
+   }
+}
 
-         case 0:		//1BPP
-            for(i = 0; i < 4; i += 1){
-               for(j = 0; j < 8; j += 1){
-                  ptr = lcd->palette + ((data[i] >> j) & 1) * 2;
-                  pxa260LcdScreenDataPixel(lcd, ptr);
-               }
-            }
-            break;
+static void pxa260LcdScreenDataDma(Pxa260lcd* lcd, UInt32 addr/*PA*/, UInt32 len){
+   UInt8 bpp = (lcd->lccr3 >> 24) & 7;
+   UInt32 lineBytes;
+   UInt32 line;
+   const UInt8* src;
 
-         case 1:		//2BPP
-            for(i = 0; i < 4; i += 1){
-               for(j = 0; j < 8; j += 2){
-                  ptr = lcd->palette + ((data[i] >> j) & 3) * 2;
-                  pxa260LcdScreenDataPixel(lcd, ptr);
-               }
-            }
-            break;
+   if(bpp > 4)
+      return;   //BAD
 
-         case 2:		//4BPP
-            for(i = 0; i < 4; i += 1){
-               for(j = 0; j < 8; j += 4){
-                  ptr = lcd->palette + ((data[i] >> j) & 15) * 2;
-                  pxa260LcdScreenDataPixel(lcd, ptr);
-               }
-            }
-            break;
+   if(bpp < 4 && lcd->paletteLutBpp != bpp)
+      pxa260LcdPrvBuildPaletteLut(lcd, bpp);
 
-         case 3:		//8BPP
-            for(i = 0; i < 4; i += 1){
-               ptr = lcd->palette + (data[i] * 2);
-               pxa260LcdScreenDataPixel(lcd, ptr);
-            }
-            break;
+   //each frame DMA starts at the top of the screen, resolve the buffer once for the whole frame
+   lineBytes = bpp == 4 ? PXA260_LCD_WIDTH * 2 : PXA260_LCD_WIDTH >> (3 - bpp);
+   if(len > lineBytes * PXA260_LCD_HEIGHT)
+      len = lineBytes * PXA260_LCD_HEIGHT;
+   src = phys_mem_ptr(addr, len);
 
-         case 4:		//16BPP
-            for(i = 0; i < 4; i += 2)
-               pxa260LcdScreenDataPixel(lcd, data + i);
-            break;
+   for(line = 0; line < PXA260_LCD_HEIGHT && len > 0; line++){
+      UInt32 bytes = len < lineBytes ? len : lineBytes;
+      UInt8 lineBuffer[PXA260_LCD_WIDTH * 2];
 
-         default:
-            break;   //BAD
+      if(src){
+         pxa260LcdPrvConvertLine(lcd, pxa260Framebuffer + line * PXA260_LCD_WIDTH, src, bytes, bpp);
+         src += bytes;
       }
+      else{
+         pxa260LcdPrvDma(lcd, lineBuffer, addr, bytes);
+         pxa260LcdPrvConvertLine(lcd, pxa260Framebuffer + line * PXA260_LCD_WIDTH, lineBuffer, bytes, bpp);
+      }
+
+      addr += bytes;
+      len -= bytes;
    }
 }
 
@@ -315,10 +331,8 @@ void pxa260lcdFrame(Pxa260lcd* lcd){
 				lcd->fsadr0 = pxa260PrvGetWord(lcd, descrAddr + 4);
 				lcd->fidr0  = pxa260PrvGetWord(lcd, descrAddr + 8);
 				lcd->ldcmd0 = pxa260PrvGetWord(lcd, descrAddr + 12);
-			
-				lcd->state = LCD_STATE_DMA_0_START;
-				break;
-			
+				//the DMA starts as soon as the descriptor is loaded
+				//fallthrough
 			case LCD_STATE_DMA_0_START:
 				
 				if(lcd->ldcmd0 & 0x00400000UL) lcd->lcsr |= 0x0002;	//set SOF is DMA 0 started
@@ -330,11 +344,12 @@ void pxa260lcdFrame(Pxa260lcd* lcd){
                   len = sizeof(lcd->palette);
 
                pxa260LcdPrvDma(lcd, lcd->palette, lcd->fsadr0, len);
+               lcd->paletteLutBpp = 0xFF;
 				}
 				else{
 					
 					lcd->frameNum++;
-					if(!(lcd->frameNum & 63)) pxa260LcdScreenDataDma(lcd, lcd->fsadr0, len);
+					pxa260LcdScreenDataDma(lcd, lcd->fsadr0, len);
 				}
 				
 				lcd->state = LCD_STATE_DMA_0_END;
@@ -355,4 +370,5 @@ void pxa260lcdInit(Pxa260lcd* lcd, Pxa260ic* ic){
 	
 	lcd->ic = ic;
 	lcd->intMask = UNMASKABLE_INTS;
+	lcd->paletteLutBpp = 0xFF;
 }
@@ -4,8 +4,6 @@
 #include "pxa260_CPU.h"
 #include "pxa260_IC.h"
 
-uint16_t* pxa260Framebuffer;
-
 /*
 	PXA260 OS LCD controller
 	
@@ -16,6 +14,9 @@ uint16_t* pxa260Framebuffer;
 #define PXA260_LCD_BASE		0x44000000UL
 #define PXA260_LCD_SIZE		0x00001000UL
 
+#define PXA260_LCD_WIDTH	320
+#define PXA260_LCD_HEIGHT	480
+
 
 
 
@@ -40,7 +41,9 @@ typedef struct{
 	UInt8 intWasPending	: 1;
 	UInt8 enbChanged	: 1;
 	
-	UInt8 palette[512];
+	UInt16 palette[256];
+	UInt16 paletteLut[256][8];	//pixels for every possible byte at 1/2/4 BPP, 8 BPP reads palette directly
+	UInt8 paletteLutBpp;		//0xFF when the palette changed
 
 	UInt32 frameNum;
 	
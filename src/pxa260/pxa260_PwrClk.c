@@ -8,7 +8,7 @@ Boolean pxa260pwrClkPrvCoprocRegXferFunc(void* userData, Boolean two, Boolean re
 	Pxa260pwrClk* pc = userData;
 	UInt32 val = 0;
 	
-   if(!read) val = cpuGetRegExternal(&pxa260CpuState, Rx);
+   if(!read) val = pxa260CpuGetReg(Rx);
 	
 	if(CRm == 0 && op2 == 0 && op1 == 0 && !two){
 		
@@ -16,7 +16,7 @@ Boolean pxa260pwrClkPrvCoprocRegXferFunc(void* userData, Boolean two, Boolean re
 			
 			case 6:
             if(read){
-               val = 0;
+               val = pc->turbo ? 1 : 0;
             }
 				else{
 					pc->turbo = (val & 1) != 0;
@@ -30,14 +30,27 @@ Boolean pxa260pwrClkPrvCoprocRegXferFunc(void* userData, Boolean two, Boolean re
 					//	err_str("\r\n");
 					}
 				}
+				goto success;
 			
 			case 7:
             if(read){
-               val = pc->turbo ? 1 : 0;
+               val = 0;//always reads as run mode since the CPU is executing
             }
-				else if(val != 0){
-					
-               debugLog("Someone tried to set processor power mode (cp14 reg7) to 0x%08X, PC:0x%08X\n", val, pxa260GetPc());
+				else{
+					switch(val & 3){
+						
+						case 0:
+							break;
+						
+						case 1:
+							//idle, the core stops until an interrupt and the peripherals keep running
+							pxa260CpuWaitForInterrupt();
+							break;
+						
+						default:
+                     debugLog("Unimplemented processor power mode (cp14 reg7) 0x%08X, PC:0x%08X\n", val, pxa260GetPc());
+							break;
+					}
 				}
 				goto success;
 		}
@@ -47,7 +60,7 @@ Boolean pxa260pwrClkPrvCoprocRegXferFunc(void* userData, Boolean two, Boolean re
 
 success:
 	
-   if(read) cpuSetReg(&pxa260CpuState, Rx, val);
+   if(read) pxa260CpuSetReg(Rx, val);
 	return true;
 }
 
@@ -1,5 +1,6 @@
 #include "pxa260.h"
 #include "pxa260_TIMR.h"
+#include "pxa260Timing.h"
 #include "../emulator.h"
 
 
@@ -11,21 +12,60 @@ static void pxa260timrPrvRaiseLowerInts(Pxa260timr* timr){
 	pxa260icInt(timr->ic, PXA260_I_TIMR3, (timr->OSSR & 8) != 0);
 }
 
-static void pxa260timrPrvCheckMatch(Pxa260timr* timr, UInt8 idx){
+static UInt32 pxa260timrPrvGetOscr(Pxa260timr* timr){
+	
+	return timr->OSCR + (UInt32)((pxa260TimingGetCycles() - timr->oscrCycle) / PXA260_TIMR_CYCLES_PER_TICK);
+}
+
+static Boolean pxa260timrPrvChannelArmed(Pxa260timr* timr, UInt8 idx){
+	
+	//OSMR3 is also the watchdog
+	return (timr->OIER & (1UL << idx)) || (idx == 3 && (timr->OWER & 1));
+}
+
+static void pxa260timrPrvCheckMatch(Pxa260timr* timr, UInt8 idx, UInt32 oscr){
 	
 	UInt8 v = 1UL << idx;
 	
-	if((timr->OSCR == timr->OSMR[idx]) && (timr->OIER & v)){
+	if((oscr == timr->OSMR[idx]) && (timr->OIER & v)){
 		timr->OSSR |= v;
 	}
 }
 
 static void pxa260timrPrvUpdate(Pxa260timr* timr){
 	
-	pxa260timrPrvCheckMatch(timr, 0);
-	pxa260timrPrvCheckMatch(timr, 1);
-	pxa260timrPrvCheckMatch(timr, 2);
-	pxa260timrPrvCheckMatch(timr, 3);
+	UInt32 oscr = pxa260timrPrvGetOscr(timr);
+	
+	pxa260timrPrvCheckMatch(timr, 0, oscr);
+	pxa260timrPrvCheckMatch(timr, 1, oscr);
+	pxa260timrPrvCheckMatch(timr, 2, oscr);
+	pxa260timrPrvCheckMatch(timr, 3, oscr);
+}
+
+static void pxa260timrPrvSchedule(Pxa260timr* timr){
+	
+	//only the nearest match is queued, OSCR is never ticked
+	UInt64 now = pxa260TimingGetCycles();
+	UInt64 ticks = (now - timr->oscrCycle) / PXA260_TIMR_CYCLES_PER_TICK;
+	UInt32 oscr = timr->OSCR + (UInt32)ticks;
+	UInt64 next = UINT64_MAX;
+	UInt64 until;
+	UInt8 i;
+	
+	for(i = 0; i < 4; i++){
+		if(pxa260timrPrvChannelArmed(timr, i)){
+			//a match register equal to OSCR has already matched, the next match is after OSCR wraps
+			until = (UInt32)(timr->OSMR[i] - oscr);
+			if(!until) until = 0x100000000ULL;
+			timr->matchCycle[i] = timr->oscrCycle + (ticks + until) * PXA260_TIMR_CYCLES_PER_TICK;
+			if(timr->matchCycle[i] < next) next = timr->matchCycle[i];
+		}
+	}
+	
+	if(next != UINT64_MAX)
+		pxa260TimingTriggerEventAt(PXA260_TIMING_CALLBACK_CPU_TIMER_MATCH, next);
+	else
+		pxa260TimingCancelEvent(PXA260_TIMING_CALLBACK_CPU_TIMER_MATCH);
 }
 
 Boolean pxa260timrPrvMemAccessF(void* userData, UInt32 pa, UInt8 size, Boolean write, void* buf){
@@ -57,10 +97,13 @@ Boolean pxa260timrPrvMemAccessF(void* userData, UInt32 pa, UInt8 size, Boolean w
 			case 2:
 			case 3:
 				timr->OSMR[pa] = val;
+				pxa260timrPrvSchedule(timr);
 				break;
 			
 			case 4:
 				timr->OSCR = val;
+				timr->oscrCycle = pxa260TimingGetCycles();
+				pxa260timrPrvSchedule(timr);
 				break;
 			
 			case 5:
@@ -70,12 +113,14 @@ Boolean pxa260timrPrvMemAccessF(void* userData, UInt32 pa, UInt8 size, Boolean w
 			
 			case 6:
 				timr->OWER = val;
+				pxa260timrPrvSchedule(timr);
 				break;
 			
 			case 7:
 				timr->OIER = val;
 				pxa260timrPrvUpdate(timr);
 				pxa260timrPrvRaiseLowerInts(timr);
+				pxa260timrPrvSchedule(timr);
 				break;
 		}
 	}
@@ -89,7 +134,7 @@ Boolean pxa260timrPrvMemAccessF(void* userData, UInt32 pa, UInt8 size, Boolean w
 				break;
 			
 			case 4:
-				val = timr->OSCR;
+				val = pxa260timrPrvGetOscr(timr);
 				break;
 			
 			case 5:
@@ -115,11 +160,21 @@ void pxa260timrInit(Pxa260timr* timr, Pxa260ic* ic){
 	
 	__mem_zero(timr, sizeof(Pxa260timr));
 	timr->ic = ic;
+	timr->oscrCycle = pxa260TimingGetCycles();
 }
 
-void pxa260timrTick(Pxa260timr* timr){
+void pxa260timrMatch(Pxa260timr* timr){
+	
+	UInt64 now = pxa260TimingGetCycles();
+	UInt8 i;
+	
+	for(i = 0; i < 4; i++){
+		if(pxa260timrPrvChannelArmed(timr, i) && timr->matchCycle[i] <= now){
+			if(timr->OIER & (1UL << i)) timr->OSSR |= 1UL << i;
+			if(i == 3 && (timr->OWER & 1)) debugLog("PXA260 watchdog reset unimplemented\n");
+		}
+	}
 	
-	timr->OSCR++;
-	pxa260timrPrvUpdate(timr);
 	pxa260timrPrvRaiseLowerInts(timr);
+	pxa260timrPrvSchedule(timr);
 }
@@ -15,6 +15,8 @@
 #define PXA260_TIMR_BASE	0x40A00000UL
 #define PXA260_TIMR_SIZE	0x00010000UL
 
+#define PXA260_TIMR_CYCLES_PER_TICK	(TUNGSTEN_T3_CPU_PLL_FREQUENCY / TUNGSTEN_T3_CPU_CRYSTAL_FREQUENCY)
+
 
 typedef struct{
 
@@ -23,14 +25,17 @@ typedef struct{
 	UInt32 OSMR[4];	//Match Register 0-3
 	UInt32 OIER;	//Interrupt Enable
 	UInt32 OWER;	//Watchdog enable
-	UInt32 OSCR;	//Counter Register
+	UInt32 OSCR;	//Counter Register, value at oscrCycle, the current value is calculated from the cycle count when read
 	UInt32 OSSR;	//Status Register
 	
+	UInt64 oscrCycle;	//cycle count when OSCR was last set
+	UInt64 matchCycle[4];	//when each match register will next equal OSCR
+	
 }Pxa260timr;
 
 Boolean pxa260timrPrvMemAccessF(void* userData, UInt32 pa, UInt8 size, Boolean write, void* buf);
 void pxa260timrInit(Pxa260timr* timr, Pxa260ic* ic);
-void pxa260timrTick(Pxa260timr* timr);
+void pxa260timrMatch(Pxa260timr* timr);
 
 
 #endif
@@ -2,6 +2,8 @@
 #include <stdbool.h>
 #include <string.h>
 
+#include "sdCard.h"
+#include "sdCardVirtual.h"
 #include "emulator.h"
 #include "portability.h"
 
@@ -12,6 +14,33 @@
 #include "sdCardCrcTables.c.h"
 
 
+//storage, either a raw image or a virtual card built from a host directory
+bool sdCardIsInserted(void){
+   return palmSdCard.flashChipData || sdCardVirtualIsInserted();
+}
+
+uint32_t sdCardGetSize(void){
+   return palmSdCard.flashChipData ? palmSdCard.flashChipSize : sdCardVirtualGetSize();
+}
+
+static const uint8_t* sdCardGetBlock(uint32_t address){
+   //virtual blocks are only valid until the next call
+   static uint8_t virtualBlock[SD_CARD_BLOCK_SIZE];
+
+   if(palmSdCard.flashChipData)
+      return palmSdCard.flashChipData + address;
+
+   sdCardVirtualRead(address, virtualBlock, SD_CARD_BLOCK_SIZE);
+   return virtualBlock;
+}
+
+static void sdCardSetBlock(uint32_t address, const uint8_t* data){
+   if(palmSdCard.flashChipData)
+      memcpy(palmSdCard.flashChipData + address, data, SD_CARD_BLOCK_SIZE);
+   else
+      sdCardVirtualWrite(address, data, SD_CARD_BLOCK_SIZE);
+}
+
 static void sdCardCmdStart(void){
    palmSdCard.command = UINT64_C(0x0000000000000000);
    palmSdCard.commandBitsRemaining = 48;
@@ -49,12 +78,22 @@ static uint8_t sdCardCrc7(uint8_t* data, uint16_t size){
    return dataCrc;
 }
 
-static uint16_t sdCardCrc16(uint8_t* data, uint16_t size){
+static uint16_t sdCardCrc16(const uint8_t* data, uint16_t size){
    uint16_t dataCrc = 0x0000;
-   uint16_t offset;
+   uint16_t offset = 0;
+
+   //slice by 8, the first 2 bytes fold into the current CRC and the other 6 are looked up on their own
+   for(; size - offset >= 8; offset += 8){
+      const uint8_t* bytes = data + offset;
+
+      dataCrc ^= bytes[0] << 8 | bytes[1];
+      dataCrc = sdCardCrc16SliceTables[6][dataCrc >> 8] ^ sdCardCrc16SliceTables[5][dataCrc & 0xFF] ^
+            sdCardCrc16SliceTables[4][bytes[2]] ^ sdCardCrc16SliceTables[3][bytes[3]] ^ sdCardCrc16SliceTables[2][bytes[4]] ^
+            sdCardCrc16SliceTables[1][bytes[5]] ^ sdCardCrc16SliceTables[0][bytes[6]] ^ sdCardCrc16Table[bytes[7]];
+   }
 
    //csum = crc16_table[((csum >> 8) ^ *data) & 0xff] ^ (csum << 8);
-   for(offset = 0; offset < size; offset++)
+   for(; offset < size; offset++)
       dataCrc = sdCardCrc16Table[(dataCrc >> 8 ^ data[offset]) & 0xFF] ^ dataCrc << 8;
 
    return dataCrc;
@@ -66,8 +105,8 @@ static void sdCardTopOffReadBuffer(void){
    //only call during a multi block read / palmSdCard.runningCommand == READ_MULTIPLE_BLOCK
    if(unlikely(sdCardResponseFifoByteEntrys() < SD_CARD_BLOCK_SIZE)){
       sdCardDoResponseDelay(1);
-      if(likely(palmSdCard.runningCommandVars[0] < palmSdCard.flashChipSize)){
-         sdCardDoResponseDataPacket(DATA_TOKEN_DEFAULT, palmSdCard.flashChipData + palmSdCard.runningCommandVars[0], SD_CARD_BLOCK_SIZE);
+      if(likely(palmSdCard.runningCommandVars[0] < sdCardGetSize())){
+         sdCardDoResponseDataPacket(DATA_TOKEN_DEFAULT, sdCardGetBlock(palmSdCard.runningCommandVars[0]), SD_CARD_BLOCK_SIZE);
          palmSdCard.runningCommandVars[0] += SD_CARD_BLOCK_SIZE;
       }
       else{
@@ -78,7 +117,7 @@ static void sdCardTopOffReadBuffer(void){
 }
 
 void sdCardReset(void){
-   if(palmSdCard.flashChipData){
+   if(sdCardIsInserted()){
       palmSdCard.command = UINT64_C(0x0000000000000000);
       palmSdCard.commandBitsRemaining = 48;
       palmSdCard.runningCommand = 0x00;
@@ -99,7 +138,7 @@ void sdCardReset(void){
 
 void sdCardSetChipSelect(bool value){
    if(value != palmSdCard.chipSelect){
-      if(palmSdCard.flashChipData){
+      if(sdCardIsInserted()){
          //commands start when chip select goes from high to low
          if(value == false)
             sdCardCmdStart();
@@ -113,7 +152,7 @@ bool sdCardExchangeBit(bool bit){
    bool outputValue = true;//SPI1 pins are on port j which has pull up resistors so default output value is true
 
    //make sure SD is actually plugged in and chip select is low
-   if(likely(palmSdCard.flashChipData && !palmSdCard.chipSelect)){
+   if(likely(sdCardIsInserted() && !palmSdCard.chipSelect)){
       //get output value first
       outputValue = sdCardResponseFifoReadBit();
 
@@ -281,8 +320,8 @@ bool sdCardExchangeBit(bool bit){
                         case READ_SINGLE_BLOCK:
                            sdCardDoResponseR1(palmSdCard.inIdleState);
                            sdCardDoResponseDelay(1);
-                           if(likely(argument < palmSdCard.flashChipSize))
-                              sdCardDoResponseDataPacket(DATA_TOKEN_DEFAULT, palmSdCard.flashChipData + argument, SD_CARD_BLOCK_SIZE);
+                           if(likely(argument < sdCardGetSize()))
+                              sdCardDoResponseDataPacket(DATA_TOKEN_DEFAULT, sdCardGetBlock(argument), SD_CARD_BLOCK_SIZE);
                            else
                               sdCardDoResponseErrorToken(ET_OUT_OF_RANGE);
                            break;
@@ -290,10 +329,10 @@ bool sdCardExchangeBit(bool bit){
                         case READ_MULTIPLE_BLOCK:
                            sdCardDoResponseR1(palmSdCard.inIdleState);
                            sdCardDoResponseDelay(1);
-                           if(likely(argument < palmSdCard.flashChipSize)){
+                           if(likely(argument < sdCardGetSize())){
                               palmSdCard.runningCommand = READ_MULTIPLE_BLOCK;
                               palmSdCard.runningCommandVars[0] = argument;
-                              sdCardDoResponseDataPacket(DATA_TOKEN_DEFAULT, palmSdCard.flashChipData + palmSdCard.runningCommandVars[0], SD_CARD_BLOCK_SIZE);
+                              sdCardDoResponseDataPacket(DATA_TOKEN_DEFAULT, sdCardGetBlock(palmSdCard.runningCommandVars[0]), SD_CARD_BLOCK_SIZE);
                               palmSdCard.runningCommandVars[0] += SD_CARD_BLOCK_SIZE;
                            }
                            else{
@@ -304,7 +343,7 @@ bool sdCardExchangeBit(bool bit){
                         case WRITE_SINGLE_BLOCK:
                         case WRITE_MULTIPLE_BLOCK:
                            sdCardDoResponseR1(palmSdCard.inIdleState);
-                           if(likely(argument < palmSdCard.flashChipSize)){
+                           if(likely(argument < sdCardGetSize())){
                               palmSdCard.runningCommand = command;
                               palmSdCard.runningCommandVars[0] = argument;
                               palmSdCard.runningCommandVars[1] = 0x00;//last 8 received bits, used to see if a data token has been received
@@ -317,6 +356,12 @@ bool sdCardExchangeBit(bool bit){
                            }
                            break;
 
+                        case CRC_ON_OFF:
+                           //off after CMD0, while its off no data CRCs are generated or checked
+                           palmSdCard.allowInvalidCrc = !(argument & 0x00000001);
+                           sdCardDoResponseR1(palmSdCard.inIdleState);
+                           break;
+
                         default:
                            debugLog("SD unknown command: cmd:%d, arg:0x%08X, CRC:0x%02X\n", command, argument, crc);
                            sdCardDoResponseR1(R1_ILLEGAL_COMMAND | palmSdCard.inIdleState);
@@ -380,8 +425,8 @@ bool sdCardExchangeBit(bool bit){
                   //packet finished, verify and write block to chip
                   if(likely(palmSdCard.allowInvalidCrc) || sdCardCrc16(palmSdCard.runningCommandPacket + 1, SD_CARD_BLOCK_SIZE) == (palmSdCard.runningCommandPacket[SD_CARD_BLOCK_DATA_PACKET_SIZE - 2] << 8 | palmSdCard.runningCommandPacket[SD_CARD_BLOCK_DATA_PACKET_SIZE - 1])){
                      //TODO: also need to check if block is write protected, not just the card as a whole
-                     if(likely(palmSdCard.runningCommandVars[0] < palmSdCard.flashChipSize && !palmSdCard.sdInfo.writeProtectSwitch)){
-                        memcpy(palmSdCard.flashChipData + palmSdCard.runningCommandVars[0], palmSdCard.runningCommandPacket + 1, SD_CARD_BLOCK_SIZE);
+                     if(likely(palmSdCard.runningCommandVars[0] < sdCardGetSize() && !palmSdCard.sdInfo.writeProtectSwitch)){
+                        sdCardSetBlock(palmSdCard.runningCommandVars[0], palmSdCard.runningCommandPacket + 1);
                         sdCardDoResponseDataResponse(DR_ACCEPTED);
                      }
                      else{
@@ -472,8 +517,52 @@ static uint32_t sdCardExchangeXBitsUnoptimized(uint32_t bits, uint8_t size){
    return returnBits;
 }
 
+static uint8_t sdCardExchangeByteOptimized(uint8_t byte){
+   //whole byte version of sdCardExchangeBit, anything that needs to happen on a specific bit goes through the slow path
+   if(palmSdCard.receivingCommand){
+      if(palmSdCard.commandBitsRemaining == 48 && (byte == 0xFF || byte == 0x00)){
+         //idle line between commands, every bit is rejected as a start bit so the command doesnt change
+      }
+      else if(palmSdCard.commandBitsRemaining % 8 == 0 && palmSdCard.commandBitsRemaining > 8 && (palmSdCard.commandBitsRemaining != 48 || (byte & 0xC0) == 0x40)){
+         //middle of a command, the last byte has the end bit and runs the command so its done 1 bit at a time
+         palmSdCard.command <<= 8;
+         palmSdCard.command |= byte;
+         palmSdCard.commandBitsRemaining -= 8;
+      }
+      else{
+         return sdCardExchangeXBitsUnoptimized(byte, 8);
+      }
+   }
+   else if(palmSdCard.runningCommand == WRITE_SINGLE_BLOCK || palmSdCard.runningCommand == WRITE_MULTIPLE_BLOCK){
+      uint32_t currentByte = palmSdCard.runningCommandVars[2] / 8;
+
+      if(palmSdCard.runningCommandVars[2] % 8 == 0 && currentByte > 0 && currentByte < SD_CARD_BLOCK_DATA_PACKET_SIZE){
+         //byte aligned inside a data packet, including the CRC, the packet is checked on the bit after it ends
+         palmSdCard.runningCommandPacket[currentByte] = byte;
+         palmSdCard.runningCommandVars[2] += 8;
+      }
+      else if(palmSdCard.runningCommandVars[2] == 0 && palmSdCard.runningCommandVars[1] == 0xFF && byte == 0xFF){
+         //idle line before a data token
+      }
+      else{
+         //tokens can start on any bit
+         return sdCardExchangeXBitsUnoptimized(byte, 8);
+      }
+   }
+   else if(palmSdCard.runningCommand){
+      //unknown condition
+      return sdCardExchangeXBitsUnoptimized(byte, 8);
+   }
+
+   //fill return FIFO if its getting low
+   if(palmSdCard.runningCommand == READ_MULTIPLE_BLOCK)
+      sdCardTopOffReadBuffer();
+
+   return sdCardResponseFifoReadByteOptimized();
+}
+
 uint32_t sdCardExchangeXBitsOptimized(uint32_t bits, uint8_t size){
-   //does the same as the above function but skips any unneeded behavior for speed
+   //does the same as sdCardExchangeXBitsUnoptimized but moves whole bytes when nothing happens in the middle of them
    uint32_t returnBits = 0x00000000;
    uint32_t all1s = fillBottomWith1s(0, size);
 
@@ -481,73 +570,13 @@ uint32_t sdCardExchangeXBitsOptimized(uint32_t bits, uint8_t size){
    bits &= all1s;
 
    //make sure SD is actually plugged in and chip select is low
-   if(likely(palmSdCard.flashChipData && !palmSdCard.chipSelect)){
-      bool ignoreCmdBits = palmSdCard.commandBitsRemaining == 48 && (bits == all1s || bits == 0x00000000 && !(size & 0x1));
-      bool safeToOptimize = !palmSdCard.receivingCommand || ignoreCmdBits || palmSdCard.commandBitsRemaining > 47 && palmSdCard.commandBitsRemaining - size < 1;
-
-      if(safeToOptimize){
-         //check for simple cases
-         if(!palmSdCard.runningCommand || palmSdCard.runningCommand == READ_MULTIPLE_BLOCK){
-            //nothing will happen until this transfer is over, do fast transfer and check if FIFO needs to be refilled
-
-            if(!ignoreCmdBits){
-               palmSdCard.command <<= size;
-               palmSdCard.command |= bits;
-               palmSdCard.commandBitsRemaining -= size;
-            }
+   if(likely(sdCardIsInserted() && !palmSdCard.chipSelect)){
+      if(size % 8 == 0){
+         int8_t shift;
 
-            //fill return FIFO if its getting low
-            if(palmSdCard.runningCommand == READ_MULTIPLE_BLOCK)
-               sdCardTopOffReadBuffer();
-
-            switch(size){
-               case 32:
-                  returnBits |= sdCardResponseFifoReadByteOptimized() << 24;
-               case 24:
-                  returnBits |= sdCardResponseFifoReadByteOptimized() << 16;
-               case 16:
-                  returnBits |= sdCardResponseFifoReadByteOptimized() << 8;
-               case 8:
-                  returnBits |= sdCardResponseFifoReadByteOptimized();
-                  break;
-
-               default:{
-                     //slow method
-                     uint8_t index;
-
-                     for(index = 0; index < size; index++){
-                        returnBits <<= 1;
-                        returnBits |= sdCardResponseFifoReadBit();
-                     }
-                     break;
-                  }
-            }
-         }
-         else if(palmSdCard.runningCommand == WRITE_SINGLE_BLOCK || palmSdCard.runningCommand == WRITE_MULTIPLE_BLOCK){
-            //just passthrough write data
-            uint32_t currentByte = palmSdCard.runningCommandVars[2] / 8;
-            bool alignedProperly = size % 8 == 0 && palmSdCard.runningCommandVars[2] % 8 == 0;
-
-            if(alignedProperly && currentByte > 0 && currentByte + size / 8 < SD_CARD_BLOCK_DATA_PACKET_SIZE - 1){
-               //byte aligned in the middle of a data packet, can just copy data over
-               uint8_t index;
-
-               for(index = 0; index < size / 8; index++){
-                  palmSdCard.runningCommandPacket[currentByte] = bits >> (size - 8) - (index * 8) & 0xFF;
-                  palmSdCard.runningCommandVars[2] += 8;
-                  currentByte++;
-                  returnBits <<= 8;
-                  returnBits |= sdCardResponseFifoReadByteOptimized();
-               }
-            }
-            else{
-               //not write safe
-               returnBits = sdCardExchangeXBitsUnoptimized(bits, size);
-            }
-         }
-         else{
-            //unknown condition
-            returnBits = sdCardExchangeXBitsUnoptimized(bits, size);
+         for(shift = size - 8; shift >= 0; shift -= 8){
+            returnBits <<= 8;
+            returnBits |= sdCardExchangeByteOptimized(bits >> shift & 0xFF);
          }
       }
       else{
@@ -563,6 +592,236 @@ uint32_t sdCardExchangeXBitsOptimized(uint32_t bits, uint8_t size){
    return returnBits;
 }
 
+static uint32_t sdCardBusGetStatus(void){
+   uint8_t state;
+
+   if(palmSdCard.inIdleState){
+      state = CS_STATE_IDLE;
+   }
+   else{
+      switch(palmSdCard.runningCommand){
+         case READ_SINGLE_BLOCK:
+         case READ_MULTIPLE_BLOCK:
+         case SEND_SCR:
+            state = CS_STATE_DATA;
+            break;
+
+         case WRITE_SINGLE_BLOCK:
+         case WRITE_MULTIPLE_BLOCK:
+            state = CS_STATE_RCV;
+            break;
+
+         default:
+            state = CS_STATE_TRAN;
+            break;
+      }
+   }
+
+   return CS_CURRENT_STATE(state) | CS_READY_FOR_DATA | (palmSdCard.commandIsAcmd ? CS_APP_CMD : 0x00000000);
+}
+
+static uint8_t sdCardBusResponse32(uint8_t* response, uint32_t value){
+   response[0] = value >> 24;
+   response[1] = value >> 16 & 0xFF;
+   response[2] = value >> 8 & 0xFF;
+   response[3] = value & 0xFF;
+   return 4;
+}
+
+uint8_t sdCardBusCommand(uint8_t command, uint32_t argument, uint8_t* response){
+   //response is 4 bytes for R1/R1b/R3/R6 and 16 bytes for R2, the start bits, command index and CRC7 are left to the host
+   bool isAcmd = palmSdCard.commandIsAcmd;
+   uint8_t responseSize = 0;
+
+   if(!sdCardIsInserted())
+      return 0;
+
+   palmSdCard.commandIsAcmd = false;
+
+   //same idle state rules as SPI mode, commands not allowed yet just dont get a response
+   if(unlikely(palmSdCard.inIdleState && !(isAcmd ? command == APP_SEND_OP_COND : command == GO_IDLE_STATE || command == APP_CMD || command == SEND_IF_COND))){
+      debugLog("SD bus command blocked by idle state: isAcmd:%d, cmd:%d, arg:0x%08X\n", isAcmd, command, argument);
+      return 0;
+   }
+
+   if(!isAcmd){
+      switch(command){
+         case GO_IDLE_STATE:
+            palmSdCard.inIdleState = true;
+            palmSdCard.runningCommand = 0x00;
+            break;
+
+         case ALL_SEND_CID:
+         case SEND_CID:
+            sdCardGetCid(response);
+            responseSize = 16;
+            break;
+
+         case SEND_RELATIVE_ADDR:
+            //there is only ever 1 card on the bus so the address is fixed, R6 only returns the low 16 status bits
+            responseSize = sdCardBusResponse32(response, 0x00010000 | (sdCardBusGetStatus() & 0x0000FFFF));
+            break;
+
+         case SEND_IF_COND:
+            //this is a version 1 card, it ignores this command
+            break;
+
+         case SEND_CSD:
+            sdCardGetCsd(response);
+            responseSize = 16;
+            break;
+
+         case STOP_TRANSMISSION:
+            responseSize = sdCardBusResponse32(response, sdCardBusGetStatus());
+            palmSdCard.runningCommand = 0x00;
+            break;
+
+         case SELECT_CARD:
+         case SEND_STATUS:
+            responseSize = sdCardBusResponse32(response, sdCardBusGetStatus());
+            break;
+
+         case SET_BLOCKLEN:
+            responseSize = sdCardBusResponse32(response, (argument != SD_CARD_BLOCK_SIZE ? CS_BLOCK_LEN_ERROR : 0x00000000) | sdCardBusGetStatus());
+            break;
+
+         case APP_CMD:
+            palmSdCard.commandIsAcmd = true;
+            responseSize = sdCardBusResponse32(response, sdCardBusGetStatus());
+            break;
+
+         case READ_SINGLE_BLOCK:
+         case READ_MULTIPLE_BLOCK:
+            if(likely(argument < sdCardGetSize())){
+               palmSdCard.runningCommand = command;
+               palmSdCard.runningCommandVars[0] = argument;
+               responseSize = sdCardBusResponse32(response, sdCardBusGetStatus());
+            }
+            else{
+               responseSize = sdCardBusResponse32(response, CS_OUT_OF_RANGE | sdCardBusGetStatus());
+            }
+            break;
+
+         case WRITE_SINGLE_BLOCK:
+         case WRITE_MULTIPLE_BLOCK:
+            //TODO: also need to check if block is write protected, not just the card as a whole
+            if(unlikely(palmSdCard.sdInfo.writeProtectSwitch)){
+               responseSize = sdCardBusResponse32(response, CS_WP_VIOLATION | sdCardBusGetStatus());
+            }
+            else if(likely(argument < sdCardGetSize())){
+               palmSdCard.runningCommand = command;
+               palmSdCard.runningCommandVars[0] = argument;
+               responseSize = sdCardBusResponse32(response, sdCardBusGetStatus());
+            }
+            else{
+               responseSize = sdCardBusResponse32(response, CS_OUT_OF_RANGE | sdCardBusGetStatus());
+            }
+            break;
+
+         default:
+            debugLog("SD bus unknown command: cmd:%d, arg:0x%08X\n", command, argument);
+            break;
+      }
+   }
+   else{
+      switch(command){
+         case SET_BUS_WIDTH:
+            //data is moved a block at a time so the bus width doesnt matter
+            responseSize = sdCardBusResponse32(response, CS_APP_CMD | sdCardBusGetStatus());
+            break;
+
+         case APP_SEND_OP_COND:
+            //after this is run the SD card is initialized
+            palmSdCard.inIdleState = false;
+            responseSize = sdCardBusResponse32(response, sdCardGetOcr());
+            break;
+
+         case SEND_SCR:
+            palmSdCard.runningCommand = SEND_SCR;
+            responseSize = sdCardBusResponse32(response, CS_APP_CMD | sdCardBusGetStatus());
+            break;
+
+         default:
+            debugLog("SD bus unknown ACMD command: cmd:%d, arg:0x%08X\n", command, argument);
+            break;
+      }
+   }
+
+   return responseSize;
+}
+
+uint8_t sdCardBusGetDataDirection(void){
+   if(sdCardIsInserted()){
+      switch(palmSdCard.runningCommand){
+         case READ_SINGLE_BLOCK:
+         case READ_MULTIPLE_BLOCK:
+         case SEND_SCR:
+            return SD_CARD_BUS_DATA_READ;
+
+         case WRITE_SINGLE_BLOCK:
+         case WRITE_MULTIPLE_BLOCK:
+            return SD_CARD_BUS_DATA_WRITE;
+
+         default:
+            break;
+      }
+   }
+
+   return SD_CARD_BUS_NO_DATA;
+}
+
+uint16_t sdCardBusReadData(uint8_t* data){
+   if(!sdCardIsInserted())
+      return 0;
+
+   switch(palmSdCard.runningCommand){
+      case READ_SINGLE_BLOCK:
+      case READ_MULTIPLE_BLOCK:
+         if(likely(palmSdCard.runningCommandVars[0] < sdCardGetSize())){
+            memcpy(data, sdCardGetBlock(palmSdCard.runningCommandVars[0]), SD_CARD_BLOCK_SIZE);
+            palmSdCard.runningCommandVars[0] += SD_CARD_BLOCK_SIZE;
+            if(palmSdCard.runningCommand == READ_SINGLE_BLOCK)
+               palmSdCard.runningCommand = 0x00;
+            return SD_CARD_BLOCK_SIZE;
+         }
+
+         //ran off the end of the card
+         palmSdCard.runningCommand = 0x00;
+         return 0;
+
+      case SEND_SCR:
+         sdCardGetScr(data);
+         palmSdCard.runningCommand = 0x00;
+         return 8;
+
+      default:
+         return 0;
+   }
+}
+
+bool sdCardBusWriteData(const uint8_t* data){
+   if(!sdCardIsInserted())
+      return false;
+
+   switch(palmSdCard.runningCommand){
+      case WRITE_SINGLE_BLOCK:
+      case WRITE_MULTIPLE_BLOCK:
+         if(likely(palmSdCard.runningCommandVars[0] < sdCardGetSize() && !palmSdCard.sdInfo.writeProtectSwitch)){
+            sdCardSetBlock(palmSdCard.runningCommandVars[0], data);
+            palmSdCard.runningCommandVars[0] += SD_CARD_BLOCK_SIZE;
+            if(palmSdCard.runningCommand == WRITE_SINGLE_BLOCK)
+               palmSdCard.runningCommand = 0x00;
+            return true;
+         }
+
+         palmSdCard.runningCommand = 0x00;
+         return false;
+
+      default:
+         return false;
+   }
+}
+
 /*
 Dident know where to put this note so it went here:
 CRCs should be safe to ignore on OS 5 as the CPU has builtin MMC support which does the CRC stuff automaticly,
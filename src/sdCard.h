@@ -4,10 +4,25 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+bool sdCardIsInserted(void);//a raw image or a virtual card
+uint32_t sdCardGetSize(void);
+
 void sdCardReset(void);
 
 void sdCardSetChipSelect(bool value);
 bool sdCardExchangeBit(bool bit);
 uint32_t sdCardExchangeXBitsOptimized(uint32_t bits, uint8_t size);
 
+//SD bus mode, for host controllers that send whole commands and move data a block at a time
+enum{
+   SD_CARD_BUS_NO_DATA = 0,
+   SD_CARD_BUS_DATA_READ,
+   SD_CARD_BUS_DATA_WRITE
+};
+
+uint8_t sdCardBusCommand(uint8_t command, uint32_t argument, uint8_t* response);//returns the response size in bytes, 0 means the card didnt respond
+uint8_t sdCardBusGetDataDirection(void);//for the running command
+uint16_t sdCardBusReadData(uint8_t* data);//returns the amount of bytes read, 0 on error
+bool sdCardBusWriteData(const uint8_t* data);//always SD_CARD_BLOCK_SIZE bytes, returns false if the block was rejected
+
 #endif
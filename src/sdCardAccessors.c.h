@@ -65,6 +65,24 @@ static void sdCardResponseFifoWriteByte(uint8_t value){
    }
 }
 
+static void sdCardResponseFifoWriteBuffer(const uint8_t* data, uint16_t size){
+   //same as calling sdCardResponseFifoWriteByte for each byte, without the per byte overhead
+   uint16_t space = SD_CARD_RESPONSE_FIFO_SIZE - 1 - sdCardResponseFifoByteEntrys();
+   uint16_t untilWrap = SD_CARD_RESPONSE_FIFO_SIZE - palmSdCard.responseWritePosition;
+
+   if(unlikely(size > space))
+      size = space;
+
+   if(size > untilWrap){
+      memcpy(palmSdCard.responseFifo + palmSdCard.responseWritePosition, data, untilWrap);
+      memcpy(palmSdCard.responseFifo, data + untilWrap, size - untilWrap);
+   }
+   else{
+      memcpy(palmSdCard.responseFifo + palmSdCard.responseWritePosition, data, size);
+   }
+   palmSdCard.responseWritePosition = (palmSdCard.responseWritePosition + size) % SD_CARD_RESPONSE_FIFO_SIZE;
+}
+
 static void sdCardResponseFifoFlush(void){
    palmSdCard.responseReadPosition = palmSdCard.responseWritePosition;
    palmSdCard.responseReadPositionBit = 7;
@@ -103,16 +121,15 @@ static void sdCardDoResponseR3R7(uint8_t r1, uint32_t value){
 
 static void sdCardDoResponseDataPacket(uint8_t token, const uint8_t* data, uint16_t size){
    uint16_t crc16;
-   uint16_t offset;
 
+   //CRC is off by default on SPI and Palm OS never turns it on
    if(likely(palmSdCard.allowInvalidCrc))
       crc16 = 0x0000;
    else
       crc16 = sdCardCrc16(data, size);
 
    sdCardResponseFifoWriteByte(token);
-   for(offset = 0; offset < size; offset++)
-      sdCardResponseFifoWriteByte(data[offset]);
+   sdCardResponseFifoWriteBuffer(data, size);
    sdCardResponseFifoWriteByte(crc16 >> 8);
    sdCardResponseFifoWriteByte(crc16 & 0xFF);
 }
@@ -133,7 +150,7 @@ static void sdCardGetCsd(uint8_t* csd){
    memcpy(csd, palmSdCard.sdInfo.csd, 16);
 
    //set device size field(in multiples of 256k right now, the multiplier size also scales based on chip size), needed to get size
-   deviceSize = palmSdCard.flashChipSize / SD_CARD_BLOCK_SIZE / 512;//to calculate the card capacity excluding security area ((device size + 1) * device size multiplier * max read data block length) bytes
+   deviceSize = sdCardGetSize() / SD_CARD_BLOCK_SIZE / 512;//to calculate the card capacity excluding security area ((device size + 1) * device size multiplier * max read data block length) bytes
    csd[6] = csd[6] & 0xFC | deviceSize >> 10 & 0x03;
    csd[7] = deviceSize >> 2 & 0xFF;
    csd[8] = csd[8] & 0x3F | deviceSize << 6 & 0xC0;
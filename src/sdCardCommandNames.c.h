@@ -5,6 +5,9 @@
 
 #define GO_IDLE_STATE        0/*software reset*/
 #define SEND_OP_COND         1/*initiate initialization process*/
+#define ALL_SEND_CID         2/*SD bus mode only, asks all cards to send their CID*/
+#define SEND_RELATIVE_ADDR   3/*SD bus mode only, asks the card to publish a new relative address*/
+#define SELECT_CARD          7/*SD bus mode only, toggles a card between the stand-by and transfer states*/
 #define SEND_IF_COND         8/*only for SDC V2, checks voltage range.*/
 #define SEND_CSD             9/*read CSD register*/
 #define SEND_CID             10/*read CID register*/
@@ -22,6 +25,7 @@
 #define CRC_ON_OFF           59/*turns the CRC option on or off, a 1 in the CRC option bit will turn the option on, a 0 will turn it off*/
 
 /*Application Commands*/
+#define SET_BUS_WIDTH            6/*SD bus mode only, selects a 1 or 4 bit data bus*/
 #define SET_WR_BLOCK_ERASE_COUNT 23/*only for SDC, defines number of blocks to pre-erase with next multi-block write command*/
 #define APP_SEND_OP_COND         41/*only for SDC, same as SEND_OP_COND*/
 #define SEND_SCR                 51/*reads the SCR(SD Configuration Register)*/
@@ -45,6 +49,22 @@
 #define R2_ERASE_PARAM              0x40
 #define R2_OUT_OF_RANGE             0x80/*also called R2_CSD_OVERWRITE*/
 
+/*SD Bus Mode Card Status Bits, returned in R1 responses*/
+#define CS_OUT_OF_RANGE      0x80000000
+#define CS_ADDRESS_ERROR     0x40000000
+#define CS_BLOCK_LEN_ERROR   0x20000000
+#define CS_WP_VIOLATION      0x04000000
+#define CS_ILLEGAL_COMMAND   0x00400000
+#define CS_CURRENT_STATE(x)  ((x) << 9)
+#define CS_READY_FOR_DATA    0x00000100
+#define CS_APP_CMD           0x00000020
+
+/*SD Bus Mode Card States*/
+#define CS_STATE_IDLE 0
+#define CS_STATE_TRAN 4
+#define CS_STATE_DATA 5
+#define CS_STATE_RCV  6
+
 /*Error Token Bits*/
 #define ET_ERROR           0x01
 #define ET_CC_ERROR        0x02
@@ -0,0 +1,700 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sdCardVirtual.h"
+#include "emulator.h"
+#include "portability.h"
+
+
+#define SECTOR_SIZE 512
+#define PARTITION_START 32//one track of padding before the partition like a freshly formatted card
+#define SECTORS_PER_TRACK 32
+#define HEADS 64
+#define RESERVED_SECTORS 1
+#define FAT_COPYS 2
+#define ROOT_ENTRYS 512
+#define ROOT_SECTORS (ROOT_ENTRYS * 32 / SECTOR_SIZE)
+#define MIN_CLUSTERS 4085//less and its FAT12
+#define MAX_CLUSTERS 65524//more and its FAT32
+#define MAX_SECTORS_PER_CLUSTER 64
+#define MAX_LONG_NAME_LENGTH 255
+#define ENTRY_DATE (20 << 9 | 1 << 5 | 1)//2000/01/01, host timestamps arnt passed in
+#define OVERLAY_MIN_CAPACITY 64
+
+
+enum{
+   ATTR_READ_ONLY = 0x01,
+   ATTR_HIDDEN = 0x02,
+   ATTR_SYSTEM = 0x04,
+   ATTR_VOLUME_ID = 0x08,
+   ATTR_DIRECTORY = 0x10,
+   ATTR_ARCHIVE = 0x20,
+   ATTR_LONG_NAME = ATTR_READ_ONLY | ATTR_HIDDEN | ATTR_SYSTEM | ATTR_VOLUME_ID
+};
+
+typedef struct{
+   uint32_t                      firstCluster;
+   uint32_t                      clusters;
+   const sd_card_virtual_node_t* node;
+   uint8_t*                      directory;//synthesized entrys, directorys only
+   uint32_t                      directorySize;
+}extent_t;
+
+struct sd_card_virtual_volume_t{
+   sd_card_virtual_read_t readFile;
+   uint32_t               sectors;
+   uint32_t               partitionSectors;
+   uint32_t               fatSectors;
+   uint32_t               rootStart;//all region starts are relative to the partition
+   uint32_t               dataStart;
+   uint32_t               clusters;
+   uint8_t                sectorsPerCluster;
+   uint8_t                rootDirectory[ROOT_ENTRYS * 32];
+   extent_t*              extents;//sorted by firstCluster
+   uint32_t               extentCount;
+};
+
+typedef struct{
+   uint32_t sector;
+   uint8_t* data;//NULL for empty slots
+}overlay_entry_t;
+
+
+static const sd_card_virtual_volume_t* sdCardVirtualVolume;
+static overlay_entry_t*                sdCardVirtualOverlay;
+static uint32_t                        sdCardVirtualOverlayCapacity;
+static uint32_t                        sdCardVirtualOverlayCount;
+
+
+static void writeLe16(uint8_t* data, uint16_t value){
+   data[0] = value & 0xFF;
+   data[1] = value >> 8;
+}
+
+static void writeLe32(uint8_t* data, uint32_t value){
+   data[0] = value & 0xFF;
+   data[1] = value >> 8 & 0xFF;
+   data[2] = value >> 16 & 0xFF;
+   data[3] = value >> 24;
+}
+
+static uint32_t decodeUtf8(const char** name){
+   //only the BMP fits in a long name entry, anything else becomes an underscore
+   const uint8_t* bytes = (const uint8_t*)*name;
+   uint32_t value;
+
+   if(bytes[0] < 0x80){
+      *name += 1;
+      return bytes[0];
+   }
+   if((bytes[0] & 0xE0) == 0xC0 && (bytes[1] & 0xC0) == 0x80){
+      *name += 2;
+      return (bytes[0] & 0x1F) << 6 | (bytes[1] & 0x3F);
+   }
+   if((bytes[0] & 0xF0) == 0xE0 && (bytes[1] & 0xC0) == 0x80 && (bytes[2] & 0xC0) == 0x80){
+      *name += 3;
+      value = (bytes[0] & 0x0F) << 12 | (bytes[1] & 0x3F) << 6 | (bytes[2] & 0x3F);
+      return value >= 0xD800 && value <= 0xDFFF ? '_' : value;
+   }
+
+   //skip the whole broken sequence
+   *name += 1;
+   while((**name & 0xC0) == 0x80)
+      *name += 1;
+   return '_';
+}
+
+static uint8_t getLongName(const char* name, uint16_t* longName){
+   uint16_t length = 0;
+
+   while(*name && length < MAX_LONG_NAME_LENGTH)
+      longName[length++] = decodeUtf8(&name);
+
+   return length;
+}
+
+static bool isShortNameChar(uint16_t c){
+   if((c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9'))
+      return true;
+   return c != 0 && c < 0x80 && strchr("!#$%&'()-@^_`{}", c) != NULL;
+}
+
+static bool getShortName(const uint16_t* longName, uint8_t length, uint8_t* shortName){
+   //returns true if longName is already a valid 8.3 name and no long name entrys are needed
+   int16_t dot = -1;
+   uint8_t index;
+
+   memset(shortName, ' ', 11);
+
+   for(index = 0; index < length; index++)
+      if(longName[index] == '.')
+         dot = index;
+
+   for(index = 0; index < length; index++){
+      if(index == dot)
+         continue;
+      if(longName[index] == '.' || !isShortNameChar(longName[index]))
+         return false;
+   }
+
+   if(dot == 0 || (dot == -1 ? length : dot) > 8 || (dot != -1 && length - dot - 1 > 3))
+      return false;
+
+   for(index = 0; index < (dot == -1 ? length : dot); index++)
+      shortName[index] = longName[index];
+   for(index = dot + 1; dot != -1 && index < length; index++)
+      shortName[8 + index - dot - 1] = longName[index];
+
+   return true;
+}
+
+static void getMangledShortName(const uint16_t* longName, uint8_t length, uint32_t tail, uint8_t* shortName){
+   //BASENA~N.EXT, mangled names always have a ~ and valid short names never get one so the two cant collide
+   char tailString[12];
+   int16_t dot = -1;
+   uint8_t tailLength;
+   uint8_t baseLength = 0;
+   uint8_t extLength = 0;
+   uint8_t index;
+
+   memset(shortName, ' ', 11);
+
+   for(index = 0; index < length; index++)
+      if(longName[index] == '.')
+         dot = index;
+
+   tailLength = 1;
+   tailString[0] = '~';
+   do{
+      memmove(tailString + 2, tailString + 1, tailLength - 1);
+      tailString[1] = '0' + tail % 10;
+      tailLength++;
+      tail /= 10;
+   }while(tail > 0);
+
+   for(index = 0; index < (dot > 0 ? dot : length) && baseLength < 8 - tailLength; index++){
+      uint16_t c = longName[index];
+
+      if(c >= 'a' && c <= 'z')
+         c -= 'a' - 'A';
+      if(c == ' ' || c == '.')
+         continue;
+      shortName[baseLength++] = isShortNameChar(c) ? c : '_';
+   }
+   memcpy(shortName + baseLength, tailString, tailLength);
+
+   for(index = dot + 1; dot > 0 && index < length && extLength < 3; index++){
+      uint16_t c = longName[index];
+
+      if(c >= 'a' && c <= 'z')
+         c -= 'a' - 'A';
+      if(c == ' ')
+         continue;
+      shortName[8 + extLength++] = isShortNameChar(c) ? c : '_';
+   }
+}
+
+static uint8_t getShortNameChecksum(const uint8_t* shortName){
+   uint8_t checksum = 0;
+   uint8_t index;
+
+   for(index = 0; index < 11; index++)
+      checksum = ((checksum & 1) << 7) + (checksum >> 1) + shortName[index];
+
+   return checksum;
+}
+
+static uint32_t getEntryCount(const sd_card_virtual_node_t* node){
+   uint16_t longName[MAX_LONG_NAME_LENGTH];
+   uint8_t shortName[11];
+   uint8_t length = getLongName(node->name, longName);
+
+   if(length == 0)
+      return 0;
+   if(getShortName(longName, length, shortName))
+      return 1;
+   return (length + 12) / 13 + 1;
+}
+
+static uint8_t* writeEntry(uint8_t* entry, const uint8_t* shortName, uint8_t attributes, uint32_t firstCluster, uint32_t size){
+   memcpy(entry, shortName, 11);
+   entry[11] = attributes;
+   memset(entry + 12, 0x00, 20);
+   writeLe16(entry + 16, ENTRY_DATE);//creation date
+   writeLe16(entry + 18, ENTRY_DATE);//access date
+   writeLe16(entry + 24, ENTRY_DATE);//write date
+   writeLe16(entry + 26, firstCluster);
+   writeLe32(entry + 28, size);
+
+   return entry + 32;
+}
+
+static uint8_t* writeNodeEntrys(uint8_t* entry, const sd_card_virtual_node_t* node, uint32_t firstCluster, uint32_t* mangledNames){
+   static const uint8_t longNameOffsets[13] = {1, 3, 5, 7, 9, 14, 16, 18, 20, 22, 24, 28, 30};
+   uint16_t longName[MAX_LONG_NAME_LENGTH];
+   uint8_t shortName[11];
+   uint8_t length = getLongName(node->name, longName);
+   uint8_t checksum;
+   uint8_t longEntrys;
+   uint8_t index;
+
+   if(length == 0)
+      return entry;
+
+   if(!getShortName(longName, length, shortName)){
+      *mangledNames += 1;
+      getMangledShortName(longName, length, *mangledNames, shortName);
+      checksum = getShortNameChecksum(shortName);
+      longEntrys = (length + 12) / 13;
+
+      //long name entrys are stored last piece first
+      for(index = longEntrys; index > 0; index--){
+         uint8_t piece;
+
+         memset(entry, 0x00, 32);
+         entry[0] = index | (index == longEntrys ? 0x40 : 0x00);
+         entry[11] = ATTR_LONG_NAME;
+         entry[13] = checksum;
+         for(piece = 0; piece < 13; piece++){
+            uint16_t nameIndex = (index - 1) * 13 + piece;
+
+            writeLe16(entry + longNameOffsets[piece], nameIndex < length ? longName[nameIndex] : nameIndex == length ? 0x0000 : 0xFFFF);
+         }
+         entry += 32;
+      }
+   }
+
+   return writeEntry(entry, shortName, node->isDirectory ? ATTR_DIRECTORY : ATTR_ARCHIVE, firstCluster, node->isDirectory ? 0 : node->size);
+}
+
+static uint32_t countExtents(const sd_card_virtual_node_t* directory){
+   uint32_t count = directory->childCount;
+   uint32_t index;
+
+   for(index = 0; index < directory->childCount; index++)
+      if(directory->children[index].isDirectory)
+         count += countExtents(&directory->children[index]);
+
+   return count;
+}
+
+static bool buildDirectory(sd_card_virtual_volume_t* volume, const sd_card_virtual_node_t* directory, uint32_t selfCluster, uint32_t parentCluster, uint8_t* entrys, uint32_t entrysSize, uint32_t* nextCluster){
+   //gives every child its clusters, fills in the directory entrys, then recurses into the child directorys
+   uint32_t clusterSize = volume->sectorsPerCluster * SECTOR_SIZE;
+   uint32_t firstChild = volume->extentCount;
+   uint32_t mangledNames = 0;
+   uint8_t* entry = entrys;
+   uint8_t* entrysEnd = entrys + entrysSize;
+   uint32_t index;
+
+   for(index = 0; index < directory->childCount; index++){
+      const sd_card_virtual_node_t* child = &directory->children[index];
+      extent_t* extent = &volume->extents[volume->extentCount];
+
+      extent->node = child;
+      extent->firstCluster = *nextCluster;
+      extent->directory = NULL;
+      extent->directorySize = 0;
+      if(child->isDirectory){
+         uint32_t childEntrys = 2;
+         uint32_t grandchild;
+
+         for(grandchild = 0; grandchild < child->childCount; grandchild++)
+            childEntrys += getEntryCount(&child->children[grandchild]);
+         extent->directorySize = childEntrys * 32;
+         extent->clusters = (extent->directorySize + clusterSize - 1) / clusterSize;
+         extent->directory = calloc(extent->clusters, clusterSize);
+         if(!extent->directory)
+            return false;
+      }
+      else{
+         extent->clusters = ((uint64_t)child->size + clusterSize - 1) / clusterSize;
+      }
+
+      volume->extentCount++;
+      *nextCluster += extent->clusters;
+      if(*nextCluster - 2 > volume->clusters)
+         return false;
+   }
+
+   if(selfCluster != 0){
+      //subdirectorys start with . and ..
+      static const uint8_t dotName[11] = {'.', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' '};
+      static const uint8_t dotDotName[11] = {'.', '.', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' '};
+
+      entry = writeEntry(entry, dotName, ATTR_DIRECTORY, selfCluster, 0);
+      entry = writeEntry(entry, dotDotName, ATTR_DIRECTORY, parentCluster, 0);
+   }
+
+   for(index = 0; index < directory->childCount; index++){
+      const extent_t* extent = &volume->extents[firstChild + index];
+
+      if(entry + getEntryCount(extent->node) * 32 > entrysEnd)
+         return false;
+
+      //empty files get cluster 0
+      entry = writeNodeEntrys(entry, extent->node, extent->clusters > 0 ? extent->firstCluster : 0, &mangledNames);
+   }
+
+   for(index = 0; index < directory->childCount; index++){
+      extent_t* extent = &volume->extents[firstChild + index];
+
+      if(extent->node->isDirectory)
+         if(!buildDirectory(volume, extent->node, extent->firstCluster, selfCluster, extent->directory, extent->clusters * clusterSize, nextCluster))
+            return false;
+   }
+
+   return true;
+}
+
+static const extent_t* getExtent(const sd_card_virtual_volume_t* volume, uint32_t cluster){
+   //last extent starting at or before the cluster, an empty file shares its firstCluster with the extent after it so that one wins
+   uint32_t low = 0;
+   uint32_t high = volume->extentCount;
+   const extent_t* extent;
+
+   while(low < high){
+      uint32_t middle = low + (high - low) / 2;
+
+      if(volume->extents[middle].firstCluster <= cluster)
+         low = middle + 1;
+      else
+         high = middle;
+   }
+
+   if(low == 0)
+      return NULL;
+
+   extent = &volume->extents[low - 1];
+   return cluster < extent->firstCluster + extent->clusters ? extent : NULL;
+}
+
+static void getChs(uint32_t sector, uint8_t* chs){
+   uint32_t cylinder = sector / (HEADS * SECTORS_PER_TRACK);
+
+   if(cylinder > 1023){
+      //past the CHS limit, LBA only
+      chs[0] = 0xFE;
+      chs[1] = 0xFF;
+      chs[2] = 0xFF;
+      return;
+   }
+
+   chs[0] = sector / SECTORS_PER_TRACK % HEADS;
+   chs[1] = (sector % SECTORS_PER_TRACK + 1) | ((cylinder >> 2) & 0xC0);
+   chs[2] = cylinder & 0xFF;
+}
+
+static void getMasterBootRecord(const sd_card_virtual_volume_t* volume, uint8_t* data){
+   uint8_t* partition = data + 0x1BE;
+
+   memset(data, 0x00, SECTOR_SIZE);
+   getChs(PARTITION_START, partition + 1);
+   partition[4] = volume->partitionSectors < 0x10000 ? 0x04 : 0x06;//FAT16 below and above 32mb
+   getChs(volume->sectors - 1, partition + 5);
+   writeLe32(partition + 8, PARTITION_START);
+   writeLe32(partition + 12, volume->partitionSectors);
+   data[0x1FE] = 0x55;
+   data[0x1FF] = 0xAA;
+}
+
+static void getBootSector(const sd_card_virtual_volume_t* volume, uint8_t* data){
+   memset(data, 0x00, SECTOR_SIZE);
+   data[0] = 0xEB;//jmp short
+   data[1] = 0x3C;
+   data[2] = 0x90;//nop
+   memcpy(data + 3, "MU      ", 8);
+   writeLe16(data + 11, SECTOR_SIZE);
+   data[13] = volume->sectorsPerCluster;
+   writeLe16(data + 14, RESERVED_SECTORS);
+   data[16] = FAT_COPYS;
+   writeLe16(data + 17, ROOT_ENTRYS);
+   writeLe16(data + 19, volume->partitionSectors < 0x10000 ? volume->partitionSectors : 0);
+   data[21] = 0xF8;//media descriptor, fixed disk
+   writeLe16(data + 22, volume->fatSectors);
+   writeLe16(data + 24, SECTORS_PER_TRACK);
+   writeLe16(data + 26, HEADS);
+   writeLe32(data + 28, PARTITION_START);//hidden sectors
+   writeLe32(data + 32, volume->partitionSectors < 0x10000 ? 0 : volume->partitionSectors);
+   data[36] = 0x80;//drive number
+   data[38] = 0x29;//extended boot signature
+   writeLe32(data + 39, 0x4D55564F);//volume ID
+   memcpy(data + 43, "MU VIRTUAL ", 11);
+   memcpy(data + 54, "FAT16   ", 8);
+   data[0x1FE] = 0x55;
+   data[0x1FF] = 0xAA;
+}
+
+static void getFatSector(const sd_card_virtual_volume_t* volume, uint32_t fatSector, uint8_t* data){
+   uint32_t cluster = fatSector * (SECTOR_SIZE / 2);
+   uint16_t index;
+
+   for(index = 0; index < SECTOR_SIZE / 2; index++, cluster++){
+      uint16_t value;
+
+      if(cluster < 2){
+         value = cluster == 0 ? 0xFFF8 : 0xFFFF;
+      }
+      else{
+         const extent_t* extent = cluster < volume->clusters + 2 ? getExtent(volume, cluster) : NULL;
+
+         if(extent)
+            value = cluster + 1 < extent->firstCluster + extent->clusters ? cluster + 1 : 0xFFFF;
+         else
+            value = 0x0000;
+      }
+
+      writeLe16(data + index * 2, value);
+   }
+}
+
+static void getDataSector(const sd_card_virtual_volume_t* volume, uint32_t dataSector, uint8_t* data){
+   uint32_t cluster = dataSector / volume->sectorsPerCluster + 2;
+   const extent_t* extent = cluster < volume->clusters + 2 ? getExtent(volume, cluster) : NULL;
+   uint32_t offset;
+
+   memset(data, 0x00, SECTOR_SIZE);
+
+   if(!extent)
+      return;
+
+   offset = (dataSector - (extent->firstCluster - 2) * volume->sectorsPerCluster) * SECTOR_SIZE;
+   if(extent->directory){
+      memcpy(data, extent->directory + offset, SECTOR_SIZE);
+   }
+   else if(offset < extent->node->size){
+      uint32_t size = extent->node->size - offset < SECTOR_SIZE ? extent->node->size - offset : SECTOR_SIZE;
+
+      volume->readFile(extent->node->file, offset, data, size);
+   }
+}
+
+static void getSector(const sd_card_virtual_volume_t* volume, uint32_t sector, uint8_t* data){
+   uint32_t partitionSector;
+
+   if(sector == 0){
+      getMasterBootRecord(volume, data);
+      return;
+   }
+
+   if(sector < PARTITION_START || sector >= volume->sectors){
+      memset(data, 0x00, SECTOR_SIZE);
+      return;
+   }
+
+   partitionSector = sector - PARTITION_START;
+   if(partitionSector < RESERVED_SECTORS)
+      getBootSector(volume, data);
+   else if(partitionSector < volume->rootStart)
+      getFatSector(volume, (partitionSector - RESERVED_SECTORS) % volume->fatSectors, data);
+   else if(partitionSector < volume->dataStart)
+      memcpy(data, volume->rootDirectory + (partitionSector - volume->rootStart) * SECTOR_SIZE, SECTOR_SIZE);
+   else
+      getDataSector(volume, partitionSector - volume->dataStart, data);
+}
+
+static overlay_entry_t* overlayFind(uint32_t sector){
+   //linear probing, returns the empty slot the sector would go in if its not there
+   uint32_t index = (sector * 2654435761u) & (sdCardVirtualOverlayCapacity - 1);
+
+   while(sdCardVirtualOverlay[index].data && sdCardVirtualOverlay[index].sector != sector)
+      index = (index + 1) & (sdCardVirtualOverlayCapacity - 1);
+
+   return &sdCardVirtualOverlay[index];
+}
+
+static uint8_t* overlayGetSector(uint32_t sector, bool create){
+   overlay_entry_t* entry;
+
+   if(!sdCardVirtualOverlay){
+      if(!create)
+         return NULL;
+
+      sdCardVirtualOverlay = calloc(OVERLAY_MIN_CAPACITY, sizeof(overlay_entry_t));
+      if(!sdCardVirtualOverlay)
+         return NULL;
+      sdCardVirtualOverlayCapacity = OVERLAY_MIN_CAPACITY;
+   }
+
+   entry = overlayFind(sector);
+   if(entry->data || !create)
+      return entry->data;
+
+   //keep the load under 3/4
+   if((sdCardVirtualOverlayCount + 1) * 4 > sdCardVirtualOverlayCapacity * 3){
+      overlay_entry_t* oldOverlay = sdCardVirtualOverlay;
+      uint32_t oldCapacity = sdCardVirtualOverlayCapacity;
+      uint32_t index;
+
+      sdCardVirtualOverlay = calloc(oldCapacity * 2, sizeof(overlay_entry_t));
+      if(!sdCardVirtualOverlay){
+         sdCardVirtualOverlay = oldOverlay;
+         return NULL;
+      }
+      sdCardVirtualOverlayCapacity = oldCapacity * 2;
+
+      for(index = 0; index < oldCapacity; index++)
+         if(oldOverlay[index].data)
+            *overlayFind(oldOverlay[index].sector) = oldOverlay[index];
+      free(oldOverlay);
+
+      entry = overlayFind(sector);
+   }
+
+   entry->data = malloc(SECTOR_SIZE);
+   if(!entry->data)
+      return NULL;
+   entry->sector = sector;
+   sdCardVirtualOverlayCount++;
+
+   //partial writes need the rest of the sector
+   getSector(sdCardVirtualVolume, sector, entry->data);
+
+   return entry->data;
+}
+
+sd_card_virtual_volume_t* sdCardVirtualCreateVolume(const sd_card_virtual_node_t* root, uint32_t size, sd_card_virtual_read_t readFile){
+   static const uint8_t volumeLabel[11] = {'M', 'U', ' ', 'V', 'I', 'R', 'T', 'U', 'A', 'L', ' '};
+   sd_card_virtual_volume_t* volume;
+   uint32_t rootEntrys = 1;//volume label
+   uint32_t nextCluster = 2;
+   uint32_t index;
+
+   if(!root || !root->isDirectory || !readFile)
+      return NULL;
+
+   volume = calloc(1, sizeof(sd_card_virtual_volume_t));
+   if(!volume)
+      return NULL;
+
+   //work out the FAT16 layout, sectors per cluster grow until the cluster count fits
+   volume->readFile = readFile;
+   volume->sectors = size / SECTOR_SIZE;
+   volume->partitionSectors = volume->sectors > PARTITION_START ? volume->sectors - PARTITION_START : 0;
+   volume->sectorsPerCluster = 1;
+   while(volume->partitionSectors / volume->sectorsPerCluster > MAX_CLUSTERS && volume->sectorsPerCluster < MAX_SECTORS_PER_CLUSTER)
+      volume->sectorsPerCluster *= 2;
+   volume->fatSectors = ((volume->partitionSectors / volume->sectorsPerCluster + 2) * 2 + SECTOR_SIZE - 1) / SECTOR_SIZE;
+   volume->rootStart = RESERVED_SECTORS + FAT_COPYS * volume->fatSectors;
+   volume->dataStart = volume->rootStart + ROOT_SECTORS;
+   volume->clusters = volume->partitionSectors > volume->dataStart ? (volume->partitionSectors - volume->dataStart) / volume->sectorsPerCluster : 0;
+   if(volume->clusters > MAX_CLUSTERS)
+      volume->clusters = MAX_CLUSTERS;
+   if(volume->clusters < MIN_CLUSTERS){
+      free(volume);
+      return NULL;
+   }
+
+   for(index = 0; index < root->childCount; index++)
+      rootEntrys += getEntryCount(&root->children[index]);
+   if(rootEntrys > ROOT_ENTRYS){
+      free(volume);
+      return NULL;
+   }
+
+   volume->extents = malloc(countExtents(root) * sizeof(extent_t) + 1);
+   if(!volume->extents){
+      free(volume);
+      return NULL;
+   }
+
+   writeEntry(volume->rootDirectory, volumeLabel, ATTR_VOLUME_ID, 0, 0);
+
+   if(!buildDirectory(volume, root, 0, 0, volume->rootDirectory + 32, sizeof(volume->rootDirectory) - 32, &nextCluster)){
+      sdCardVirtualDestroyVolume(volume);
+      return NULL;
+   }
+
+   return volume;
+}
+
+void sdCardVirtualDestroyVolume(sd_card_virtual_volume_t* volume){
+   uint32_t index;
+
+   if(!volume)
+      return;
+
+   for(index = 0; index < volume->extentCount; index++)
+      free(volume->extents[index].directory);
+   free(volume->extents);
+   free(volume);
+}
+
+bool sdCardVirtualInsert(const sd_card_virtual_volume_t* volume){
+   if(sdCardVirtualVolume || !volume)
+      return false;
+
+   sdCardVirtualVolume = volume;
+   return true;
+}
+
+void sdCardVirtualEject(void){
+   uint32_t index;
+
+   //guest writes are dropped with the card
+   if(sdCardVirtualOverlay){
+      for(index = 0; index < sdCardVirtualOverlayCapacity; index++)
+         free(sdCardVirtualOverlay[index].data);
+      free(sdCardVirtualOverlay);
+      sdCardVirtualOverlay = NULL;
+   }
+   sdCardVirtualOverlayCapacity = 0;
+   sdCardVirtualOverlayCount = 0;
+   sdCardVirtualVolume = NULL;
+}
+
+bool sdCardVirtualIsInserted(void){
+   return sdCardVirtualVolume != NULL;
+}
+
+uint32_t sdCardVirtualGetSize(void){
+   return sdCardVirtualVolume ? sdCardVirtualVolume->sectors * SECTOR_SIZE : 0;
+}
+
+void sdCardVirtualRead(uint32_t offset, uint8_t* data, uint32_t size){
+   while(size > 0){
+      uint32_t sector = offset / SECTOR_SIZE;
+      uint32_t sectorOffset = offset % SECTOR_SIZE;
+      uint32_t chunk = SECTOR_SIZE - sectorOffset < size ? SECTOR_SIZE - sectorOffset : size;
+      uint8_t* written = overlayGetSector(sector, false);
+
+      if(written){
+         memcpy(data, written + sectorOffset, chunk);
+      }
+      else if(sectorOffset == 0 && chunk == SECTOR_SIZE){
+         getSector(sdCardVirtualVolume, sector, data);
+      }
+      else{
+         uint8_t buffer[SECTOR_SIZE];
+
+         getSector(sdCardVirtualVolume, sector, buffer);
+         memcpy(data, buffer + sectorOffset, chunk);
+      }
+
+      offset += chunk;
+      data += chunk;
+      size -= chunk;
+   }
+}
+
+void sdCardVirtualWrite(uint32_t offset, const uint8_t* data, uint32_t size){
+   while(size > 0){
+      uint32_t sector = offset / SECTOR_SIZE;
+      uint32_t sectorOffset = offset % SECTOR_SIZE;
+      uint32_t chunk = SECTOR_SIZE - sectorOffset < size ? SECTOR_SIZE - sectorOffset : size;
+      uint8_t* written = overlayGetSector(sector, true);
+
+      if(unlikely(!written)){
+         debugLog("Virtual SD card overlay out of memory, write to sector %d lost\n", sector);
+         return;
+      }
+
+      memcpy(written + sectorOffset, data, chunk);
+
+      offset += chunk;
+      data += chunk;
+      size -= chunk;
+   }
+}
@@ -0,0 +1,47 @@
+#ifndef SD_CARD_VIRTUAL_H
+#define SD_CARD_VIRTUAL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//a FAT16 SD card synthesized from a host directory tree, the frontend describes the tree and supplies file data on demand
+//a volume is never written after creation so several cards can be backed by one read only tree,
+//guest writes land in the inserted card's sparse overlay and never reach the host files
+
+typedef struct sd_card_virtual_node_t sd_card_virtual_node_t;
+struct sd_card_virtual_node_t{
+   const char*                   name;//UTF-8, not used for the root node
+   bool                          isDirectory;
+   uint32_t                      size;//files only
+   const sd_card_virtual_node_t* children;//directories only
+   uint32_t                      childCount;//directories only
+   void*                         file;//files only, passed to the read callback
+};
+
+//must fill data with size bytes starting at offset, returns the amount of bytes read, the rest of the buffer is zeroed
+//if a volume is shared between threads this can be called from all of them at once
+typedef uint32_t (*sd_card_virtual_read_t)(void* file, uint32_t offset, uint8_t* data, uint32_t size);
+
+typedef struct sd_card_virtual_volume_t sd_card_virtual_volume_t;
+
+//the node tree must stay valid until the volume is destroyed, returns NULL if the tree wont fit in size bytes
+sd_card_virtual_volume_t* sdCardVirtualCreateVolume(const sd_card_virtual_node_t* root, uint32_t size, sd_card_virtual_read_t readFile);
+void sdCardVirtualDestroyVolume(sd_card_virtual_volume_t* volume);//eject it from every instance first
+
+//the inserted card
+bool sdCardVirtualInsert(const sd_card_virtual_volume_t* volume);
+void sdCardVirtualEject(void);
+bool sdCardVirtualIsInserted(void);
+uint32_t sdCardVirtualGetSize(void);
+void sdCardVirtualRead(uint32_t offset, uint8_t* data, uint32_t size);
+void sdCardVirtualWrite(uint32_t offset, const uint8_t* data, uint32_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -64,6 +64,9 @@ static bool     tsc2101CommandFinished;
 static bool     tsc2101Read;
 static bool     tsc2101On;
 static bool     tsc2101ChipSelect;
+static bool     tsc2101PenDown;
+static bool     tsc2101InterruptActive;
+static uint16_t tsc2101ThresholdAlarms;//data registers that crossed a threshold on their last conversion
 
 
 static uint8_t tsc2101BufferFifoEntrys(void){
@@ -182,8 +185,38 @@ static uint16_t tsc2101GetTemp2Value(void){
    return 0x777 & tsc2101GetAnalogMask();
 }
 
+static void tsc2101SetInterrupt(bool active){
+   tsc2101InterruptActive = active;
+
+   //TODO: using invaild pin reference, check against hardware
+   pxa260gpioSetState(&pxa260Gpio, 37, !active);
+}
+
+static void tsc2101CheckThresholds(void){
+   uint16_t temp = (tsc2101Registers[TOUCH_CONTROL_MEASUREMENT_CONFIGURATION] & 0x8000) ? tsc2101Registers[TOUCH_DATA_TEMP2] : tsc2101Registers[TOUCH_DATA_TEMP1];
+   uint16_t alarms = 0x0000;
+
+   //only done when a conversion finishes, the results cant change in between
+   if(tsc2101Registers[TOUCH_CONTROL_TEMPERATURE_MAX] & 0x1000 && temp >= (tsc2101Registers[TOUCH_CONTROL_TEMPERATURE_MAX] & 0xFFF))
+      alarms |= 1 << TOUCH_DATA_TEMP1 | 1 << TOUCH_DATA_TEMP2;
+   if(tsc2101Registers[TOUCH_CONTROL_TEMPERATURE_MIN] & 0x1000 && temp <= (tsc2101Registers[TOUCH_CONTROL_TEMPERATURE_MIN] & 0xFFF))
+      alarms |= 1 << TOUCH_DATA_TEMP1 | 1 << TOUCH_DATA_TEMP2;
+   if(tsc2101Registers[TOUCH_CONTROL_AUX1_MAX] & 0x1000 && tsc2101Registers[TOUCH_DATA_AUX1] >= (tsc2101Registers[TOUCH_CONTROL_AUX1_MAX] & 0xFFF))
+      alarms |= 1 << TOUCH_DATA_AUX1;
+   if(tsc2101Registers[TOUCH_CONTROL_AUX1_MIN] & 0x1000 && tsc2101Registers[TOUCH_DATA_AUX1] <= (tsc2101Registers[TOUCH_CONTROL_AUX1_MIN] & 0xFFF))
+      alarms |= 1 << TOUCH_DATA_AUX1;
+   if(tsc2101Registers[TOUCH_CONTROL_AUX2_MAX] & 0x1000 && tsc2101Registers[TOUCH_DATA_AUX2] >= (tsc2101Registers[TOUCH_CONTROL_AUX2_MAX] & 0xFFF))
+      alarms |= 1 << TOUCH_DATA_AUX2;
+   if(tsc2101Registers[TOUCH_CONTROL_AUX2_MIN] & 0x1000 && tsc2101Registers[TOUCH_DATA_AUX2] <= (tsc2101Registers[TOUCH_CONTROL_AUX2_MIN] & 0xFFF))
+      alarms |= 1 << TOUCH_DATA_AUX2;
+
+   //only the registers that were just converted can set an alarm
+   tsc2101ThresholdAlarms |= alarms & tsc2101HasNewData;
+}
+
 static void tsc2101ResetRegisters(void){
    tsc2101HasNewData = 0x0000;
+   tsc2101ThresholdAlarms = 0x0000;
 
    memset(tsc2101Registers, 0x00, sizeof(tsc2101Registers));
 
@@ -192,7 +225,9 @@ static void tsc2101ResetRegisters(void){
    tsc2101Registers[TOUCH_CONTROL_REFERENCE] = 0x0002;
    //currenly at register 0x5 of touch control
 
-   tsc2101UpdateInterrupt();
+   //the cached pin state is unknown after a reset, always drive it, no data is pending and PINTDAV is pen or data so only the pen matters
+   tsc2101PenDown = palmInput.touchscreenTouched;
+   tsc2101SetInterrupt(tsc2101PenDown);
 }
 
 static uint16_t tsc2101RegisterRead(uint8_t page, uint8_t address){
@@ -200,7 +235,7 @@ static uint16_t tsc2101RegisterRead(uint8_t page, uint8_t address){
 
    switch(combinedRegisterNumber){
       case TOUCH_CONTROL_TSC_ADC:
-         return tsc2101Registers[TOUCH_CONTROL_TSC_ADC] & 0x3FFF | palmInput.touchscreenTouched << 15 | 1 << 14/*TODO: this states the ADC is never busy*/;
+         return tsc2101Registers[TOUCH_CONTROL_TSC_ADC] & 0x3FFF | tsc2101PenDown << 15 | 1 << 14/*TODO: this states the ADC is never busy*/;
 
       case TOUCH_CONTROL_STATUS:{
             uint16_t value = tsc2101Registers[TOUCH_CONTROL_STATUS] & 0xF000;
@@ -241,12 +276,17 @@ static uint16_t tsc2101RegisterRead(uint8_t page, uint8_t address){
       case TOUCH_DATA_TEMP2:
          debugLog("TSC2101 read ADC data register:%d\n", combinedRegisterNumber);
          tsc2101HasNewData &= ~(1 << combinedRegisterNumber);
-         tsc2101UpdateInterrupt();//clearing the new data bit could trigger an interrupt
+         tsc2101ThresholdAlarms &= ~(1 << combinedRegisterNumber);
+         tsc2101UpdateInterrupt();//clearing the new data bit could clear the interrupt
          return tsc2101Registers[combinedRegisterNumber];
 
       default:
-         if(page == 3)
-            return tsc2101BufferFifoRead();
+         if(page == 3){
+            uint16_t value = tsc2101BufferFifoRead();
+
+            tsc2101UpdateInterrupt();//the FIFO may have dropped below the trigger level
+            return value;
+         }
          debugLog("Unimplemented TSC2101 register read, page:0x%01X, address:0x%02X\n", page, address);
          return 0x0000;//TODO: this may need to be 0xFFFF
    }
@@ -298,13 +338,12 @@ static void tsc2101RegisterWrite(uint8_t page, uint8_t address, uint16_t value){
       case TOUCH_CONTROL_AUX1_MIN:
       case TOUCH_CONTROL_AUX2_MAX:
       case TOUCH_CONTROL_AUX2_MIN:
+         //thresholds are only compared when a conversion finishes
          tsc2101Registers[combinedRegisterNumber] = value & 0x1FFF;
-         tsc2101UpdateInterrupt();
          return;
 
       case TOUCH_CONTROL_MEASUREMENT_CONFIGURATION:
          tsc2101Registers[TOUCH_CONTROL_MEASUREMENT_CONFIGURATION] = value & 0xFE04;
-         tsc2101UpdateInterrupt();
          return;
 
       case TOUCH_DATA_X:
@@ -439,55 +478,35 @@ bool tsc2101ExchangeBit(bool bit){
    return output;
 }
 
+void tsc2101UpdatePen(void){
+   //only pen down and up edges need to touch the interrupt line
+   if(palmInput.touchscreenTouched != tsc2101PenDown){
+      tsc2101PenDown = palmInput.touchscreenTouched;
+      tsc2101UpdateInterrupt();
+   }
+}
+
 void tsc2101UpdateInterrupt(void){
-   debugLog("TSC2101 PINTDAV not fully implemented\n");
+   uint8_t pintdav = tsc2101Registers[TOUCH_CONTROL_STATUS] >> 14 & 0x0003;
+   bool active = false;
 
    //check if PINTDAV is data or pen and data interrupt
-   if(tsc2101Registers[TOUCH_CONTROL_STATUS] >> 14 & 0x0003){
-      if(tsc2101Registers[TOUCH_CONTROL_TEMPERATURE_MAX] & 0x1000 && ((tsc2101Registers[TOUCH_CONTROL_MEASUREMENT_CONFIGURATION] & 0x8000) ? tsc2101Registers[TOUCH_DATA_TEMP2] : tsc2101Registers[TOUCH_DATA_TEMP1]) >= (tsc2101Registers[TOUCH_CONTROL_TEMPERATURE_MAX] & 0xFFF))
-         goto trigger;
-
-      if(tsc2101Registers[TOUCH_CONTROL_TEMPERATURE_MIN] & 0x1000 && ((tsc2101Registers[TOUCH_CONTROL_MEASUREMENT_CONFIGURATION] & 0x8000) ? tsc2101Registers[TOUCH_DATA_TEMP2] : tsc2101Registers[TOUCH_DATA_TEMP1]) <= (tsc2101Registers[TOUCH_CONTROL_TEMPERATURE_MIN] & 0xFFF))
-         goto trigger;
-
-      if(tsc2101Registers[TOUCH_CONTROL_AUX1_MAX] & 0x1000 && tsc2101Registers[TOUCH_DATA_AUX1] >= (tsc2101Registers[TOUCH_CONTROL_AUX1_MAX] & 0xFFF))
-         goto trigger;
-
-      if(tsc2101Registers[TOUCH_CONTROL_AUX1_MIN] & 0x1000 && tsc2101Registers[TOUCH_DATA_AUX1] <= (tsc2101Registers[TOUCH_CONTROL_AUX1_MIN] & 0xFFF))
-         goto trigger;
-
-      if(tsc2101Registers[TOUCH_CONTROL_AUX2_MAX] & 0x1000 && tsc2101Registers[TOUCH_DATA_AUX2] >= (tsc2101Registers[TOUCH_CONTROL_AUX2_MAX] & 0xFFF))
-         goto trigger;
-
-      if(tsc2101Registers[TOUCH_CONTROL_AUX2_MIN] & 0x1000 && tsc2101Registers[TOUCH_DATA_AUX2] <= (tsc2101Registers[TOUCH_CONTROL_AUX2_MIN] & 0xFFF))
-         goto trigger;
-
-      if(tsc2101Registers[TOUCH_CONTROL_BUFFER_MODE] & 0x8000){
-         //buffer mode, check if data is in buffer
-         if(tsc2101BufferFifoEntrys() >= ((tsc2101Registers[TOUCH_CONTROL_BUFFER_MODE] >> 11 & 0x0007) + 1) * 8)
-            goto trigger;
-      }
-      else{
-         //register mode
-         if(tsc2101HasNewData)
-            goto trigger;
-      }
+   if(pintdav != 0x0000){
+      if(tsc2101ThresholdAlarms)
+         active = true;
+      else if(tsc2101Registers[TOUCH_CONTROL_BUFFER_MODE] & 0x8000)
+         active = tsc2101BufferFifoEntrys() >= ((tsc2101Registers[TOUCH_CONTROL_BUFFER_MODE] >> 11 & 0x0007) + 1) * 8;//buffer mode, check if the trigger level is reached
+      else
+         active = !!tsc2101HasNewData;//register mode
    }
 
    //TODO: ignoring touch detect power down
    //check PINTDAV is pen or pen and data interrupt and pen is down
-   if((tsc2101Registers[TOUCH_CONTROL_STATUS] >> 14 & 0x0003) != 0x0001)
-      if(palmInput.touchscreenTouched)
-         goto trigger;
+   if(pintdav != 0x0001 && tsc2101PenDown)
+      active = true;
 
-   //TODO: using invaild pin reference, check against hardware
-   pxa260gpioSetState(&pxa260Gpio, 37, true);
-   return;
-
-   trigger:
-   //TODO: using invaild pin reference, check against hardware
-   pxa260gpioSetState(&pxa260Gpio, 37, false);
-   return;
+   if(active != tsc2101InterruptActive)
+      tsc2101SetInterrupt(active);
 }
 
 void tsc2101Scan(void){
@@ -635,6 +654,7 @@ void tsc2101Scan(void){
    else
       tsc2101Registers[TOUCH_CONTROL_TSC_ADC] &= 0xC3FF;
 
+   tsc2101CheckThresholds();
    tsc2101UpdateInterrupt();
 }
 
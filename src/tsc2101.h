@@ -12,7 +12,8 @@ void tsc2101LoadState(uint8_t* data);
 void tsc2101SetPwrDn(bool value);
 void tsc2101SetChipSelect(bool value);
 bool tsc2101ExchangeBit(bool bit);
-void tsc2101UpdateInterrupt(void);//called after touchscreen update to flush the values
+void tsc2101UpdatePen(void);//called after touchscreen update, only changes the interrupt on pen up/down
+void tsc2101UpdateInterrupt(void);
 //TODO: this chip seems to do audio output, need to add a 16bit optimized transfer function
 
 void tsc2101Scan(void);
@@ -1,14 +1,6 @@
 #ifndef TUNGSTEN_T3_BUS_H
 #define TUNGSTEN_T3_BUS_H
 
-#define PXA260_BANK_SCOOT 26
-#define PXA260_NUM_BANKS(areaSize) (((areaSize) >> PXA260_BANK_SCOOT) + ((areaSize) & ((1 << PXA260_BANK_SCOOT) - 1) ? 1 : 0))
-#define PXA260_START_BANK(address) ((address) >> PXA260_BANK_SCOOT)
-#define PXA260_END_BANK(address, size) (PXA260_START_BANK(address) + PXA260_NUM_BANKS(size) - 1)
-#define PXA260_BANK_IN_RANGE(bank, address, size) ((bank) >= PXA260_START_BANK(address) && (bank) <= PXA260_END_BANK(address, size))
-#define PXA260_BANK_ADDRESS(bank) ((bank) << PXA260_BANK_SCOOT)
-#define PXA260_TOTAL_MEMORY_BANKS (1 << (32 - PXA260_BANK_SCOOT))//64 banks for *_BANK_SCOOT = 26
-
 #define PXA260_ROM_START_ADDRESS 0x00000000
 #define PXA260_RAM_START_ADDRESS 0xA0000000
 #define TUNGSTEN_T3_W86L488_START_ADDRESS 0x08000000
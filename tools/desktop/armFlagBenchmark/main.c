@@ -0,0 +1,63 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../../../src/emulator.h"
+#include "../../../src/pxa260/pxa260.h"
+
+
+#define FRAMES 600
+
+
+//ALU loop where most flag results are overwritten before anything reads them
+static const uint32_t aluLoop[] = {
+   0xE3A00001,//   mov  r0, #1
+   0xE3A02000,//   mov  r2, #0
+   0xE0922000,//loop: adds r2, r2, r0
+   0xE0233002,//   eor  r3, r3, r2
+   0xE0524003,//   subs r4, r2, r3
+   0xE0855084,//   add  r5, r5, r4, lsl #1
+   0xE1956002,//   orrs r6, r5, r2
+   0xE2467001,//   sub  r7, r6, #1
+   0xE2800001,//   add  r0, r0, #1
+   0xE21780FF,//   ands r8, r7, #0xFF
+   0xE3580C01,//   cmp  r8, #0x100
+   0x1AFFFFF5 //   bne  loop
+};
+
+
+int main(int argc, const char* argv[]){
+   uint8_t* rom = calloc(1, sizeof(aluLoop));
+   uint32_t checksum = 0;
+   clock_t start;
+   double seconds;
+   uint32_t error;
+   uint8_t reg;
+   uint32_t frame;
+
+   memcpy(rom, aluLoop, sizeof(aluLoop));
+   error = emulatorInit(EMU_DEVICE_TUNGSTEN_T3, rom, sizeof(aluLoop), NULL, 0, false, false, EMU_ARM_CORE_ARMV5TE);
+   free(rom);
+   if(error != EMU_ERROR_NONE){
+      printf("emulatorInit failed: %d\n", error);
+      return 1;
+   }
+
+   start = clock();
+   for(frame = 0; frame < FRAMES; frame++)
+      emulatorRunFrame();
+   seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+   //both builds have to end in the exact same state
+   for(reg = 0; reg < 9; reg++)
+      checksum = checksum * 31 + pxa260GetRegister(reg);
+   checksum = checksum * 31 + (pxa260GetCpsr() & 0xF0000000);
+
+   printf("%s: %u frames in %.3f seconds, %u loops, state checksum 0x%08X\n", argc > 0 ? argv[0] : "", FRAMES, seconds, pxa260GetRegister(0) - 1, checksum);
+
+   emulatorDeinit();
+   return 0;
+}
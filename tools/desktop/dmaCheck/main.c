@@ -0,0 +1,122 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../../src/emulator.h"
+#include "../../../src/tungstenT3Bus.h"
+#include "../../../src/pxa260/pxa260.h"
+#include "../../../src/pxa260/pxa260_DMA.h"
+#include "../../../src/pxa260/pxa260Timing.h"
+
+
+#define CHANNEL 3
+#define REQUEST PXA260_DMA_REQUEST_SSP_RX
+#define SOURCE 0x1000
+#define TARGET 0x2000
+#define LENGTH 32
+#define BURST 8
+
+#define DCSR(n) (0x0000 + (n) * 4)
+#define DRCMR(n) (0x0100 + (n) * 4)
+#define DSADR(n) (0x0204 + (n) * 16)
+#define DTADR(n) (0x0208 + (n) * 16)
+#define DCMD(n) (0x020C + (n) * 16)
+#define DINT 0x00F0
+
+#define DCSR_RUN 0x80000000
+#define DCSR_NODESCFETCH 0x40000000
+#define DCSR_STOPSTATE 0x00000008
+#define DCSR_ENDINTR 0x00000004
+#define DCMD_INCSRCADDR 0x80000000
+#define DCMD_INCTRGADDR 0x40000000
+#define DCMD_FLOWSRC 0x20000000
+#define DCMD_ENDIRQEN 0x00200000
+#define DCMD_SIZE_8 0x00010000
+
+
+//the CPU just spins while the DMA controller works
+static const uint32_t spin[] = {
+   0xEAFFFFFE,//loop: b loop
+   0x00000000
+};
+
+
+static void dmaWrite(uint32_t offset, uint32_t value){
+   pxa260dmaPrvMemAccessF(&pxa260Dma, PXA260_DMA_BASE + offset, 4, true, &value);
+}
+
+static uint32_t dmaRead(uint32_t offset){
+   uint32_t value;
+
+   pxa260dmaPrvMemAccessF(&pxa260Dma, PXA260_DMA_BASE + offset, 4, false, &value);
+   return value;
+}
+
+static uint32_t bytesMoved(void){
+   uint32_t count = 0;
+
+   while(count < LENGTH && palmRam[TARGET + count] == palmRam[SOURCE + count])
+      count++;
+   return count;
+}
+
+static bool check(const char* name, bool passed){
+   printf("%s: %s\n", name, passed ? "passed" : "FAILED");
+   return passed;
+}
+
+
+int main(int argc, const char* argv[]){
+   uint8_t* rom = malloc(sizeof(spin));
+   bool passed = true;
+   uint32_t error;
+   uint32_t moved;
+   uint32_t index;
+
+   memcpy(rom, spin, sizeof(spin));
+   error = emulatorInit(EMU_DEVICE_TUNGSTEN_T3, rom, sizeof(spin), NULL, 0, false, false, EMU_ARM_CORE_ARMV5TE);
+   free(rom);
+   if(error != EMU_ERROR_NONE){
+      printf("emulatorInit failed: %d\n", error);
+      return 1;
+   }
+
+   for(index = 0; index < LENGTH; index++){
+      palmRam[SOURCE + index] = index + 1;
+      palmRam[TARGET + index] = 0x00;
+   }
+
+   //memory to memory, paced by the SSP RX line like a peripheral FIFO would pace it
+   dmaWrite(DRCMR(REQUEST), 0x80 | CHANNEL);
+   dmaWrite(DSADR(CHANNEL), PXA260_RAM_START_ADDRESS + SOURCE);
+   dmaWrite(DTADR(CHANNEL), PXA260_RAM_START_ADDRESS + TARGET);
+   dmaWrite(DCMD(CHANNEL), DCMD_INCSRCADDR | DCMD_INCTRGADDR | DCMD_FLOWSRC | DCMD_ENDIRQEN | DCMD_SIZE_8 | LENGTH);
+   dmaWrite(DCSR(CHANNEL), DCSR_RUN | DCSR_NODESCFETCH);
+
+   //no request, nothing moves
+   emulatorRunFrame();
+   passed &= check("waits without a request", bytesMoved() == 0 && (dmaRead(DCSR(CHANNEL)) & DCSR_RUN));
+
+   //one burst at a time while the line is up
+   pxa260dmaSetRequest(&pxa260Dma, REQUEST, true);
+   for(index = 0; index < 1000 && bytesMoved() == 0; index++)
+      pxa260TimingRun(1);
+   pxa260dmaSetRequest(&pxa260Dma, REQUEST, false);
+   moved = bytesMoved();
+   passed &= check("moves whole bursts", moved > 0 && moved < LENGTH && moved % BURST == 0);
+
+   //dropping the line pauses the channel mid descriptor
+   emulatorRunFrame();
+   passed &= check("pauses when the request drops", bytesMoved() == moved && !(dmaRead(DCSR(CHANNEL)) & DCSR_STOPSTATE));
+
+   //raising it again finishes the descriptor and stops the channel
+   pxa260dmaSetRequest(&pxa260Dma, REQUEST, true);
+   emulatorRunFrame();
+   passed &= check("finishes the descriptor", bytesMoved() == LENGTH && memcmp(palmRam + SOURCE, palmRam + TARGET, LENGTH) == 0);
+   passed &= check("stops with an end interrupt", (dmaRead(DCSR(CHANNEL)) & (DCSR_RUN | DCSR_STOPSTATE | DCSR_ENDINTR)) == (DCSR_STOPSTATE | DCSR_ENDINTR) && (dmaRead(DINT) & 1 << CHANNEL));
+
+   emulatorDeinit();
+   return passed ? 0 : 1;
+}
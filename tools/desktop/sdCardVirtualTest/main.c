@@ -0,0 +1,282 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../../src/emulator.h"
+#include "../../../src/sdCard.h"
+#include "../../../src/sdCardVirtual.h"
+
+
+//8MB gives FAT16 with 1 sector clusters, so every cluster is one block and the layout below is fixed
+#define CARD_SIZE (8 * 1024 * 1024)
+#define CARD_SECTORS (CARD_SIZE / SD_CARD_BLOCK_SIZE)
+#define PARTITION_START 32
+#define PARTITION_SECTORS (CARD_SECTORS - PARTITION_START)
+#define FAT_SECTORS 64
+#define ROOT_START (PARTITION_START + 1 + 2 * FAT_SECTORS)
+#define DATA_START (ROOT_START + 32)
+#define CLUSTER_SECTOR(cluster) (DATA_START + (cluster) - 2)
+#define WRITE_ADDRESS (CARD_SIZE - SD_CARD_BLOCK_SIZE)
+
+#define ENTRY_DATE (20 << 9 | 1 << 5 | 1)
+#define ATTR_VOLUME_ID 0x08
+#define ATTR_DIRECTORY 0x10
+#define ATTR_ARCHIVE 0x20
+#define ATTR_LONG_NAME 0x0F
+
+#define APP_CMD 55
+#define APP_SEND_OP_COND 41
+#define READ_SINGLE_BLOCK 17
+#define WRITE_SINGLE_BLOCK 24
+
+
+//file contents are generated from the offset so every byte can be checked
+typedef struct{
+   uint8_t seed;
+}test_file_t;
+
+static test_file_t readmeFile = {0x11};
+static test_file_t longFile = {0x22};
+static test_file_t emptyFile = {0x33};
+static test_file_t appFile = {0x44};
+
+//README.TXT is a valid 8.3 name, cluster 2
+//"Long File Name.prc" needs 2 long name entrys and spans clusters 3 to 5
+//EMPTY.DAT has no clusters, so it shares cluster 6 with the directory after it
+//"Palm" is a mangled directory at cluster 6 holding APP.PRC at clusters 7 and 8
+static const sd_card_virtual_node_t palmChildren[] = {
+   {"APP.PRC", false, 600, NULL, 0, &appFile}
+};
+static const sd_card_virtual_node_t rootChildren[] = {
+   {"README.TXT", false, 100, NULL, 0, &readmeFile},
+   {"Long File Name.prc", false, 1300, NULL, 0, &longFile},
+   {"EMPTY.DAT", false, 0, NULL, 0, &emptyFile},
+   {"Palm", true, 0, palmChildren, 1, NULL}
+};
+static const sd_card_virtual_node_t root = {NULL, true, 0, rootChildren, 4, NULL};
+
+
+static uint8_t getFileByte(const test_file_t* file, uint32_t offset){
+   return offset * 7 + file->seed;
+}
+
+static uint32_t readFile(void* file, uint32_t offset, uint8_t* data, uint32_t size){
+   uint32_t index;
+
+   for(index = 0; index < size; index++)
+      data[index] = getFileByte(file, offset + index);
+   return size;
+}
+
+static void putLe16(uint8_t* data, uint16_t value){
+   data[0] = value & 0xFF;
+   data[1] = value >> 8;
+}
+
+static void putLe32(uint8_t* data, uint32_t value){
+   putLe16(data, value & 0xFFFF);
+   putLe16(data + 2, value >> 16);
+}
+
+static uint8_t* putEntry(uint8_t* entry, const char* shortName, uint8_t attributes, uint16_t firstCluster, uint32_t size){
+   memcpy(entry, shortName, 11);
+   entry[11] = attributes;
+   putLe16(entry + 16, ENTRY_DATE);
+   putLe16(entry + 18, ENTRY_DATE);
+   putLe16(entry + 24, ENTRY_DATE);
+   putLe16(entry + 26, firstCluster);
+   putLe32(entry + 28, size);
+   return entry + 32;
+}
+
+static uint8_t* putLongName(uint8_t* entry, const char* longName, const char* shortName){
+   //VFAT long name entrys, last piece first, ASCII names only
+   static const uint8_t offsets[13] = {1, 3, 5, 7, 9, 14, 16, 18, 20, 22, 24, 28, 30};
+   uint8_t length = strlen(longName);
+   uint8_t pieces = (length + 12) / 13;
+   uint8_t checksum = 0;
+   uint8_t piece;
+   uint8_t index;
+
+   for(index = 0; index < 11; index++)
+      checksum = ((checksum & 1) << 7) + (checksum >> 1) + (uint8_t)shortName[index];
+
+   for(piece = pieces; piece > 0; piece--){
+      entry[0] = piece | (piece == pieces ? 0x40 : 0x00);
+      entry[11] = ATTR_LONG_NAME;
+      entry[13] = checksum;
+      for(index = 0; index < 13; index++){
+         uint16_t nameIndex = (piece - 1) * 13 + index;
+
+         putLe16(entry + offsets[index], nameIndex < length ? longName[nameIndex] : nameIndex == length ? 0x0000 : 0xFFFF);
+      }
+      entry += 32;
+   }
+
+   return entry;
+}
+
+static void getFileSector(const test_file_t* file, uint32_t size, uint32_t offset, uint8_t* data){
+   uint32_t index;
+
+   memset(data, 0x00, SD_CARD_BLOCK_SIZE);
+   for(index = 0; index < SD_CARD_BLOCK_SIZE && offset + index < size; index++)
+      data[index] = getFileByte(file, offset + index);
+}
+
+static bool readBlock(uint32_t address, uint8_t* data){
+   uint8_t response[16];
+
+   if(sdCardBusCommand(READ_SINGLE_BLOCK, address, response) == 0 || sdCardBusGetDataDirection() != SD_CARD_BUS_DATA_READ)
+      return false;
+   return sdCardBusReadData(data) == SD_CARD_BLOCK_SIZE;
+}
+
+static bool writeBlock(uint32_t address, const uint8_t* data){
+   uint8_t response[16];
+
+   if(sdCardBusCommand(WRITE_SINGLE_BLOCK, address, response) == 0 || sdCardBusGetDataDirection() != SD_CARD_BUS_DATA_WRITE)
+      return false;
+   return sdCardBusWriteData(data);
+}
+
+static bool checkSector(const char* name, uint32_t sector, const uint8_t* expected){
+   uint8_t block[SD_CARD_BLOCK_SIZE];
+   bool passed;
+
+   memset(block, 0x00, SD_CARD_BLOCK_SIZE);
+   passed = readBlock(sector * SD_CARD_BLOCK_SIZE, block) && memcmp(block, expected, SD_CARD_BLOCK_SIZE) == 0;
+   printf("%s: %s\n", name, passed ? "passed" : "FAILED");
+   return passed;
+}
+
+
+int main(int argc, const char* argv[]){
+   sd_card_virtual_volume_t* volume;
+   uint8_t* rom = calloc(1, 8);
+   uint8_t response[16];
+   uint8_t expected[SD_CARD_BLOCK_SIZE];
+   uint8_t* entry;
+   bool passed = true;
+   uint32_t error;
+   uint32_t index;
+
+   error = emulatorInit(EMU_DEVICE_PALM_M515, rom, 8, NULL, 0, false, false, 0);
+   free(rom);
+   if(error != EMU_ERROR_NONE){
+      printf("emulatorInit failed: %d\n", error);
+      return 1;
+   }
+
+   volume = sdCardVirtualCreateVolume(&root, CARD_SIZE, readFile);
+   if(!volume || emulatorInsertVirtualSdCard(volume, NULL) != EMU_ERROR_NONE){
+      printf("inserting the virtual card failed\n");
+      return 1;
+   }
+
+   //leave the idle state
+   sdCardBusCommand(APP_CMD, 0x00000000, response);
+   sdCardBusCommand(APP_SEND_OP_COND, 0x00000000, response);
+
+   //master boot record, 1 FAT16 partition after a track of padding
+   memset(expected, 0x00, SD_CARD_BLOCK_SIZE);
+   expected[0x1BF] = 1;//start CHS 0/1/1
+   expected[0x1C0] = 1;
+   expected[0x1C2] = 0x04;//FAT16 under 32MB
+   expected[0x1C3] = 63;//end CHS 7/63/32
+   expected[0x1C4] = 32;
+   expected[0x1C5] = 7;
+   putLe32(expected + 0x1C6, PARTITION_START);
+   putLe32(expected + 0x1CA, PARTITION_SECTORS);
+   expected[0x1FE] = 0x55;
+   expected[0x1FF] = 0xAA;
+   passed &= checkSector("master boot record", 0, expected);
+
+   //boot sector BPB
+   memset(expected, 0x00, SD_CARD_BLOCK_SIZE);
+   expected[0] = 0xEB;
+   expected[1] = 0x3C;
+   expected[2] = 0x90;
+   memcpy(expected + 3, "MU      ", 8);
+   putLe16(expected + 11, SD_CARD_BLOCK_SIZE);
+   expected[13] = 1;//sectors per cluster
+   putLe16(expected + 14, 1);//reserved sectors
+   expected[16] = 2;//FATs
+   putLe16(expected + 17, 512);//root entrys
+   putLe16(expected + 19, PARTITION_SECTORS);
+   expected[21] = 0xF8;
+   putLe16(expected + 22, FAT_SECTORS);
+   putLe16(expected + 24, 32);//sectors per track
+   putLe16(expected + 26, 64);//heads
+   putLe32(expected + 28, PARTITION_START);
+   expected[36] = 0x80;
+   expected[38] = 0x29;
+   putLe32(expected + 39, 0x4D55564F);
+   memcpy(expected + 43, "MU VIRTUAL ", 11);
+   memcpy(expected + 54, "FAT16   ", 8);
+   expected[0x1FE] = 0x55;
+   expected[0x1FF] = 0xAA;
+   passed &= checkSector("boot sector", PARTITION_START, expected);
+
+   //FAT chains, both copys
+   memset(expected, 0x00, SD_CARD_BLOCK_SIZE);
+   putLe16(expected + 0 * 2, 0xFFF8);
+   putLe16(expected + 1 * 2, 0xFFFF);
+   putLe16(expected + 2 * 2, 0xFFFF);//README.TXT
+   putLe16(expected + 3 * 2, 4);//Long File Name.prc
+   putLe16(expected + 4 * 2, 5);
+   putLe16(expected + 5 * 2, 0xFFFF);
+   putLe16(expected + 6 * 2, 0xFFFF);//Palm
+   putLe16(expected + 7 * 2, 8);//APP.PRC
+   putLe16(expected + 8 * 2, 0xFFFF);
+   passed &= checkSector("first FAT", PARTITION_START + 1, expected);
+   passed &= checkSector("second FAT", PARTITION_START + 1 + FAT_SECTORS, expected);
+   memset(expected, 0x00, SD_CARD_BLOCK_SIZE);
+   passed &= checkSector("free FAT sector", PARTITION_START + 2, expected);
+
+   //root directory, short, long + mangled and empty entrys
+   memset(expected, 0x00, SD_CARD_BLOCK_SIZE);
+   entry = putEntry(expected, "MU VIRTUAL ", ATTR_VOLUME_ID, 0, 0);
+   entry = putEntry(entry, "README  TXT", ATTR_ARCHIVE, 2, 100);
+   entry = putLongName(entry, "Long File Name.prc", "LONGFI~1PRC");
+   entry = putEntry(entry, "LONGFI~1PRC", ATTR_ARCHIVE, 3, 1300);
+   entry = putEntry(entry, "EMPTY   DAT", ATTR_ARCHIVE, 0, 0);
+   entry = putLongName(entry, "Palm", "PALM~2     ");
+   entry = putEntry(entry, "PALM~2     ", ATTR_DIRECTORY, 6, 0);
+   passed &= checkSector("root directory", ROOT_START, expected);
+
+   //subdirectory, cluster 6 has to be the directory and not the empty file before it
+   memset(expected, 0x00, SD_CARD_BLOCK_SIZE);
+   entry = putEntry(expected, ".          ", ATTR_DIRECTORY, 6, 0);
+   entry = putEntry(entry, "..         ", ATTR_DIRECTORY, 0, 0);
+   entry = putEntry(entry, "APP     PRC", ATTR_ARCHIVE, 7, 600);
+   passed &= checkSector("subdirectory", CLUSTER_SECTOR(6), expected);
+
+   //file data, the tail of the last cluster is zeroed
+   getFileSector(&readmeFile, 100, 0, expected);
+   passed &= checkSector("README.TXT data", CLUSTER_SECTOR(2), expected);
+   for(index = 0; index < 3; index++){
+      getFileSector(&longFile, 1300, index * SD_CARD_BLOCK_SIZE, expected);
+      passed &= checkSector("Long File Name.prc data", CLUSTER_SECTOR(3 + index), expected);
+   }
+   for(index = 0; index < 2; index++){
+      getFileSector(&appFile, 600, index * SD_CARD_BLOCK_SIZE, expected);
+      passed &= checkSector("APP.PRC data", CLUSTER_SECTOR(7 + index), expected);
+   }
+   memset(expected, 0x00, SD_CARD_BLOCK_SIZE);
+   passed &= checkSector("free cluster", CLUSTER_SECTOR(9), expected);
+
+   //guest writes land in the overlay and read back through the same path
+   for(index = 0; index < SD_CARD_BLOCK_SIZE; index++)
+      expected[index] = index * 13;
+   passed &= writeBlock(WRITE_ADDRESS, expected);
+   passed &= checkSector("written block", WRITE_ADDRESS / SD_CARD_BLOCK_SIZE, expected);
+
+   emulatorEjectSdCard();
+   sdCardVirtualDestroyVolume(volume);
+   emulatorDeinit();
+
+   return passed ? 0 : 1;
+}